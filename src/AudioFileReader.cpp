@@ -25,12 +25,20 @@
 #include "AudioProcessor.h"
 #include "Streams.h"
 
+#include <boost/format.hpp>
+
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
 
 //------------------------------------------------------------------------------
 
+const int AudioFileReader::MAX_CHANNELS;
+
+//------------------------------------------------------------------------------
+
 AudioFileReader::AudioFileReader() :
+    read_ahead_size_(0),
     percent_(-1) // Force first update to display 0%
 {
 }
@@ -43,6 +51,21 @@ AudioFileReader::~AudioFileReader()
 
 //------------------------------------------------------------------------------
 
+bool AudioFileReader::isLittleEndian()
+{
+    const uint16_t value = 1;
+    return *reinterpret_cast<const unsigned char*>(&value) == 1;
+}
+
+//------------------------------------------------------------------------------
+
+void AudioFileReader::setReadAheadSize(size_t size)
+{
+    read_ahead_size_ = size;
+}
+
+//------------------------------------------------------------------------------
+
 void AudioFileReader::showProgress(long long done, long long total)
 {
     int percent;
@@ -69,3 +92,12 @@ void AudioFileReader::showProgress(long long done, long long total)
 }
 
 //------------------------------------------------------------------------------
+
+// Shows how long decoding waited for the read-ahead thread.
+
+void AudioFileReader::showWaitTime(double seconds)
+{
+    output_stream << boost::format("Read-ahead wait: %.3f seconds\n") % seconds;
+}
+
+//------------------------------------------------------------------------------
@@ -26,6 +26,10 @@
 
 //------------------------------------------------------------------------------
 
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+
 class AudioProcessor;
 
 //------------------------------------------------------------------------------
@@ -36,14 +40,32 @@ class AudioFileReader
         AudioFileReader();
         virtual ~AudioFileReader();
 
+    public:
+        // Most channels accepted, as for libsndfile
+        static const int MAX_CHANNELS = 1024;
+
+        // Returns true if 16-bit samples are stored least significant byte
+        // first, as in WAV and raw s16le input.
+        static bool isLittleEndian();
+
     public:
         virtual bool open(const char* input_filename, bool show_info = true) = 0;
 
         virtual bool run(AudioProcessor& processor) = 0;
 
+        // Reads the input file on a background thread, up to the given number
+        // of bytes ahead of decoding, or not if zero. Must be called before
+        // open(). Not used when reading from standard input.
+        void setReadAheadSize(size_t size);
+
     protected:
         void showProgress(long long done, long long total);
 
+        void showWaitTime(double seconds);
+
+    protected:
+        size_t read_ahead_size_;
+
     private:
         int percent_;
 };
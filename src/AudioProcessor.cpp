@@ -23,6 +23,8 @@
 
 #include "AudioProcessor.h"
 
+#include <limits>
+
 //------------------------------------------------------------------------------
 
 AudioProcessor::~AudioProcessor()
@@ -30,3 +32,17 @@ AudioProcessor::~AudioProcessor()
 }
 
 //------------------------------------------------------------------------------
+
+long long AudioProcessor::getRangeStartFrame() const
+{
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+long long AudioProcessor::getRangeEndFrame() const
+{
+    return std::numeric_limits<long long>::max();
+}
+
+//------------------------------------------------------------------------------
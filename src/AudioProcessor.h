@@ -44,6 +44,14 @@ class AudioProcessor
         ) = 0;
 
         virtual void done() = 0;
+
+        // The range of input frames to process, from the start frame up to but
+        // not including the end frame, once init() has been called. Readers
+        // seek to the start frame, or skip the frames before it, and stop at
+        // the end frame. By default, all frames are processed.
+
+        virtual long long getRangeStartFrame() const;
+        virtual long long getRangeEndFrame() const;
 };
 
 //------------------------------------------------------------------------------
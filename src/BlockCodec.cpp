@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "BlockCodec.h"
+
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+
+// The difference between two 16-bit values needs at most 17 bits
+
+static const uint8_t MAX_WIDTH = 17;
+
+//------------------------------------------------------------------------------
+
+static inline uint32_t zigzag(const int value)
+{
+    return value >= 0 ? static_cast<uint32_t>(value) << 1 :
+                        (static_cast<uint32_t>(-(value + 1)) << 1) | 1U;
+}
+
+//------------------------------------------------------------------------------
+
+static inline int unzigzag(const uint32_t value)
+{
+    return (value & 1U) ? -static_cast<int>(value >> 1) - 1 :
+                          static_cast<int>(value >> 1);
+}
+
+//------------------------------------------------------------------------------
+
+void BlockCodec::encode(
+    const short* values,
+    const short* reference,
+    const size_t count,
+    const size_t stride,
+    std::vector<uint8_t>& output)
+{
+    uint32_t residuals[GROUP_SIZE];
+    int previous = 0;
+
+    for (size_t group = 0; group < count; group += GROUP_SIZE) {
+        const size_t group_count = count - group < GROUP_SIZE ? count - group : GROUP_SIZE;
+
+        uint32_t all_bits = 0;
+
+        for (size_t i = 0; i < group_count; ++i) {
+            const size_t index = (group + i) * stride;
+            const int value = values[index];
+            const int prediction = reference != nullptr ? reference[index] : previous;
+
+            residuals[i] = zigzag(value - prediction);
+            all_bits |= residuals[i];
+            previous = value;
+        }
+
+        uint8_t width = 0;
+
+        while (all_bits != 0) {
+            ++width;
+            all_bits >>= 1;
+        }
+
+        output.push_back(width);
+
+        if (width == 0) {
+            continue;
+        }
+
+        uint64_t bits = 0;
+        int bit_count = 0;
+
+        for (size_t i = 0; i < group_count; ++i) {
+            bits |= static_cast<uint64_t>(residuals[i]) << bit_count;
+            bit_count += width;
+
+            while (bit_count >= 8) {
+                output.push_back(static_cast<uint8_t>(bits));
+                bits >>= 8;
+                bit_count -= 8;
+            }
+        }
+
+        if (bit_count > 0) {
+            output.push_back(static_cast<uint8_t>(bits));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+size_t BlockCodec::getMaxEncodedSize(const size_t count)
+{
+    const size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+
+    // A bit width byte per group, and a whole number of bytes of values
+    // per group, all of the greatest width
+    const size_t full_groups = count / GROUP_SIZE;
+    const size_t last_group_count = count % GROUP_SIZE;
+
+    return groups +
+           full_groups * ((GROUP_SIZE * MAX_WIDTH + 7) / 8) +
+           (last_group_count * MAX_WIDTH + 7) / 8;
+}
+
+//------------------------------------------------------------------------------
+
+const uint8_t* BlockCodec::decode(
+    const uint8_t* input,
+    const uint8_t* end,
+    const short* reference,
+    const size_t count,
+    short* values,
+    const size_t stride)
+{
+    int previous = 0;
+
+    for (size_t group = 0; group < count; group += GROUP_SIZE) {
+        const size_t group_count = count - group < GROUP_SIZE ? count - group : GROUP_SIZE;
+
+        if (input >= end) {
+            throw std::runtime_error("Invalid block: data truncated");
+        }
+
+        const uint8_t width = *input++;
+
+        if (width > MAX_WIDTH) {
+            throw std::runtime_error("Invalid block: bit width too large");
+        }
+
+        const size_t size = (group_count * width + 7) / 8;
+
+        if (static_cast<size_t>(end - input) < size) {
+            throw std::runtime_error("Invalid block: data truncated");
+        }
+
+        const uint32_t mask = (1U << width) - 1;
+
+        uint64_t bits = 0;
+        int bit_count = 0;
+        const uint8_t* p = input;
+
+        for (size_t i = 0; i < group_count; ++i) {
+            while (bit_count < width) {
+                bits |= static_cast<uint64_t>(*p++) << bit_count;
+                bit_count += 8;
+            }
+
+            const int residual = unzigzag(static_cast<uint32_t>(bits) & mask);
+            bits >>= width;
+            bit_count -= width;
+
+            const size_t index = (group + i) * stride;
+            const int prediction = reference != nullptr ? reference[index] : previous;
+
+            previous = prediction + residual;
+            values[index] = static_cast<short>(previous);
+        }
+
+        input += size;
+    }
+
+    return input;
+}
+
+//------------------------------------------------------------------------------
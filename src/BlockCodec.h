@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_BLOCK_CODEC_H)
+#define INC_BLOCK_CODEC_H
+
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Compact encoding of waveform data values, used by version 3 .dat files.
+//
+// Each value is stored as its difference from a predicted value: either the
+// previous value in the sequence (starting from zero), or the value at the
+// same position in a reference sequence, such as another channel. The
+// differences are zig-zag encoded, so that small negative and positive
+// differences both become small unsigned numbers, then bit-packed in groups
+// of GROUP_SIZE. Each group is one byte giving the bit width, followed by the
+// packed bits, least significant first, padded to a whole number of bytes.
+
+namespace BlockCodec {
+    const size_t GROUP_SIZE = 32;
+
+    // Appends count values, read from values[0], values[stride], etc, to
+    // output. If reference is not null, values are predicted from
+    // reference[0], reference[stride], etc.
+
+    void encode(
+        const short* values,
+        const short* reference,
+        size_t count,
+        size_t stride,
+        std::vector<uint8_t>& output
+    );
+
+    // Returns the most bytes that encode() can append for count values.
+
+    size_t getMaxEncodedSize(size_t count);
+
+    // Decodes count values from the given input, writing them to values[0],
+    // values[stride], etc. The reference must be the same as when encoding.
+    // Returns a pointer to the byte following the encoded values. Throws
+    // std::runtime_error if the input is invalid.
+
+    const uint8_t* decode(
+        const uint8_t* input,
+        const uint8_t* end,
+        const short* reference,
+        size_t count,
+        short* values,
+        size_t stride
+    );
+}
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_BLOCK_CODEC_H)
+
+//------------------------------------------------------------------------------
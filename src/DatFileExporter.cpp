@@ -20,11 +20,15 @@
 // Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "DatFileExporter.h"
+#include "BlockCodec.h"
 #include "Streams.h"
 #include "WaveformBuffer.h"
 #include "Options.h"
 #include "Utils.h"
 
+#include <algorithm>
+#include <limits>
+
 
 //------------------------------------------------------------------------------
 template<typename T>
@@ -49,6 +53,13 @@ static void writeUInt32(std::ostream& stream, uint32_t value)
 
 //------------------------------------------------------------------------------
 
+static void writeUInt64(std::ostream& stream, uint64_t value)
+{
+	write(stream, value);
+}
+
+//------------------------------------------------------------------------------
+
 static void writeInt8(std::ostream& stream, int8_t value)
 {
 	write(stream, value);
@@ -66,90 +77,165 @@ DatFileExporter::DatFileExporter(WaveformBuffer &buffer,
                                  const Options &options,
                                  const fs::path& output_filename):
 	FileExporter(buffer, options, output_filename),
-	bits_(options.getBits())
+	header_size_(0),
+	size_(0),
+	block_points_(0),
+	block_size_(static_cast<uint32_t>(options.getBlockSize())),
+	index_(options.getBlockIndex()),
+	index_points_(0),
+	index_offset_position_(0)
 {
 }
 
 //------------------------------------------------------------------------------
 
-void DatFileExporter::writeFile(std::ofstream& stream)
+// Byte offset of the length field: version, flags, sample rate and samples
+// per pixel precede it.
+
+static const std::streamoff SIZE_OFFSET = 16;
+
+//------------------------------------------------------------------------------
+
+void DatFileExporter::beginOutput(int channels)
 {
-	if (!buffer_.channelSizesMatch()) {
-		std::stringstream ss;
-		ss << "channel sizes do not match. " << std::endl;
-		for (int i = 0; i < buffer_.getNumChannels(); ++i) {
-			ss << "\tChannel: " << i << " size: "
-			   << buffer_.getSize(i) << std::endl;
+	channels_ = channels;
+	size_ = 0;
+	streams_.clear();
+	block_.assign(static_cast<size_t>(channels_), std::vector<short>());
+	block_points_ = 0;
+
+	// Version 1 writes a dat file for each channel separately, version 2
+	// writes one dat file with each channel interleaved, and version 3 writes
+	// one dat file with each channel encoded in blocks.
+	const int outputs = (FileExporter::VERSION_1 == version_) ? channels_ : 1;
+
+	index_points_ = 0;
+	index_offsets_.assign(static_cast<size_t>(outputs), std::vector<uint64_t>());
+	index_values_.assign(static_cast<size_t>(outputs), std::vector<short>());
+
+	for (int chan = 0; chan < outputs; ++chan) {
+		std::string filename;
+		// The header and index are updated after the points are written.
+		streams_.push_back(openFile(chan, filename, true, true));
+		std::ostream& stream = *streams_.back();
+
+		output_stream << "Writing header to output file: "
+		              << filename << std::endl;
+		writeHeader(stream);
+		if (FileExporter::VERSION_1 == version_) {
+			output_stream << "Writing channel " << std::to_string(chan)
+			              << " to output file: " << filename << std::endl;
+		} else {
+			output_stream << "Writing channel data to output file: "
+			              << filename << std::endl;
 		}
-		throwErrorEx("TxtFileExporter::writeHeader", ss.str());
-	}
-	std::string filename;
-	FILE_VERSION version = static_cast<FILE_VERSION>(options_.getFileVersion());
-	WaveformBuffer::size_type size = buffer_.getSize();
-	switch (version) {
-		case FileExporter::VERSION_1: {
-			// Write a dat file for each channel separately.
-			for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
-				if (openFile(stream, chan, filename, true)) {
-					output_stream << "Writing header to output file: "
-					              << filename << std::endl;
-					writeHeader(stream, version);
-					output_stream << "Writing channel " << std::to_string(chan) 
-					              << " to output file: " << filename << std::endl;
-					for (WaveformBuffer::size_type len = 0; len < size; ++len) {
-						writeData(stream, chan, version);
-					}
-					closeFile(stream);
-				}
-			}
-		} break;
-		case FileExporter::VERSION_2: {
-			// Write one dat file with each channel interleaved.
-			if (openFile(stream, 0, filename, true)) {
-				output_stream << "Writing header to output file: "
-				              << filename << std::endl;
-				writeHeader(stream, version);
-				output_stream << "Writing channel data to output file: " 
-				              << filename << std::endl;
-				for (WaveformBuffer::size_type len = 0; len < size; ++len) {
-					for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
-						writeData(stream, chan, len);
-					}
-				}
-				closeFile(stream);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void DatFileExporter::writeOutput()
+{
+	checkChannelSizes("DatFileExporter::writeOutput");
+
+	const int divisor = (bits_ == 8) ? 256 : 1;
+
+	WaveformBuffer::size_type size = static_cast<WaveformBuffer::size_type>(buffer_.getSize());
+	for (WaveformBuffer::size_type len = 0; len < size; ++len) {
+		beginIndexPoint();
+		for (int chan = 0; chan < channels_; ++chan) {
+			const short min = static_cast<short>(buffer_.getMinSample(len, chan) / divisor);
+			const short max = static_cast<short>(buffer_.getMaxSample(len, chan) / divisor);
+
+			switch (version_) {
+				case FileExporter::VERSION_1: {
+					writeData(*streams_[chan], min, max);
+					addIndexPoint(static_cast<size_t>(chan), 0, min, max);
+				} break;
+				case FileExporter::VERSION_2: {
+					writeData(*streams_[0], min, max);
+					addIndexPoint(0, chan, min, max);
+				} break;
+				case FileExporter::VERSION_3: {
+					block_[chan].push_back(min);
+					block_[chan].push_back(max);
+				} break;
+				default:
+					throwErrorEx("DatFileExporter::writeOutput",
+					             "unknown file version " + std::to_string(version_));
 			}
-		} break;
-		default:
-			throwErrorEx("DatFileExporter::writeFile",
-			             "unknown file version " + std::to_string(version));
+		}
+		endIndexPoint();
+
+		if (FileExporter::VERSION_3 == version_ && ++block_points_ == block_size_) {
+			writeBlock(*streams_[0]);
+		}
 	}
+	size_ += static_cast<uint32_t>(size);
 }
 
 //------------------------------------------------------------------------------
 
-void DatFileExporter::writeHeader(std::ofstream& stream, FILE_VERSION version)
+void DatFileExporter::finishOutput()
 {
-	writeInt32(stream, static_cast<std::int32_t>(version));
-	writeUInt32(stream, static_cast<std::uint32_t>(
-	    (bits_ == 8) ? WaveformBuffer::FLAG_8_BIT : 0));
+	if (FileExporter::VERSION_3 == version_ && block_points_ > 0) {
+		writeBlock(*streams_[0]);
+	}
+
+	for (size_t output = 0; output < streams_.size(); ++output) {
+		std::ostream& stream = *streams_[output];
+
+		if (index_) {
+			writeIndex(stream, output);
+		}
+
+		// The header was written before all points were known, so correct
+		// the length.
+		if (size_ != header_size_) {
+			stream.seekp(SIZE_OFFSET);
+			writeUInt32(stream, size_);
+		}
+		closeFile(streams_[output]);
+	}
+	streams_.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DatFileExporter::writeHeader(std::ostream& stream)
+{
+	header_size_ = static_cast<uint32_t>(buffer_.getSize());
+
+	uint32_t flags = (bits_ == 8) ? WaveformBuffer::FLAG_8_BIT : 0;
+	if (index_) {
+		flags |= WaveformBuffer::FLAG_BLOCK_INDEX;
+	}
+
+	writeInt32(stream, static_cast<std::int32_t>(version_));
+	writeUInt32(stream, flags);
 	writeUInt32(stream, buffer_.getSampleRate());
     writeUInt32(stream, buffer_.getSamplesPerPixel());
-    writeUInt32(stream, static_cast<uint32_t>(buffer_.getSize()));
-	if (FileExporter::VERSION_2 == version) {
-		writeUInt32(stream, buffer_.getNumChannels());
+    writeUInt32(stream, header_size_);
+	if (FileExporter::VERSION_1 != version_) {
+		writeUInt32(stream, channels_);
+	}
+	if (FileExporter::VERSION_3 == version_ || index_) {
+		writeUInt32(stream, block_size_);
+	}
+	if (index_) {
+		// Written by writeIndex()
+		index_offset_position_ = stream.tellp();
+		writeUInt64(stream, 0);
 	}
 }
 
 //------------------------------------------------------------------------------
 
-void DatFileExporter::writeData(std::ofstream& stream, int chan, size_t len)
+void DatFileExporter::writeData(std::ostream& stream, short min, short max)
 {
-	short min = buffer_.getMinSample(len, chan);
-	short max = buffer_.getMaxSample(len, chan);
-
 	if (bits_ == 8) {
-		writeInt8(stream, static_cast<int8_t>(min / 256));
-		writeInt8(stream, static_cast<int8_t>(max / 256));
+		writeInt8(stream, static_cast<int8_t>(min));
+		writeInt8(stream, static_cast<int8_t>(max));
 	} else {
 		writeInt16(stream, min);
 		writeInt16(stream, max);
@@ -157,3 +243,125 @@ void DatFileExporter::writeData(std::ofstream& stream, int chan, size_t len)
 }
 
 //------------------------------------------------------------------------------
+
+// Writes the current block: its size in bytes and number of points, followed
+// by the encoded min values then max values of each channel in turn. The
+// first channel is predicted from its previous values, and the others from
+// the first channel, as channels are usually similar.
+
+void DatFileExporter::writeBlock(std::ostream& stream)
+{
+	if (index_) {
+		index_offsets_[0].push_back(static_cast<uint64_t>(std::streamoff(stream.tellp())));
+
+		for (const auto& values : block_) {
+			short min = values[0];
+			short max = values[1];
+			for (uint32_t i = 1; i < block_points_; ++i) {
+				min = std::min(min, values[2 * i]);
+				max = std::max(max, values[2 * i + 1]);
+			}
+			index_values_[0].push_back(min);
+			index_values_[0].push_back(max);
+		}
+	}
+
+	encoded_.clear();
+
+	const short* reference = nullptr;
+
+	for (const auto& values : block_) {
+		BlockCodec::encode(&values[0], reference, block_points_, 2, encoded_);
+		BlockCodec::encode(&values[1], reference ? reference + 1 : nullptr,
+		                   block_points_, 2, encoded_);
+		reference = &block_[0][0];
+	}
+
+	writeUInt32(stream, static_cast<uint32_t>(encoded_.size()));
+	writeUInt32(stream, block_points_);
+	stream.write(reinterpret_cast<const char*>(encoded_.data()),
+	             static_cast<std::streamsize>(encoded_.size()));
+
+	for (auto& values : block_) {
+		values.clear();
+	}
+	block_points_ = 0;
+}
+
+//------------------------------------------------------------------------------
+
+// Starts a new block index entry for each output at the first point of each
+// block. Version 3 files index their encoded blocks instead.
+
+void DatFileExporter::beginIndexPoint()
+{
+	if (!index_ || FileExporter::VERSION_3 == version_ || index_points_ != 0) {
+		return;
+	}
+
+	const int channels = (FileExporter::VERSION_1 == version_) ? 1 : channels_;
+
+	for (size_t output = 0; output < streams_.size(); ++output) {
+		index_offsets_[output].push_back(
+		    static_cast<uint64_t>(std::streamoff(streams_[output]->tellp())));
+
+		for (int chan = 0; chan < channels; ++chan) {
+			index_values_[output].push_back(std::numeric_limits<short>::max());
+			index_values_[output].push_back(std::numeric_limits<short>::min());
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void DatFileExporter::addIndexPoint(size_t output, int chan, short min, short max)
+{
+	if (!index_) {
+		return;
+	}
+
+	const size_t channels = (FileExporter::VERSION_1 == version_) ? 1 : static_cast<size_t>(channels_);
+
+	std::vector<short>& values = index_values_[output];
+	short* entry = &values[values.size() - 2 * channels + 2 * static_cast<size_t>(chan)];
+
+	entry[0] = std::min(entry[0], min);
+	entry[1] = std::max(entry[1], max);
+}
+
+//------------------------------------------------------------------------------
+
+void DatFileExporter::endIndexPoint()
+{
+	if (index_ && ++index_points_ == block_size_) {
+		index_points_ = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Appends the block index to the end of the file, and writes its position to
+// the header. Each entry is the byte offset of the block, followed by the min
+// and max values of each channel in the block.
+
+void DatFileExporter::writeIndex(std::ostream& stream, size_t output)
+{
+	const uint64_t index_offset = static_cast<uint64_t>(std::streamoff(stream.tellp()));
+
+	const std::vector<uint64_t>& offsets = index_offsets_[output];
+	const std::vector<short>& values = index_values_[output];
+
+	const size_t entry_values = offsets.empty() ? 0 : values.size() / offsets.size();
+
+	for (size_t i = 0; i < offsets.size(); ++i) {
+		writeUInt64(stream, offsets[i]);
+		for (size_t j = 0; j < entry_values; ++j) {
+			writeInt16(stream, values[i * entry_values + j]);
+		}
+	}
+
+	stream.seekp(index_offset_position_);
+	writeUInt64(stream, index_offset);
+}
+
+//------------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 
 #include "FileExporter.h"
 
+#include <vector>
+
 class DatFileExporter: public FileExporter
 {
 	public:
@@ -38,12 +40,41 @@ class DatFileExporter: public FileExporter
 		DatFileExporter& operator=(const DatFileExporter &) = delete;
 
 	private:
-	    void writeFile(std::ofstream& stream);
-		
-		void writeHeader(std::ofstream& stream, FILE_VERSION version);
-		void writeData(std::ofstream& stream, int chan, size_t len);
-		
-		int bits_;
+		void beginOutput(int channels);
+		void writeOutput();
+		void finishOutput();
+
+		void writeHeader(std::ostream& stream);
+		void writeData(std::ostream& stream, short min, short max);
+		void writeBlock(std::ostream& stream);
+
+		void beginIndexPoint();
+		void addIndexPoint(size_t output, int chan, short min, short max);
+		void endIndexPoint();
+		void writeIndex(std::ostream& stream, size_t output);
+
+		// One stream per channel for version 1, otherwise a single stream
+		std::vector<std::unique_ptr<std::ostream>> streams_;
+
+		// Number of points given in the header, and actually written
+		uint32_t header_size_;
+		uint32_t size_;
+
+		// Version 3 only: points of the current block, as interleaved min
+		// and max values for each channel, and the encoded block
+		std::vector<std::vector<short>> block_;
+		uint32_t block_points_;
+		std::vector<uint8_t> encoded_;
+
+		uint32_t block_size_;
+
+		// Block index, if enabled: for each stream, the byte offset of each
+		// block, and the min and max values of each channel in each block.
+		bool index_;
+		uint32_t index_points_;
+		std::streamoff index_offset_position_;
+		std::vector<std::vector<uint64_t>> index_offsets_;
+		std::vector<std::vector<short>> index_values_;
 };
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
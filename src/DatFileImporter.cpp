@@ -20,11 +20,23 @@
 // Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "DatFileImporter.h"
+#include "BlockCodec.h"
+#include "MappedFile.h"
 #include "Streams.h"
 #include "WaveformBuffer.h"
 #include "Utils.h"
 #include "Options.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+//------------------------------------------------------------------------------
+
+// Number of points read before passing them to the exporter, if any
+
+static const int32_t EXPORT_BLOCK_SIZE = 65536;
+
 //------------------------------------------------------------------------------
 
 template<typename T>
@@ -52,6 +64,13 @@ static uint32_t readUInt32(std::istream& stream)
 
 //------------------------------------------------------------------------------
 
+static uint64_t readUInt64(std::istream& stream)
+{
+	return read<uint64_t>(stream);
+}
+
+//------------------------------------------------------------------------------
+
 static int16_t readInt16(std::istream& stream)
 {
 	return read<int16_t>(stream);
@@ -68,14 +87,46 @@ static int8_t readInt8(std::istream& stream)
 
 DatFileImporter::DatFileImporter(WaveformBuffer &buffer,
                                  const Options &options,
-                                 const fs::path& input_filename) :
-	FileImporter(buffer, options, input_filename),
+                                 const fs::path& input_filename,
+                                 FileExporter* exporter) :
+	FileImporter(buffer, options, input_filename, exporter),
 	version_(FileExporter::VERSION_1),
 	channels_(1),
-	size_(0)
+	size_(0),
+	block_size_(0),
+	has_index_(false),
+	index_offset_(0),
+	header_size_(0),
+	first_point_(0),
+	point_count_(-1)
 {
 }
 
+//------------------------------------------------------------------------------
+
+void DatFileImporter::setPointRange(int32_t first, int32_t count)
+{
+	first_point_ = first;
+	point_count_ = count;
+}
+
+//------------------------------------------------------------------------------
+
+// Gives the range of points to import, [begin, end), within the file's points.
+
+void DatFileImporter::getPointRange(int32_t& begin, int32_t& end) const
+{
+	begin = 0;
+	end = size_;
+
+	if (point_count_ >= 0) {
+		begin = std::min(std::max(first_point_, 0), size_);
+		end = static_cast<int32_t>(std::min(
+			std::max(static_cast<int64_t>(first_point_) + point_count_, static_cast<int64_t>(begin)),
+			static_cast<int64_t>(size_)));
+	}
+}
+
 //------------------------------------------------------------------------------
 				
 void DatFileImporter::readFile(std::ifstream& stream)
@@ -85,10 +136,22 @@ void DatFileImporter::readFile(std::ifstream& stream)
     file.exceptions(std::ios::badbit | std::ios::failbit);
 
 	std::string filename = input_filename_.string();
+
+	// Version 1 and 2 data is read from a memory mapping where possible
+	MappedFile mapped_file;
+	bool mapped = false;
+
     try {
         file.open(filename, std::ios::in | std::ios::binary);
-		readHeader(file);
-		readData(file);
+		openHeader(file);
+
+		if (FileExporter::VERSION_3 != version_ && channels_ > 0) {
+			mapped = mapped_file.open(filename.c_str());
+		}
+
+		if (!mapped) {
+			readData(file);
+		}
 	} catch (std::exception& e) {
 
 		// Note: Catching std::exception instead of std::ios::failure is a
@@ -97,13 +160,107 @@ void DatFileImporter::readFile(std::ifstream& stream)
         // See https://gcc.gnu.org/bugzilla/show_bug.cgi?id=66145
         // and http://stackoverflow.com/questions/38471518
 
-        if (!file.eof()) {
+		if (file.good()) {
+			// Not a read error, e.g., corrupted data
+			throw;
+		}
+        else if (!file.eof()) {
 			throwErrorEx("DatFileImporter::load", strerror(errno), filename);
         }
+		else if (exporter_ != nullptr) {
+			// Points already passed to the exporter can't be taken back, so
+			// a truncated file must fail rather than give partial output.
+			throwErrorEx("DatFileImporter::load", "unexpected end of file", filename);
+		}
 	}
 	file.clear();
+
+	if (mapped) {
+		readMappedData(mapped_file, header_size_);
+	}
 }
 
+//------------------------------------------------------------------------------
+
+bool DatFileImporter::ImportHeaderFromFile()
+{
+	std::ifstream file;
+	file.exceptions(std::ios::badbit | std::ios::failbit);
+
+	const std::string filename = input_filename_.string();
+
+	try {
+		file.open(filename, std::ios::in | std::ios::binary);
+		openHeader(file);
+	} catch (std::exception& e) {
+		// See readFile()
+		if (!file.eof()) {
+			throwErrorEx("DatFileImporter::ImportHeaderFromFile", strerror(errno), filename);
+		}
+		throwErrorEx("DatFileImporter::ImportHeaderFromFile", "unexpected end of file", filename);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool DatFileImporter::ImportIndexFromFile(int output_samples_per_pixel)
+{
+	std::ifstream file;
+	file.exceptions(std::ios::badbit | std::ios::failbit);
+
+	const std::string filename = input_filename_.string();
+
+	try {
+		file.open(filename, std::ios::in | std::ios::binary);
+		openHeader(file);
+
+		// The index holds the min and max values of each channel, which
+		// can't give the min and max values of a mono downmix.
+		if (!has_index_ || (options_.getMono() && (channels_ > 1))) {
+			return false;
+		}
+
+		const uint64_t samples_per_pixel =
+			static_cast<uint64_t>(buffer_.getSamplesPerPixel()) * block_size_;
+
+		if (samples_per_pixel == 0 ||
+		    samples_per_pixel > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+		    output_samples_per_pixel % static_cast<int>(samples_per_pixel) != 0) {
+			return false;
+		}
+
+		buffer_.setSamplesPerPixel(static_cast<int>(samples_per_pixel));
+
+		file.seekg(static_cast<std::streamoff>(index_offset_));
+		readIndex(file);
+	} catch (std::exception& e) {
+		// See readFile()
+		if (!file.eof()) {
+			throwErrorEx("DatFileImporter::ImportIndexFromFile", strerror(errno), filename);
+		}
+		throwErrorEx("DatFileImporter::ImportIndexFromFile", "unexpected end of file", filename);
+	}
+
+	return true;
+}
+
+
+//------------------------------------------------------------------------------
+
+// Reads the header, or if it has already been read, skips over it.
+
+void DatFileImporter::openHeader(std::ifstream& stream)
+{
+	if (header_size_ != 0) {
+		stream.seekg(static_cast<std::streamoff>(header_size_));
+		return;
+	}
+
+	readHeader(stream);
+	header_size_ = static_cast<size_t>(std::streamoff(stream.tellg()));
+}
 
 //------------------------------------------------------------------------------
 
@@ -111,36 +268,72 @@ void DatFileImporter::readHeader(std::ifstream& stream)
 {
 	version_ = static_cast<FileExporter::FILE_VERSION>(readInt32(stream));
 	if ((FileExporter::VERSION_1 != version_) &&
-	    (FileExporter::VERSION_2 != version_)) {
+	    (FileExporter::VERSION_2 != version_) &&
+	    (FileExporter::VERSION_3 != version_)) {
 		throwErrorEx("DatFileImporter::readHeader", "Unknown file version " +
 		           std::to_string(version_), input_filename_.string());
 	}
 	
-	buffer_.setBits(((readUInt32(stream) == WaveformBuffer::FLAG_8_BIT) ? 8 : 16));
+	const uint32_t flags = readUInt32(stream);
+	buffer_.setBits((flags & WaveformBuffer::FLAG_8_BIT) ? 8 : 16);
+	has_index_ = (flags & WaveformBuffer::FLAG_BLOCK_INDEX) != 0;
 	buffer_.setSampleRate(readUInt32(stream));
 	buffer_.setSamplesPerPixel(readUInt32(stream));
 	size_ = readUInt32(stream);
-	if (FileExporter::VERSION_2 == version_) {
+	if (FileExporter::VERSION_1 != version_) {
 		channels_ = readUInt32(stream);
 	}
+	if (FileExporter::VERSION_3 == version_ || has_index_) {
+		block_size_ = readUInt32(stream);
+		if (block_size_ == 0) {
+			throwErrorEx("DatFileImporter::readHeader", "Invalid block size: 0",
+			             input_filename_.string());
+		}
+	}
+	if (has_index_) {
+		index_offset_ = readUInt64(stream);
+	}
 	
 	output_stream << "File version: " << version_ << std::endl
 	              << "Sample rate: " << buffer_.getSampleRate() << " Hz" << std::endl
 	              << "Bits: " << buffer_.getBits() << std::endl
 	              << "Samples per pixel: " << buffer_.getSamplesPerPixel() << std::endl
 	              << "Length: " << size_ << " points" << std::endl;
-	if (FileExporter::VERSION_2 == version_) {
+	if (FileExporter::VERSION_1 != version_) {
 		output_stream << "Channels: " << channels_ << std::endl;
 	}
+	if (FileExporter::VERSION_3 == version_ || has_index_) {
+		output_stream << "Block size: " << block_size_ << " points" << std::endl;
+	}
 }
 
 void DatFileImporter::readData(std::ifstream& stream)
 {
+	if (FileExporter::VERSION_3 == version_) {
+		readBlocks(stream);
+		return;
+	}
+
 	int bits = buffer_.getBits();
 	short min = 0, max = 0;
 	bool mono = (options_.getMono() && (channels_ > 1));
+	int32_t points = 0;
+
+	int32_t begin = 0, end = 0;
+	getPointRange(begin, end);
+
+	// Points have a fixed size, so seek straight to the first one needed
+	if (begin > 0) {
+		const std::streamoff point_size = static_cast<std::streamoff>(channels_) * 2 * (bits / 8);
+		stream.seekg(point_size * begin, std::ios::cur);
+	}
+	buffer_.setOffset(begin);
+
+	if (exporter_ != nullptr) {
+		exporter_->begin(mono ? 1 : static_cast<int>(channels_), end - begin);
+	}
 	
-	for (int32_t size = 0; size < size_; ++size) {
+	for (int32_t size = begin; size < end; ++size) {
 		if (mono) {
 			int min_value = 0, max_value = 0;
 			for (uint32_t chan = 0; chan < channels_; ++chan) {
@@ -157,19 +350,311 @@ void DatFileImporter::readData(std::ifstream& stream)
 				buffer_.appendSamples(min, max, chan);
 			}
 		}
+		++points;
+
+		if (exporter_ != nullptr && (points % EXPORT_BLOCK_SIZE) == 0) {
+			exporter_->writePoints();
+		}
+	}
+
+	if (exporter_ != nullptr) {
+		exporter_->writePoints();
+		exporter_->finish();
 	}
 	
 	output_stream << "Completed import of " << input_filename_ 
-	              << ".  Total points: " << buffer_.getSize() << std::endl;
-	if (buffer_.getSize() != size_) {
+	              << ".  Total points: " << points << std::endl;
+	if (points != end - begin) {
 		throwErrorEx("DatFileImporter::readData", 
 		    "Corrupted input file. expected " + 
 		    std::to_string(size_) + " points, but " +
-		    std::to_string(buffer_.getSize()) + " points found.",
+		    std::to_string(points) + " points found.",
 		    input_filename_.string());
 	}
 }
 
+//------------------------------------------------------------------------------
+
+// Converts points of 8 or 16-bit version 1 or 2 data, with the given number
+// of interleaved channels, to one channel of the buffer.
+
+template<typename T>
+static void convertChannel(const T* input, size_t count, size_t channels,
+                           size_t chan, int scale, short* output)
+{
+	input += 2 * chan;
+
+	for (size_t i = 0; i < count; ++i) {
+		output[2 * i]     = static_cast<short>(input[0] * scale);
+		output[2 * i + 1] = static_cast<short>(input[1] * scale);
+		input += 2 * channels;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// As convertChannel(), but downmixing all channels to one, with the same
+// arithmetic as readData().
+
+template<typename T>
+static void downmixChannels(const T* input, size_t count, uint32_t channels,
+                            int scale, short* output)
+{
+	for (size_t i = 0; i < count; ++i) {
+		int min_value = 0, max_value = 0;
+		for (uint32_t chan = 0; chan < channels; ++chan) {
+			min_value += static_cast<short>(input[0] * scale);
+			max_value += static_cast<short>(input[1] * scale);
+			input += 2;
+		}
+		output[2 * i]     = static_cast<short>(min_value / channels);
+		output[2 * i + 1] = static_cast<short>(max_value / channels);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Reads version 1 or 2 data from a memory mapping of the file, converting
+// whole runs of points at a time rather than reading each value.
+
+void DatFileImporter::readMappedData(const MappedFile& file, size_t header_size)
+{
+	const int bits = buffer_.getBits();
+	const bool mono = (options_.getMono() && (channels_ > 1));
+
+	int32_t begin = 0, end = 0;
+	getPointRange(begin, end);
+
+	const size_t point_size = static_cast<size_t>(channels_) * 2 * static_cast<size_t>(bits / 8);
+	const size_t data_size = file.size() > header_size ? file.size() - header_size : 0;
+	const int64_t available = static_cast<int64_t>(data_size / point_size);
+
+	if (available < end) {
+		// See readFile()
+		if (exporter_ != nullptr) {
+			throwErrorEx("DatFileImporter::load", "unexpected end of file",
+			             input_filename_.string());
+		}
+		end = static_cast<int32_t>(std::max(available, static_cast<int64_t>(begin)));
+	}
+
+	buffer_.setOffset(begin);
+
+	if (exporter_ != nullptr) {
+		exporter_->begin(mono ? 1 : static_cast<int>(channels_), end - begin);
+	}
+
+	// Without an exporter, all points are converted at once
+	const int32_t run_size = (exporter_ != nullptr) ? EXPORT_BLOCK_SIZE : end - begin;
+
+	for (int32_t first = begin; first < end; first += run_size) {
+		const size_t count = static_cast<size_t>(std::min(run_size, end - first));
+		const uint8_t* input = file.data() + header_size +
+		                       static_cast<size_t>(first) * point_size;
+
+		if (mono) {
+			short* output = buffer_.appendPoints(count, 0);
+
+			if (bits == 8) {
+				downmixChannels(reinterpret_cast<const int8_t*>(input), count, channels_, 256, output);
+			} else {
+				downmixChannels(reinterpret_cast<const int16_t*>(input), count, channels_, 1, output);
+			}
+		} else {
+			for (uint32_t chan = 0; chan < channels_; ++chan) {
+				short* output = buffer_.appendPoints(count, static_cast<int>(chan));
+
+				if (bits == 8) {
+					convertChannel(reinterpret_cast<const int8_t*>(input), count,
+					               channels_, chan, 256, output);
+				} else if (channels_ == 1) {
+					// Same layout as the buffer
+					memcpy(output, input, count * point_size);
+				} else {
+					convertChannel(reinterpret_cast<const int16_t*>(input), count,
+					               channels_, chan, 1, output);
+				}
+			}
+		}
+
+		if (exporter_ != nullptr) {
+			exporter_->writePoints();
+		}
+	}
+
+	if (exporter_ != nullptr) {
+		exporter_->finish();
+	}
+
+	output_stream << "Completed import of " << input_filename_ 
+	              << ".  Total points: " << (end - begin) << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+void DatFileImporter::readBlocks(std::ifstream& stream)
+{
+	const bool mono = (options_.getMono() && (channels_ > 1));
+	const size_t channels = channels_;
+	int32_t points = 0;
+
+	// Decoded values of the current block: for each channel in turn, the
+	// interleaved min and max values of every point.
+	std::vector<short> values;
+	std::vector<uint8_t> encoded;
+
+	int32_t begin = 0, end = 0;
+	getPointRange(begin, end);
+	buffer_.setOffset(begin);
+
+	// Total points of the blocks read or skipped so far
+	int32_t position = 0;
+
+	if (exporter_ != nullptr) {
+		exporter_->begin(mono ? 1 : static_cast<int>(channels_), end - begin);
+	}
+
+	while (position < end) {
+		const uint32_t encoded_size = readUInt32(stream);
+		const uint32_t block_points = readUInt32(stream);
+
+		if (block_points == 0 || block_points > block_size_ ||
+		    block_points > static_cast<uint32_t>(size_ - position)) {
+			throwErrorEx("DatFileImporter::readBlocks",
+			    "Corrupted input file. Invalid block length: " +
+			    std::to_string(block_points) + " points",
+			    input_filename_.string());
+		}
+
+		// The min and max values of each channel are encoded separately
+		const size_t max_encoded_size =
+			2 * channels * BlockCodec::getMaxEncodedSize(block_points);
+
+		if (encoded_size > max_encoded_size) {
+			throwErrorEx("DatFileImporter::readBlocks",
+			    "Corrupted input file. Invalid block size: " +
+			    std::to_string(encoded_size) + " bytes",
+			    input_filename_.string());
+		}
+
+		// Skip blocks before the range without decoding them
+		if (position + static_cast<int32_t>(block_points) <= begin) {
+			stream.seekg(encoded_size, std::ios::cur);
+			position += static_cast<int32_t>(block_points);
+			continue;
+		}
+
+		encoded.resize(encoded_size);
+		stream.read(reinterpret_cast<char*>(encoded.data()), encoded_size);
+
+		const size_t stride = 2 * static_cast<size_t>(block_points);
+		values.resize(channels * stride);
+
+		try {
+			const uint8_t* input = encoded.data();
+			const uint8_t* end = input + encoded.size();
+
+			// See DatFileExporter::writeBlock()
+			const short* reference = nullptr;
+
+			for (size_t chan = 0; chan < channels; ++chan) {
+				short* chan_values = &values[chan * stride];
+				input = BlockCodec::decode(input, end, reference,
+				                           block_points, chan_values, 2);
+				input = BlockCodec::decode(input, end, reference ? reference + 1 : nullptr,
+				                           block_points, chan_values + 1, 2);
+				reference = &values[0];
+			}
+		} catch (const std::runtime_error& e) {
+			throwErrorEx("DatFileImporter::readBlocks",
+			             std::string("Corrupted input file. ") + e.what(),
+			             input_filename_.string());
+		}
+
+		const int32_t first = std::max(begin - position, 0);
+		const int32_t last = std::min(end - position, static_cast<int32_t>(block_points));
+
+		for (int32_t i = first; i < last; ++i) {
+			const size_t index = static_cast<size_t>(i);
+			appendPoint(&values[2 * index], &values[2 * index + 1], stride);
+		}
+
+		points += last - first;
+		position += static_cast<int32_t>(block_points);
+
+		if (exporter_ != nullptr) {
+			exporter_->writePoints();
+		}
+	}
+
+	if (exporter_ != nullptr) {
+		exporter_->finish();
+	}
+
+	output_stream << "Completed import of " << input_filename_ 
+	              << ".  Total points: " << points << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+// Reads the block index, see DatFileExporter::writeIndex(). Each entry gives
+// one point, so the buffer has block size times the samples per pixel.
+
+void DatFileImporter::readIndex(std::ifstream& stream)
+{
+	const int32_t blocks = static_cast<int32_t>(
+		(static_cast<uint32_t>(size_) + block_size_ - 1) / block_size_);
+
+	// 8-bit values are stored in the index as in the data
+	const int scale = (buffer_.getBits() == 8) ? 256 : 1;
+
+	for (int32_t block = 0; block < blocks; ++block) {
+		readUInt64(stream); // Block offset, not needed here
+
+		for (uint32_t chan = 0; chan < channels_; ++chan) {
+			const short min = readInt16(stream);
+			const short max = readInt16(stream);
+			buffer_.appendSamples(static_cast<short>(min * scale),
+			                      static_cast<short>(max * scale),
+			                      static_cast<int>(chan));
+		}
+	}
+
+	output_stream << "Completed import of block index from " << input_filename_
+	              << ".  Total points: " << blocks << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+// Appends one point, given the min and max values of each channel at the given
+// stride, and downmixing to mono if requested.
+
+void DatFileImporter::appendPoint(const short* mins, const short* maxs,
+                                  size_t stride)
+{
+	const int scale = (buffer_.getBits() == 8) ? 256 : 1;
+
+	if (options_.getMono() && (channels_ > 1)) {
+		int min_value = 0, max_value = 0;
+		for (uint32_t chan = 0; chan < channels_; ++chan) {
+			min_value += static_cast<short>(mins[chan * stride] * scale);
+			max_value += static_cast<short>(maxs[chan * stride] * scale);
+		}
+		// Same arithmetic as for version 1 and 2 files, so all versions give
+		// identical results.
+		buffer_.appendSamples(static_cast<short>(min_value / channels_),
+		                      static_cast<short>(max_value / channels_), 0);
+	} else {
+		for (uint32_t chan = 0; chan < channels_; ++chan) {
+			buffer_.appendSamples(static_cast<short>(mins[chan * stride] * scale),
+			                      static_cast<short>(maxs[chan * stride] * scale),
+			                      static_cast<int>(chan));
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+
 void DatFileImporter::getSamples(std::ifstream& stream, int bits, 
                                  short& min, short& max)
 {
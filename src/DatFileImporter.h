@@ -25,12 +25,15 @@
 #include "FileImporter.h"
 #include "FileExporter.h"
 
+class MappedFile;
+
 class DatFileImporter: public FileImporter
 {
 	public:
 		DatFileImporter(WaveformBuffer &buffer,
 		                const Options &options,
-		                const fs::path& input_filename);
+		                const fs::path& input_filename,
+		                FileExporter* exporter = nullptr);
 		~DatFileImporter() = default;
 		
 		DatFileImporter() = delete;
@@ -38,11 +41,31 @@ class DatFileImporter: public FileImporter
 		DatFileImporter(const DatFileImporter &) = delete;
 		DatFileImporter& operator=(const DatFileImporter &) = delete;
 
+		// Reads only the block index of a file written with --block-index,
+		// giving one point per block. Returns false if the file has no index,
+		// or if the index can't be used to give the requested output, i.e.,
+		// the output samples per pixel isn't a multiple of the index's.
+		bool ImportIndexFromFile(int output_samples_per_pixel);
+
+		// Reads only the header, setting the buffer's sample rate, samples
+		// per pixel and bits. The header isn't read again by later imports.
+		bool ImportHeaderFromFile();
+
+		// Limits import to count points from the given point, which is kept
+		// as the buffer's offset. Points outside the waveform are ignored.
+		void setPointRange(int32_t first, int32_t count);
+
 	private:
 		void readFile(std::ifstream& stream);
 
+		void openHeader(std::ifstream& stream);
 		void readHeader(std::ifstream& stream);
 		void readData(std::ifstream& stream);
+		void readMappedData(const MappedFile& file, size_t header_size);
+		void readBlocks(std::ifstream& stream);
+		void readIndex(std::ifstream& stream);
+		void getPointRange(int32_t& begin, int32_t& end) const;
+		void appendPoint(const short* mins, const short* maxs, size_t stride);
 
 		void getSamples(std::ifstream& stream, int bits,
 		                short& min, short& max);
@@ -50,6 +73,16 @@ class DatFileImporter: public FileImporter
 		FileExporter::FILE_VERSION version_;
 		uint32_t channels_;
 		int32_t size_;
+		uint32_t block_size_;
+		bool has_index_;
+		uint64_t index_offset_;
+
+		// Size of the header once read, or zero
+		size_t header_size_;
+
+		// Range of points to import, see setPointRange()
+		int32_t first_point_;
+		int32_t point_count_;
 
 };
 
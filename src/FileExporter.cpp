@@ -25,28 +25,73 @@
 #include "Streams.h"
 #include "Utils.h"
 
+#include <cstdio>
+#include <sstream>
+#include <streambuf>
+
+//------------------------------------------------------------------------------
+
+// Writes to standard output using stdio, as std::cout is redirected to show
+// progress messages when the output file is written to standard output.
+
+class StdoutStreamBuf : public std::streambuf
+{
+	protected:
+		virtual int_type overflow(int_type c)
+		{
+			if (traits_type::eq_int_type(c, traits_type::eof())) {
+				return traits_type::not_eof(c);
+			}
+
+			return fputc(c, stdout) == EOF ? traits_type::eof() : c;
+		}
+
+		virtual std::streamsize xsputn(const char* data, std::streamsize size)
+		{
+			return static_cast<std::streamsize>(
+				fwrite(data, 1, static_cast<size_t>(size), stdout)
+			);
+		}
+
+		virtual int sync()
+		{
+			return fflush(stdout) == 0 ? 0 : -1;
+		}
+};
+
+//------------------------------------------------------------------------------
+
+class StdoutStream : public std::ostream
+{
+	public:
+		StdoutStream() : std::ostream(nullptr)
+		{
+			rdbuf(&buffer_);
+		}
+
+	private:
+		StdoutStreamBuf buffer_;
+};
+
+//------------------------------------------------------------------------------
+
 FileExporter::FileExporter(WaveformBuffer &buffer,
                            const Options &options,
                            const fs::path& output_filename) :
 		    buffer_(buffer),
 		    options_(options),
-			output_filename_(output_filename)
+			output_filename_(output_filename),
+			version_(VERSION_1),
+			bits_(16),
+			channels_(0),
+			length_(-1)
 {
 }
 
 bool FileExporter::ExportToFile()
 {
 	try {
-		int bits = options_.getBits();
-		if (bits != 8 && bits != 16) {
-			throwErrorEx("FileExporter::ExportToFile", "Invalid bits: must be either 8 or 16");
-		}
-		
-		FILE_VERSION version = static_cast<FILE_VERSION>(options_.getFileVersion());
-		if ((FileExporter::VERSION_1 != version) && (FileExporter::VERSION_2 != version)) {
-			throwErrorEx("FileExporter::ExportToFile", "Unknown file version.  Version: " + 
-			             std::to_string(version) + " - Version must be either 1 or 2.");
-		}
+		checkOptions();
 
 		std::ofstream file;
 		file.exceptions(std::ios::badbit | std::ios::failbit);
@@ -62,6 +107,13 @@ bool FileExporter::ExportToFile()
 std::string FileExporter::getOutputFilename(const fs::path& output_filename, 
                                             int chan_num) {
 	fs::path fn = output_filename;
+	if (fn == "-") {
+		if (chan_num > 0) {
+			throwErrorEx("FileExporter::getOutputFilename",
+			             "can't write more than one file to standard output");
+		}
+		return fn.string();
+	}
 	if (!options_.getMono() && (options_.getFileVersion() == VERSION_1)) {
 		// If this isn't a mono waveform, but writing as a version 1 file, then append
 		// the channel number to the filename.
@@ -72,33 +124,167 @@ std::string FileExporter::getOutputFilename(const fs::path& output_filename,
 	return fn.string();
 }
 
-bool FileExporter::openFile(std::ofstream& stream,
-                            int chan, std::string& filename, bool binary)
+//------------------------------------------------------------------------------
+
+void FileExporter::begin(int channels, int32_t length)
+{
+	checkOptions();
+	length_ = length;
+	beginOutput(channels);
+}
+
+//------------------------------------------------------------------------------
+
+void FileExporter::writePoints()
+{
+	writeOutput();
+	buffer_.setSize(0);
+}
+
+//------------------------------------------------------------------------------
+
+void FileExporter::finish()
+{
+	finishOutput();
+}
+
+//------------------------------------------------------------------------------
+
+void FileExporter::writeFile(std::ofstream& stream)
+{
+	UNUSED(stream);
+	beginOutput(buffer_.getNumChannels());
+	writeOutput();
+	finishOutput();
+}
+
+//------------------------------------------------------------------------------
+
+void FileExporter::beginOutput(int channels)
+{
+	UNUSED(channels);
+	throwErrorEx("FileExporter::beginOutput",
+	             "incremental export is not supported for this file type",
+	             output_filename_.string());
+}
+
+void FileExporter::writeOutput()
+{
+	throwErrorEx("FileExporter::writeOutput",
+	             "incremental export is not supported for this file type",
+	             output_filename_.string());
+}
+
+void FileExporter::finishOutput()
+{
+	throwErrorEx("FileExporter::finishOutput",
+	             "incremental export is not supported for this file type",
+	             output_filename_.string());
+}
+
+//------------------------------------------------------------------------------
+
+void FileExporter::checkOptions()
 {
-	if (stream.is_open()) {
-		closeFile(stream);
+	int bits = options_.getBits();
+	if (bits != 8 && bits != 16) {
+		throwErrorEx("FileExporter::checkOptions", "Invalid bits: must be either 8 or 16");
+	}
+
+	version_ = static_cast<FILE_VERSION>(options_.getFileVersion());
+	if ((FileExporter::VERSION_1 != version_) && (FileExporter::VERSION_2 != version_) &&
+	    (FileExporter::VERSION_3 != version_)) {
+		throwErrorEx("FileExporter::checkOptions", "Unknown file version.  Version: " + 
+		             std::to_string(version_) + " - Version must be either 1, 2 or 3.");
 	}
+
+	// Unless given explicitly, keep the resolution of the input data.
+	bits_ = options_.hasBits() ? bits : buffer_.getBits();
+}
+
+//------------------------------------------------------------------------------
+
+void FileExporter::checkChannelSizes(const std::string& method)
+{
+	if (!buffer_.channelSizesMatch()) {
+		std::stringstream ss;
+		ss << "channel sizes do not match. " << std::endl;
+		for (int i = 0; i < buffer_.getNumChannels(); ++i) {
+			ss << "\tChannel: " << i << " size: "
+			   << buffer_.getSize(i) << std::endl;
+		}
+		throwErrorEx(method, ss.str(), output_filename_.string());
+	}
+}
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<std::ostream> FileExporter::openFile(int chan,
+                                                     std::string& filename,
+                                                     bool binary,
+                                                     bool seekable)
+{
+	filename = getOutputFilename(output_filename_, chan);
+
+	if (filename == "-") {
+		// Write errors are reported by closeFile().
+		if (seekable) {
+			return std::unique_ptr<std::ostream>(new std::stringstream(
+				std::ios::in | std::ios::out | std::ios::binary));
+		}
+		return std::unique_ptr<std::ostream>(new StdoutStream);
+	}
+
+	std::ofstream* file = new std::ofstream;
+	std::unique_ptr<std::ostream> stream(file);
+	stream->exceptions(std::ios::badbit | std::ios::failbit);
 	try {
-		filename = getOutputFilename(output_filename_, chan);
 		if (binary) {
-			stream.open(filename, std::ios::binary);
+			file->open(filename, std::ios::binary);
 		} else {
-			stream.open(filename);
+			file->open(filename);
 		}
 	} catch (std::exception &e) {
 		throwErrorEx("FileExporter::openFile", e.what(), filename);
 	}
-	return true;
+	return stream;
 }
 
 //------------------------------------------------------------------------------
 
-void FileExporter::closeFile(std::ofstream& stream)
+void FileExporter::closeFile(std::unique_ptr<std::ostream>& stream)
 {
-	if (stream.is_open()) {
-		stream.flush();
-		stream.close();
+	if (!stream) {
+		return;
+	}
+
+	if (std::ofstream* file = dynamic_cast<std::ofstream*>(stream.get())) {
+		stream->flush();
+		file->close();
+	}
+	else {
+		// Standard output
+		stream->flush();
+
+		bool success = !stream->fail();
+
+		if (std::stringstream* memory = dynamic_cast<std::stringstream*>(stream.get())) {
+			// Copy the output through its stream buffer, rather than making
+			// another copy of it as a string.
+			StdoutStream output;
+			if (memory->tellp() > 0) {
+				output << memory->rdbuf();
+			}
+			output.flush();
+			success = success && !output.fail();
+		}
+
+		if (!success) {
+			throwErrorEx("FileExporter::closeFile",
+			             "failed to write to standard output");
+		}
 	}
+	stream.reset();
 }
 
 //------------------------------------------------------------------------------
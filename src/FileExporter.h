@@ -23,6 +23,9 @@
 #define INC_FILE_EXPORTER_H
 
 #include <boost/filesystem.hpp>
+#include <fstream>
+#include <memory>
+#include <ostream>
 #include "Error.h"
 
 class WaveformBuffer;
@@ -33,13 +36,26 @@ namespace fs = boost::filesystem;
 class FileExporter
 {
 	public:
-		~FileExporter() = default;
+		virtual ~FileExporter() = default;
 		
 		bool ExportToFile();
 
+		// Incremental export, for use while the buffer is being filled.
+		// begin() opens the output and writes any header. Each call to
+		// writePoints() writes the points currently held in the buffer and
+		// then removes them from it, so the buffer never holds more than one
+		// block of points. finish() completes the output, updating any header
+		// fields that depend on the total number of points. length is the
+		// number of points that will be written for each channel, or -1 if
+		// not known in advance.
+		void begin(int channels, int32_t length = -1);
+		void writePoints();
+		void finish();
+
 		typedef enum {
 			VERSION_1 = 1U,
-			VERSION_2
+			VERSION_2,
+			VERSION_3
 		} FILE_VERSION;
  
 	protected:
@@ -50,15 +66,38 @@ class FileExporter
 		std::string getOutputFilename(const fs::path& output_filename, 
                                       int chan_num);
 		
-		bool openFile(std::ofstream& stream, int chan,
-		              std::string& filename, bool binary = false);
-		void closeFile(std::ofstream& stream);
+		// Opens the output file for the given channel. If the output filename
+		// is "-", the output is written to standard output, or, if it must be
+		// seekable, held in memory and written to standard output when closed.
+		std::unique_ptr<std::ostream> openFile(int chan, std::string& filename,
+		                                       bool binary = false,
+		                                       bool seekable = false);
+		void closeFile(std::unique_ptr<std::ostream>& stream);
 		
-		virtual void writeFile(std::ofstream& stream) = 0;
+		// Writes the whole buffer. The default implementation uses the
+		// incremental export functions below.
+		virtual void writeFile(std::ofstream& stream);
+
+		// Incremental export, implemented by exporters that support it.
+		// channels is the number of channels that will be written, which
+		// may be more than the buffer holds when begin() is called.
+		virtual void beginOutput(int channels);
+		virtual void writeOutput();
+		virtual void finishOutput();
+
+		void checkOptions();
+		void checkChannelSizes(const std::string& method);
 
 		WaveformBuffer &buffer_;
 		const Options &options_;
 		const fs::path& output_filename_;
+
+		FILE_VERSION version_;
+		int bits_;
+		int channels_;
+
+		// Number of points per channel given to begin(), or -1 if not known
+		int32_t length_;
 };
 
 #endif
\ No newline at end of file
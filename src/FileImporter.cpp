@@ -33,9 +33,10 @@ bool FileImporter::ImportFromFile()
 	FileExporter::FILE_VERSION version = 
 		static_cast<FileExporter::FILE_VERSION>(options_.getFileVersion());
 	if ((FileExporter::VERSION_1 != version) && 
-	    (FileExporter::VERSION_2 != version)) {
+	    (FileExporter::VERSION_2 != version) &&
+	    (FileExporter::VERSION_3 != version)) {
 		throwErrorEx("FileImporter::ImportFromFile", "Unknown file version.  Version: " + 
-		             std::to_string(version) + " - Version must be either 1 or 2");
+		             std::to_string(version) + " - Version must be either 1, 2 or 3");
 	}
 
 	std::ifstream file;
@@ -47,10 +48,12 @@ bool FileImporter::ImportFromFile()
 
 FileImporter::FileImporter(WaveformBuffer &buffer,
                            const Options &options,
-                           const fs::path& input_filename):
+                           const fs::path& input_filename,
+                           FileExporter* exporter):
 	buffer_(buffer),
 	options_(options),
-	input_filename_(input_filename)
+	input_filename_(input_filename),
+	exporter_(exporter)
 {
 }
 
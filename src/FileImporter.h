@@ -37,7 +37,8 @@ class FileImporter
 	protected:
 		FileImporter(WaveformBuffer &buffer,
 		             const Options &options,
-		             const fs::path& input_filename);
+		             const fs::path& input_filename,
+		             FileExporter* exporter = nullptr);
 
 		virtual void readFile(std::ifstream& stream) = 0;
 
@@ -47,6 +48,10 @@ class FileImporter
 		WaveformBuffer& buffer_;
 		const Options& options_;
 		const fs::path& input_filename_;
+
+		// If set, points are passed to the exporter as they are read,
+		// instead of accumulating in the buffer.
+		FileExporter* exporter_;
 };
 
 #endif
\ No newline at end of file
@@ -31,13 +31,19 @@
 
 #include <gdfonts.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -47,9 +53,13 @@ const int MAX_SAMPLE_RATE   = 50000;
 const int MAX_ZOOM          = 2000000;
 const double MAX_START_TIME = 12 * 60 * 60; // 12 hours
 
+// Minimum width of each band of columns drawn by a separate thread
+const int MIN_BAND_WIDTH = 4096;
+
 //------------------------------------------------------------------------------
 
-// Returns the minimum and maximum values over a given region of the buffer.
+// Returns the minimum and maximum values over a given region of the buffer,
+// in all channels.
 
 static std::pair<int, int> getAmplitudeRange(
     const WaveformBuffer& buffer,
@@ -59,16 +69,18 @@ static std::pair<int, int> getAmplitudeRange(
     int low  = std::numeric_limits<int>::max();
     int high = std::numeric_limits<int>::min();
 
-    for (int i = start_index; i != end_index; ++i) {
-        int min = buffer.getMinSample(i);
-        int max = buffer.getMaxSample(i);
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+        for (int i = start_index; i < end_index; ++i) {
+            int min = buffer.getMinSample(i, channel);
+            int max = buffer.getMaxSample(i, channel);
 
-        if (min < low) {
-            low = min;
-        }
+            if (min < low) {
+                low = min;
+            }
 
-        if (max > high) {
-            high = max;
+            if (max > high) {
+                high = max;
+            }
         }
     }
 
@@ -96,11 +108,24 @@ static int scale(int value, double amplitude_scale)
 //------------------------------------------------------------------------------
 
 GdImageRenderer::GdImageRenderer() :
+    GdImageRenderer(output_stream, error_stream)
+{
+}
+
+//------------------------------------------------------------------------------
+
+GdImageRenderer::GdImageRenderer(std::ostream& output, std::ostream& error) :
+    output_(output),
+    error_(error),
     image_(nullptr),
     image_width_(0),
     image_height_(0),
     start_index_(0),
+    lanes_(1),
+    threads_(0),
     render_axis_labels_(true),
+    save_alpha_(false),
+    palette_(false),
     auto_amplitude_scale_(false),
     amplitude_scale_(1.0)
 {
@@ -118,6 +143,31 @@ GdImageRenderer::~GdImageRenderer()
 
 //------------------------------------------------------------------------------
 
+void GdImageRenderer::setThreads(const int threads)
+{
+    threads_ = threads;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the amplitude scale that fits the given region of the buffer to the
+// image height.
+
+double GdImageRenderer::getAutoAmplitudeScale(
+    const WaveformBuffer& buffer,
+    const int start_index,
+    const int end_index)
+{
+    std::pair<int, int> range = getAmplitudeRange(buffer, start_index, end_index);
+
+    double amplitude_scale_high = (range.second == 0) ? 1.0 : 32767.0 / range.second;
+    double amplitude_scale_low  = (range.first  == 0) ? 1.0 : 32767.0 / range.first;
+
+    return std::fabs(std::min(amplitude_scale_high, amplitude_scale_low));
+}
+
+//------------------------------------------------------------------------------
+
 bool GdImageRenderer::create(
     const WaveformBuffer& buffer,
     const double start_time,
@@ -126,31 +176,32 @@ bool GdImageRenderer::create(
     const WaveformColors& colors,
     const bool render_axis_labels,
     const bool auto_amplitude_scale,
-    const double amplitude_scale)
+    const double amplitude_scale,
+    const bool palette)
 {
     if (start_time < 0.0) {
-        error_stream << "Invalid start time: minimum 0\n";
+        error_ << "Invalid start time: minimum 0\n";
         return false;
     }
     else if (start_time > MAX_START_TIME) {
-        error_stream << "Invalid start time: maximum " << MAX_START_TIME << '\n';
+        error_ << "Invalid start time: maximum " << MAX_START_TIME << '\n';
         return false;
     }
 
     if (image_width < 1) {
-        error_stream << "Invalid image width: minimum 1\n";
+        error_ << "Invalid image width: minimum 1\n";
         return false;
     }
 
     if (image_height < 1) {
-        error_stream << "Invalid image height: minimum 1\n";
+        error_ << "Invalid image height: minimum 1\n";
         return false;
     }
 
     const int sample_rate = buffer.getSampleRate();
 
     if (sample_rate > MAX_SAMPLE_RATE) {
-        error_stream << "Invalid sample rate: " << sample_rate
+        error_ << "Invalid sample rate: " << sample_rate
                      << " Hz, maximum " << MAX_SAMPLE_RATE << " Hz\n";
         return false;
     }
@@ -158,15 +209,21 @@ bool GdImageRenderer::create(
     const int samples_per_pixel = buffer.getSamplesPerPixel();
 
     if (samples_per_pixel > MAX_ZOOM) {
-        error_stream << "Invalid zoom: maximum " << MAX_ZOOM << '\n';
+        error_ << "Invalid zoom: maximum " << MAX_ZOOM << '\n';
         return false;
     }
 
-    image_ = gdImageCreateTrueColor(image_width, image_height);
+    // Without axis labels, the image is just the background and the waveform,
+    // so saveAsPng() generates its rows as they're written, rather than
+    // holding the whole image in memory
+    if (render_axis_labels) {
+        image_ = palette ? gdImageCreate(image_width, image_height) :
+                           gdImageCreateTrueColor(image_width, image_height);
 
-    if (image_ == nullptr) {
-        error_stream << "Failed to create image\n";
-        return false;
+        if (image_ == nullptr) {
+            error_ << "Failed to create image\n";
+            return false;
+        }
     }
 
     assert(sample_rate != 0);
@@ -178,11 +235,13 @@ bool GdImageRenderer::create(
     sample_rate_          = buffer.getSampleRate();
     samples_per_pixel_    = samples_per_pixel;
     start_index_          = secondsToPixels(start_time);
+    lanes_                = std::max(buffer.getNumChannels(), 1);
     render_axis_labels_   = render_axis_labels;
     auto_amplitude_scale_ = auto_amplitude_scale;
     amplitude_scale_      = amplitude_scale;
+    palette_              = palette;
 
-    output_stream << "Image dimensions: " << image_width_ << "x" << image_height_ << " pixels"
+    output_ << "Image dimensions: " << image_width_ << "x" << image_height_ << " pixels"
                   << "\nSample rate: " << sample_rate_ << " Hz"
                   << "\nSamples per pixel: " << samples_per_pixel_
                   << "\nStart time: " << start_time_ << " seconds"
@@ -191,21 +250,21 @@ bool GdImageRenderer::create(
                   << "\nAxis labels: " << (render_axis_labels_ ? "yes" : "no")
                   << "\n";
 
-    if (colors.hasAlpha()) {
+    save_alpha_ = colors.hasAlpha();
+
+    if (image_ != nullptr && save_alpha_) {
         gdImageSaveAlpha(image_, 1);
         gdImageAlphaBlending(image_, 0);
     }
 
     initColors(colors);
-    drawBackground();
+    measureWaveform(buffer);
 
-    if (render_axis_labels_) {
-        drawBorder();
-    }
-
-    drawWaveform(buffer);
+    if (image_ != nullptr) {
+        // Also draws the background
+        drawWaveform();
 
-    if (render_axis_labels_) {
+        drawBorder();
         drawTimeAxisLabels();
     }
 
@@ -214,13 +273,18 @@ bool GdImageRenderer::create(
 
 //------------------------------------------------------------------------------
 
+// Colors only need to be allocated in palette images. Otherwise, including
+// when the image is written a row at a time, they're true color values.
+
 int GdImageRenderer::createColor(const RGBA& color)
 {
-    if (color.hasAlpha()) {
-        return gdImageColorAllocateAlpha(image_, color.red, color.green, color.blue, 127 - (color.alpha / 2));
+    const int alpha = color.hasAlpha() ? 127 - (color.alpha / 2) : gdAlphaOpaque;
+
+    if (image_ != nullptr && !gdImageTrueColor(image_)) {
+        return gdImageColorAllocateAlpha(image_, color.red, color.green, color.blue, alpha);
     }
     else {
-        return gdImageColorAllocate(image_, color.red, color.green, color.blue);
+        return gdTrueColorAlpha(color.red, color.green, color.blue, alpha);
     }
 }
 
@@ -236,35 +300,49 @@ void GdImageRenderer::initColors(const WaveformColors& colors)
 
 //------------------------------------------------------------------------------
 
-void GdImageRenderer::drawBackground() const
+void GdImageRenderer::drawBorder() const
 {
-    gdImageFilledRectangle(image_, 0, 0, image_width_ - 1, image_height_ - 1, background_color_);
+    gdImageRectangle(image_, 0, 0, image_width_ - 1, image_height_ - 1, border_color_);
 }
 
 //------------------------------------------------------------------------------
 
-void GdImageRenderer::drawBorder() const
+// Each channel is drawn in its own lane, one above another. Returns the first
+// row of the given lane, or for lane == lanes_, the row after the last lane.
+
+int GdImageRenderer::getLaneTop(const int lane) const
 {
-    gdImageRectangle(image_, 0, 0, image_width_ - 1, image_height_ - 1, border_color_);
+    // Avoid drawing over the top and bottom borders
+    const int top    = render_axis_labels_ ? 1 : 0;
+    const int height = render_axis_labels_ ? image_height_ - 2 : image_height_;
+
+    return top + height * lane / lanes_;
 }
 
 //------------------------------------------------------------------------------
 
-void GdImageRenderer::drawWaveform(const WaveformBuffer& buffer) const
+// Finds the vertical extent of the waveform in each column of each lane of
+// the image.
+
+void GdImageRenderer::measureWaveform(const WaveformBuffer& buffer)
 {
     // Avoid drawing over the right border
     const int max_x = render_axis_labels_ ? image_width_ - 1 : image_width_;
 
-    // Avoid drawing over the top and bottom borders
-    const int wave_bottom_y   = render_axis_labels_ ? image_height_ - 2 : image_height_ - 1;
-    const int max_wave_height = render_axis_labels_ ? image_height_ - 2 : image_height_;
-
     const int buffer_size = buffer.getSize();
 
     // Avoid drawing over the left border
     int start_x     = render_axis_labels_ ? 1 : 0;
     int start_index = render_axis_labels_ ? start_index_ + 1 : start_index_;
 
+    // The buffer may hold only part of the waveform, starting at its offset
+    start_index -= buffer.getOffset();
+
+    if (start_index < 0) {
+        start_x -= start_index;
+        start_index = 0;
+    }
+
     double amplitude_scale;
 
     if (auto_amplitude_scale_) {
@@ -274,32 +352,148 @@ void GdImageRenderer::drawWaveform(const WaveformBuffer& buffer) const
             end_index = buffer_size;
         }
 
-        std::pair<int, int> range = getAmplitudeRange(buffer, start_index, end_index);
-
-        double amplitude_scale_high = (range.second == 0) ? 1.0 : 32767.0 / range.second;
-        double amplitude_scale_low  = (range.first  == 0) ? 1.0 : 32767.0 / range.first;
-
-        amplitude_scale = std::fabs(std::min(amplitude_scale_high, amplitude_scale_low));
+        amplitude_scale = getAutoAmplitudeScale(buffer, start_index, end_index);
     }
     else {
         amplitude_scale = amplitude_scale_;
     }
 
-    output_stream << "Amplitude scale: " << amplitude_scale << '\n';
+    output_ << "Amplitude scale: " << amplitude_scale << '\n';
+
+    // The waveform in each column is drawn from top to bottom inclusive,
+    // and not at all where top is greater than bottom.
+    const size_t width = static_cast<size_t>(image_width_);
+
+    top_.assign(width * static_cast<size_t>(lanes_), 1);
+    bottom_.assign(width * static_cast<size_t>(lanes_), 0);
 
-    int x = start_x;
-    int i = start_index;
+    for (int lane = 0; lane < lanes_; ++lane) {
+        const int wave_bottom_y   = getLaneTop(lane + 1) - 1;
+        const int max_wave_height = getLaneTop(lane + 1) - getLaneTop(lane);
 
-    for (; x < max_x && i < buffer_size; ++i, ++x) {
-        // convert range [-32768, 32727] to [0, 65535]
-        int low  = scale(buffer.getMinSample(i), amplitude_scale) + 32768;
-        int high = scale(buffer.getMaxSample(i), amplitude_scale) + 32768;
+        int* top    = &top_[width * static_cast<size_t>(lane)];
+        int* bottom = &bottom_[width * static_cast<size_t>(lane)];
 
-        // scale to fit the bitmap
-        int low_y  = wave_bottom_y - low  * max_wave_height / 65536;
-        int high_y = wave_bottom_y - high * max_wave_height / 65536;
+        int x = start_x;
+        int i = start_index;
 
-        gdImageLine(image_, x, low_y, x, high_y, waveform_color_);
+        for (; x < max_x && i < buffer_size; ++i, ++x) {
+            // convert range [-32768, 32727] to [0, 65535]
+            int low  = scale(buffer.getMinSample(i, lane), amplitude_scale) + 32768;
+            int high = scale(buffer.getMaxSample(i, lane), amplitude_scale) + 32768;
+
+            // scale to fit the bitmap
+            int low_y  = wave_bottom_y - low  * max_wave_height / 65536;
+            int high_y = wave_bottom_y - high * max_wave_height / 65536;
+
+            // Clipped to the image, as gdImageLine() would
+            top[x]    = std::max(std::min(low_y, high_y), 0);
+            bottom[x] = std::min(std::max(low_y, high_y), image_height_ - 1);
+        }
+    }
+
+    // The lane of each row, including any border rows, which belong to the
+    // nearest lane
+    row_lanes_.resize(static_cast<size_t>(image_height_));
+
+    for (int y = 0, lane = 0; y < image_height_; ++y) {
+        while (lane < lanes_ - 1 && y >= getLaneTop(lane + 1)) {
+            lane++;
+        }
+
+        row_lanes_[static_cast<size_t>(y)] = lane;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Writes every pixel of the image directly: the waveform color within each
+// column's extent, and the background color elsewhere. This gives the same
+// result as drawing a gdImageLine() per column over a filled background, as
+// all colors are opaque unless alpha blending is disabled. Each lane is drawn
+// concurrently, and wide images are also split into bands of columns, but
+// each thread is given at least MIN_BAND_WIDTH columns, so small images are
+// drawn on the calling thread.
+
+void GdImageRenderer::drawWaveform() const
+{
+    const int threads = threads_ > 0 ? threads_ :
+        static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+    const int bands = std::max(std::min(threads, image_width_ / MIN_BAND_WIDTH), 1);
+
+    const int tasks = lanes_ * bands;
+
+    const int64_t columns = static_cast<int64_t>(image_width_) * lanes_;
+
+    const int draw_threads = static_cast<int>(std::max<int64_t>(
+        std::min<int64_t>(std::min(threads, tasks), columns / MIN_BAND_WIDTH), 1
+    ));
+
+    std::atomic<int> next_task(0);
+
+    auto fill_bands = [&]() {
+        for (int task = next_task++; task < tasks; task = next_task++) {
+            const int lane = task / bands;
+            const int band = task % bands;
+
+            const int start_x = image_width_ * band / bands;
+            const int end_x   = image_width_ * (band + 1) / bands;
+
+            // Border rows are filled with the nearest lane
+            const int start_y = lane == 0 ? 0 : getLaneTop(lane);
+            const int end_y   = lane == lanes_ - 1 ? image_height_ : getLaneTop(lane + 1);
+
+            if (gdImageTrueColor(image_)) {
+                fillRegion(image_->tpixels, lane, start_x, end_x, start_y, end_y);
+            }
+            else {
+                fillRegion(image_->pixels, lane, start_x, end_x, start_y, end_y);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (int thread = 1; thread < draw_threads; ++thread) {
+        workers.emplace_back(fill_bands);
+    }
+
+    fill_bands();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Fills the given region of one lane of either a true color or palette image.
+
+template<typename T>
+void GdImageRenderer::fillRegion(
+    T** rows,
+    const int lane,
+    const int start_x,
+    const int end_x,
+    const int start_y,
+    const int end_y) const
+{
+    const T waveform_color   = static_cast<T>(waveform_color_);
+    const T background_color = static_cast<T>(background_color_);
+
+    const size_t offset = static_cast<size_t>(image_width_) * static_cast<size_t>(lane);
+
+    const int* top    = &top_[offset];
+    const int* bottom = &bottom_[offset];
+
+    for (int y = start_y; y < end_y; ++y) {
+        T* row = rows[y];
+
+        for (int x = start_x; x < end_x; ++x) {
+            const bool inside = top[x] <= y && y <= bottom[x];
+
+            row[x] = inside ? waveform_color : background_color;
+        }
     }
 }
 
@@ -416,16 +610,20 @@ bool GdImageRenderer::saveAsPng(
     FILE* output_file = fopen(filename, "wb");
 
     if (output_file != nullptr) {
-        output_stream << "Writing PNG file: " << filename
+        output_ << "Writing PNG file: " << filename
 		              << std::endl << std::endl;
 
-        gdImagePngEx(image_, output_file, compression_level);
+        success = saveAsPng(output_file, compression_level);
 
         fclose(output_file);
         output_file = nullptr;
+
+        if (!success) {
+            error_ << "Failed to write PNG file: " << filename << '\n';
+        }
     }
     else {
-        error_stream << "Failed to write PNG file: " << filename << '\n'
+        error_ << "Failed to write PNG file: " << filename << '\n'
                      << strerror(errno) << '\n';
 
         success = false;
@@ -436,9 +634,232 @@ bool GdImageRenderer::saveAsPng(
 
 //------------------------------------------------------------------------------
 
+// Writes the image to a file that's already open, such as standard output.
+
+bool GdImageRenderer::saveAsPng(
+    FILE* output_file,
+    const int compression_level) const
+{
+    if (image_ != nullptr) {
+        gdImagePngEx(image_, output_file, compression_level);
+
+        return ferror(output_file) == 0;
+    }
+
+    auto output = [output_file](const uint8_t* data, size_t size) {
+        return fwrite(data, size, 1, output_file) == 1;
+    };
+
+    return writePngRows(output, compression_level);
+}
+
+//------------------------------------------------------------------------------
+
+// Encodes the image into the given buffer, rather than writing it to a file.
+
+bool GdImageRenderer::saveAsPng(
+    std::vector<uint8_t>& data,
+    const int compression_level) const
+{
+    data.clear();
+
+    if (image_ != nullptr) {
+        int size = 0;
+
+        void* png = gdImagePngPtrEx(image_, &size, compression_level);
+
+        if (png == nullptr) {
+            error_ << "Failed to encode PNG image\n";
+            return false;
+        }
+
+        const uint8_t* begin = static_cast<const uint8_t*>(png);
+        data.assign(begin, begin + size);
+
+        gdFree(png);
+
+        return true;
+    }
+
+    auto output = [&data](const uint8_t* bytes, size_t size) {
+        data.insert(data.end(), bytes, bytes + size);
+        return true;
+    };
+
+    if (!writePngRows(output, compression_level)) {
+        error_ << "Failed to encode PNG image\n";
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the waveform's top and bottom in each column of the lane that holds
+// the given row.
+
+const int* GdImageRenderer::getLaneTops(const int y) const
+{
+    const size_t lane = static_cast<size_t>(row_lanes_[static_cast<size_t>(y)]);
+
+    return &top_[lane * static_cast<size_t>(image_width_)];
+}
+
+const int* GdImageRenderer::getLaneBottoms(const int y) const
+{
+    const size_t lane = static_cast<size_t>(row_lanes_[static_cast<size_t>(y)]);
+
+    return &bottom_[lane * static_cast<size_t>(image_width_)];
+}
+
+//------------------------------------------------------------------------------
+
+// Converts a true color value to an 8-bit RGBA pixel, as gdImagePng() does.
+
+static void getPngPixel(const int color, uint8_t* pixel)
+{
+    const int alpha = gdTrueColorGetAlpha(color);
+
+    pixel[0] = static_cast<uint8_t>(gdTrueColorGetRed(color));
+    pixel[1] = static_cast<uint8_t>(gdTrueColorGetGreen(color));
+    pixel[2] = static_cast<uint8_t>(gdTrueColorGetBlue(color));
+    pixel[3] = static_cast<uint8_t>(255 - ((alpha << 1) + (alpha >> 6)));
+}
+
+//------------------------------------------------------------------------------
+
+// Writes the image without holding it in memory, generating each row from the
+// waveform's extent in each column. Memory use depends only on the width.
+
+bool GdImageRenderer::writePngRows(
+    const PngStreamWriter::Output& output,
+    const int compression_level) const
+{
+    if (palette_) {
+        return writePngPaletteRows(output, compression_level);
+    }
+
+    const size_t channels = save_alpha_ ? 4 : 3;
+
+    uint8_t background[4];
+    uint8_t waveform[4];
+
+    getPngPixel(background_color_, background);
+    getPngPixel(waveform_color_, waveform);
+
+    auto generate_row = [&](int y, uint8_t* row) {
+        const int* top    = getLaneTops(y);
+        const int* bottom = getLaneBottoms(y);
+
+        for (size_t x = 0; x < static_cast<size_t>(image_width_); ++x) {
+            const bool inside = top[x] <= y && y <= bottom[x];
+            const uint8_t* pixel = inside ? waveform : background;
+
+            std::copy(pixel, pixel + channels, row + x * channels);
+        }
+    };
+
+    PngStreamWriter writer(image_width_, image_height_, save_alpha_);
+
+    return writer.write(output, generate_row, compression_level);
+}
+
+//------------------------------------------------------------------------------
+
+// As writePngRows(), but with a two color palette, so one bit per pixel.
+
+bool GdImageRenderer::writePngPaletteRows(
+    const PngStreamWriter::Output& output,
+    const int compression_level) const
+{
+    const uint8_t BACKGROUND_INDEX = 0;
+    const uint8_t WAVEFORM_INDEX   = 1;
+
+    std::vector<RGBA> palette;
+
+    for (const int color : { background_color_, waveform_color_ }) {
+        uint8_t pixel[4];
+        getPngPixel(color, pixel);
+
+        palette.push_back(RGBA(pixel[0], pixel[1], pixel[2], pixel[3]));
+    }
+
+    auto generate_row = [&](int y, uint8_t* row) {
+        const int* top    = getLaneTops(y);
+        const int* bottom = getLaneBottoms(y);
+
+        for (size_t x = 0; x < static_cast<size_t>(image_width_); ++x) {
+            const bool inside = top[x] <= y && y <= bottom[x];
+
+            row[x] = inside ? WAVEFORM_INDEX : BACKGROUND_INDEX;
+        }
+    };
+
+    PngStreamWriter writer(image_width_, image_height_, palette);
+
+    return writer.write(output, generate_row, compression_level);
+}
+
+//------------------------------------------------------------------------------
+
 int GdImageRenderer::secondsToPixels(const double seconds) const
 {
     return static_cast<int>(seconds * sample_rate_ / samples_per_pixel_);
 }
 
 //------------------------------------------------------------------------------
+
+bool renderImagesConcurrently(
+    const int image_count,
+    const std::function<bool(int index, GdImageRenderer& renderer)>& render)
+{
+    const int threads = std::max(
+        std::min(static_cast<int>(std::thread::hardware_concurrency()), image_count), 1
+    );
+
+    std::vector<std::ostringstream> errors(static_cast<size_t>(threads));
+
+    std::atomic<int> next_image(0);
+    std::atomic<bool> failed(false);
+
+    auto render_images = [&](int thread) {
+        std::ostream& error = errors[static_cast<size_t>(thread)];
+
+        // Discards progress messages
+        std::ostream output(nullptr);
+
+        for (int i = next_image++; i < image_count && !failed; i = next_image++) {
+            GdImageRenderer renderer(output, error);
+
+            // The images are already drawn concurrently
+            if (threads > 1) {
+                renderer.setThreads(1);
+            }
+
+            if (!render(i, renderer)) {
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (int thread = 1; thread < threads; ++thread) {
+        workers.emplace_back(render_images, thread);
+    }
+
+    render_images(0);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (const auto& error : errors) {
+        error_stream << error.str();
+    }
+
+    return !failed;
+}
+
+//------------------------------------------------------------------------------
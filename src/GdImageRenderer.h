@@ -26,8 +26,16 @@
 
 //------------------------------------------------------------------------------
 
+#include "PngStreamWriter.h"
+
 #include <gd.h>
 
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
 //------------------------------------------------------------------------------
 
 class RGBA;
@@ -40,6 +48,12 @@ class GdImageRenderer
 {
     public:
         GdImageRenderer();
+
+        // Writes progress and error messages to the given streams, rather than
+        // to output_stream and error_stream, e.g., when rendering from several
+        // threads.
+        GdImageRenderer(std::ostream& output, std::ostream& error);
+
         ~GdImageRenderer();
 
         GdImageRenderer(const GdImageRenderer&) = delete;
@@ -54,23 +68,60 @@ class GdImageRenderer
             const WaveformColors& colors,
             bool render_axis_labels,
             bool auto_amplitude_scale,
-            double amplitude_scale
+            double amplitude_scale,
+            bool palette = false
         );
 
         int createColor(const RGBA& color);
 
+        // Sets the number of threads that draw the waveform, or 0, the
+        // default, for one per hardware thread. Must be called before
+        // create().
+        void setThreads(int threads);
+
+        static double getAutoAmplitudeScale(
+            const WaveformBuffer& buffer,
+            int start_index,
+            int end_index
+        );
+
         bool saveAsPng(
             const char* filename,
             int compression_level = -1
         ) const;
 
+        bool saveAsPng(
+            FILE* output_file,
+            int compression_level = -1
+        ) const;
+
+        bool saveAsPng(
+            std::vector<uint8_t>& data,
+            int compression_level = -1
+        ) const;
+
     private:
         void initColors(const WaveformColors& colors);
 
-        void drawBackground() const;
         void drawBorder() const;
 
-        void drawWaveform(const WaveformBuffer& buffer) const;
+        int getLaneTop(int lane) const;
+
+        void measureWaveform(const WaveformBuffer& buffer);
+        void drawWaveform() const;
+
+        template<typename T>
+        void fillRegion(
+            T** rows,
+            int lane,
+            int start_x,
+            int end_x,
+            int start_y,
+            int end_y
+        ) const;
+
+        const int* getLaneTops(int y) const;
+        const int* getLaneBottoms(int y) const;
 
         void drawTimeAxisLabels() const;
 
@@ -84,7 +135,20 @@ class GdImageRenderer
 
         int secondsToPixels(const double seconds) const;
 
+        bool writePngRows(
+            const PngStreamWriter::Output& output,
+            int compression_level
+        ) const;
+
+        bool writePngPaletteRows(
+            const PngStreamWriter::Output& output,
+            int compression_level
+        ) const;
+
     private:
+        std::ostream& output_;
+        std::ostream& error_;
+
         gdImagePtr image_;
         int image_width_;
         int image_height_;
@@ -94,12 +158,26 @@ class GdImageRenderer
         int samples_per_pixel_;
         int start_index_;
 
+        // Number of channels, each drawn in its own lane
+        int lanes_;
+
+        int threads_;
+
         int border_color_;
         int background_color_;
         int waveform_color_;
         int axis_label_color_;
 
         bool render_axis_labels_;
+        bool save_alpha_;
+        bool palette_;
+
+        // Vertical extent of the waveform in each column of each lane
+        std::vector<int> top_;
+        std::vector<int> bottom_;
+
+        // Lane that each row of the image belongs to
+        std::vector<int> row_lanes_;
 
         bool auto_amplitude_scale_;
         double amplitude_scale_;
@@ -107,6 +185,20 @@ class GdImageRenderer
 
 //------------------------------------------------------------------------------
 
+// Renders the given number of images concurrently, calling render() with each
+// image index and a renderer of its own, which discards progress messages. If
+// there is more than one thread, each renderer draws on its own thread only.
+// Each thread's error messages are written to error_stream once all threads
+// have finished. Returns false if any image failed, after which no more are
+// started.
+
+bool renderImagesConcurrently(
+    int image_count,
+    const std::function<bool(int index, GdImageRenderer& renderer)>& render
+);
+
+//------------------------------------------------------------------------------
+
 #endif // #if !defined(INC_GD_IMAGE_RENDERER_H)
 
 //------------------------------------------------------------------------------
@@ -23,6 +23,8 @@
 #include "Streams.h"
 #include "WaveformBuffer.h"
 #include "Options.h"
+#include "TextFormat.h"
+#include "Utils.h"
 
 JsonFileExporter::JsonFileExporter(WaveformBuffer& buffer,
                                    const Options& options,
@@ -33,92 +35,362 @@ JsonFileExporter::JsonFileExporter(WaveformBuffer& buffer,
 
 //------------------------------------------------------------------------------
 
+JsonFileExporter::~JsonFileExporter()
+{
+	// Only left behind if the export failed
+	removeSpoolFiles();
+}
+
+//------------------------------------------------------------------------------
+
+// Writes the whole buffer. All the points are in memory, so each channel is
+// written straight to the output.
+
 void JsonFileExporter::writeFile(std::ofstream& stream)
 {
-	FILE_VERSION version = static_cast<FILE_VERSION>(options_.getFileVersion());
+	UNUSED(stream);
+
+	if (FileExporter::VERSION_3 == version_) {
+		throwErrorEx("JsonFileExporter::writeFile",
+		             "file version 3 is only available for .dat files",
+		             output_filename_.string());
+	}
+
+	channels_ = buffer_.getNumChannels();
+	sizes_.assign(static_cast<size_t>(channels_), 0);
+
+	// Version 1 files hold one channel each
+	const int outputs = (FileExporter::VERSION_1 == version_) ?
+	                    channels_ : std::min(channels_, 1);
+
+	for (int output = 0; output < outputs; ++output) {
+		std::string filename;
+		std::unique_ptr<std::ostream> file = openFile(output, filename);
+
+		output_stream << "Writing header to output file: " << filename << std::endl;
+		writeHeader(*file, buffer_.getSize(output));
+
+		const int last_chan = (FileExporter::VERSION_1 == version_) ? output : channels_ - 1;
+
+		for (int chan = output; chan <= last_chan; ++chan) {
+			output_stream << "Writing channel " << std::to_string(chan)
+			              << " to output file: " << filename << std::endl;
+			writeDataStart(*file, chan, filename);
+			ChunkedTextWriter writer(*file, 2 * TextFormat::MAX_INT_LENGTH + 2);
+			writePoints(writer, *file, chan);
+			writeDataEnd(*file, chan);
+		}
+
+		output_stream << "Writing footer to output file: " << filename << std::endl;
+		writeFooter(*file);
+		closeFile(file);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::beginOutput(int channels)
+{
+	if (FileExporter::VERSION_3 == version_) {
+		throwErrorEx("JsonFileExporter::beginOutput",
+		             "file version 3 is only available for .dat files",
+		             output_filename_.string());
+	}
+
+	removeSpoolFiles();
+	outputs_.clear();
+	output_filenames_.clear();
+
+	channels_ = channels;
+	sizes_.assign(static_cast<size_t>(channels_), 0);
+	spools_.resize(static_cast<size_t>(channels_));
+
+	if (length_ >= 0) {
+		// Version 1 files hold one channel each
+		const int outputs = (FileExporter::VERSION_1 == version_) ?
+		                    channels_ : std::min(channels_, 1);
+
+		for (int output = 0; output < outputs; ++output) {
+			openOutput(output, length_);
+		}
+	}
+
+	for (int chan = 0; chan < channels_; ++chan) {
+		if (length_ < 0 || (FileExporter::VERSION_2 == version_ && chan > 0)) {
+			openSpool(chan);
+		}
+
+		writers_.emplace_back(
+		    new ChunkedTextWriter(getDataStream(chan), 2 * TextFormat::MAX_INT_LENGTH + 2));
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Opens the given output file, and writes its header and the start of its
+// first channel's data.
+
+void JsonFileExporter::openOutput(int output, int32_t length)
+{
 	std::string filename;
-	switch (version) {
-		case FileExporter::VERSION_1: {
-			for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
-				if (openFile(stream, chan, filename)) {
-					output_stream << "Writing header to output file: " << filename << std::endl;
-					writeHeader(stream, chan, version);
-					output_stream << "Writing channel " << std::to_string(chan) 
+	outputs_.push_back(openFile(output, filename));
+	output_filenames_.push_back(filename);
+
+	std::ostream& stream = *outputs_.back();
+
+	output_stream << "Writing header to output file: " << filename << std::endl;
+	writeHeader(stream, length);
+	output_stream << "Writing channel " << std::to_string(output)
+	              << " to output file: " << filename << std::endl;
+	writeDataStart(stream, output, filename);
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::openSpool(int chan)
+{
+	spool_filenames_.push_back(
+	    fs::temp_directory_path() /
+	    fs::unique_path("audiowaveform-%%%%-%%%%-%%%%-%%%%.tmp"));
+
+	std::unique_ptr<std::fstream>& spool = spools_[static_cast<size_t>(chan)];
+	spool.reset(new std::fstream);
+	spool->exceptions(std::ios::badbit | std::ios::failbit);
+
+	try {
+		spool->open(spool_filenames_.back().string(),
+		            std::ios::in | std::ios::out |
+		            std::ios::trunc | std::ios::binary);
+	} catch (std::exception& e) {
+		throwErrorEx("JsonFileExporter::openSpool", e.what(),
+		             spool_filenames_.back().string());
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the stream the given channel's points are written to: its spool
+// file, or else its output file.
+
+std::ostream& JsonFileExporter::getDataStream(int chan)
+{
+	const std::unique_ptr<std::fstream>& spool = spools_[static_cast<size_t>(chan)];
+
+	if (spool) {
+		return *spool;
+	}
+
+	return *outputs_[(FileExporter::VERSION_1 == version_) ? static_cast<size_t>(chan) : 0];
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::writeOutput()
+{
+	for (int chan = 0; chan < channels_ && chan < buffer_.getNumChannels(); ++chan) {
+		writePoints(*writers_[chan], getDataStream(chan), chan);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Writes the points held in the buffer for the given channel, following any
+// already written.
+
+void JsonFileExporter::writePoints(ChunkedTextWriter& writer,
+                                   std::ostream& stream,
+                                   int chan)
+{
+	const int divisor = ((bits_ == 8) ? 256 : 1);
+
+	const int32_t size = buffer_.getSize(chan);
+	if (size > 0) {
+		const bool first = (sizes_[chan] == 0);
+		if (first) {
+			stream << "\t\t";
+		}
+		// Each point is written as ",min,max", except the very first
+		// which has no leading separator.
+		writer.write(static_cast<size_t>(size),
+		             [&](size_t i, char* output) {
+			if (i != 0 || !first) {
+				*output++ = ',';
+			}
+			output = TextFormat::formatInt(output, buffer_.getMinSample(i, chan) / divisor);
+			*output++ = ',';
+			return TextFormat::formatInt(output, buffer_.getMaxSample(i, chan) / divisor);
+		});
+		sizes_[chan] += size;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::finishOutput()
+{
+	writers_.clear();
+
+	if (length_ >= 0) {
+		// The headers have been written, and the first channel of each file
+		// written directly. Any other channels are copied from their spool
+		// files.
+		for (size_t output = 0; output < outputs_.size(); ++output) {
+			std::ostream& stream = *outputs_[output];
+			const std::string& filename = output_filenames_[output];
+			const int first_chan = static_cast<int>(output);
+
+			checkLength(first_chan);
+			writeDataEnd(stream, first_chan);
+
+			if (FileExporter::VERSION_2 == version_) {
+				for (int chan = 1; chan < channels_; ++chan) {
+					output_stream << "Writing channel " << std::to_string(chan)
 					              << " to output file: " << filename << std::endl;
-					writeData(stream, chan, version, filename);
-					output_stream << "Writing footer to output file: " << filename << std::endl;
-					writeFooter(stream);
-					closeFile(stream);
+					writeData(stream, chan, filename);
 				}
 			}
-		} break;
-		case FileExporter::VERSION_2: {
-			if (openFile(stream, 0, filename)) {
+
+			output_stream << "Writing footer to output file: " << filename << std::endl;
+			writeFooter(stream);
+			closeFile(outputs_[output]);
+		}
+
+		outputs_.clear();
+		removeSpoolFiles();
+		return;
+	}
+
+	std::unique_ptr<std::ostream> stream;
+	std::string filename;
+	switch (version_) {
+		case FileExporter::VERSION_1: {
+			for (int chan = 0; chan < channels_; ++chan) {
+				stream = openFile(chan, filename);
 				output_stream << "Writing header to output file: " << filename << std::endl;
-				writeHeader(stream, 0, version);
-				for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
-					output_stream << "Writing channel " << std::to_string(chan) 
-					              << " to output file: " << filename << std::endl;
-					writeData(stream, chan, version, filename);
-				}
+				writeHeader(*stream, sizes_[chan]);
+				output_stream << "Writing channel " << std::to_string(chan) 
+				              << " to output file: " << filename << std::endl;
+				writeData(*stream, chan, filename);
 				output_stream << "Writing footer to output file: " << filename << std::endl;
-				writeFooter(stream);
+				writeFooter(*stream);
 				closeFile(stream);
 			}
 		} break;
+		case FileExporter::VERSION_2: {
+			stream = openFile(0, filename);
+			output_stream << "Writing header to output file: " << filename << std::endl;
+			writeHeader(*stream, channels_ > 0 ? sizes_[0] : 0);
+			for (int chan = 0; chan < channels_; ++chan) {
+				output_stream << "Writing channel " << std::to_string(chan) 
+				              << " to output file: " << filename << std::endl;
+				writeData(*stream, chan, filename);
+			}
+			output_stream << "Writing footer to output file: " << filename << std::endl;
+			writeFooter(*stream);
+			closeFile(stream);
+		} break;
 		default: 
-			throwErrorEx("JsonFileExporter::writeFile", "unknown file version " + 
-			             std::to_string(version), filename);
+			throwErrorEx("JsonFileExporter::finishOutput", "unknown file version " + 
+			             std::to_string(version_), filename);
 	}
+
+	removeSpoolFiles();
 }
 
 //------------------------------------------------------------------------------
 
-void JsonFileExporter::writeHeader(std::ofstream& stream, int chan, FILE_VERSION version)
+void JsonFileExporter::writeHeader(std::ostream& stream, int32_t length)
 {
-	stream << "{" << std::endl << "\t\"sample_rate\":" << buffer_.getSampleRate() << ',' << std::endl
-		   << "\t\"samples_per_pixel\":" << buffer_.getSamplesPerPixel() << ',' << std::endl
-		   << "\t\"channels\":" << buffer_.getNumChannels() << ',' << std::endl
-		   << "\t\"bits\":" << buffer_.getBits() << ',' << std::endl
-		   << "\t\"length\":" << buffer_.getSize(chan) << ',' << std::endl
-		   << "\t\"version\":" << version << ',' << std::endl;
+	stream << "{\n\t\"sample_rate\":" << buffer_.getSampleRate() << ",\n"
+		   << "\t\"samples_per_pixel\":" << buffer_.getSamplesPerPixel() << ",\n"
+		   << "\t\"channels\":" << channels_ << ",\n"
+		   << "\t\"bits\":" << bits_ << ",\n"
+		   << "\t\"length\":" << length << ",\n"
+		   << "\t\"version\":" << version_ << ",\n";
 }
 
-void JsonFileExporter::writeData(std::ofstream& stream, int chan, 
-                                 FILE_VERSION version, std::string filename)
+//------------------------------------------------------------------------------
+
+// Writes the start of the array of points for the given channel.
+
+void JsonFileExporter::writeDataStart(std::ostream& stream, int chan,
+                                      std::string filename)
 {
-	int divisor = ((buffer_.getBits() == 8) ? 256 : 1);
-	int num_chan = buffer_.getNumChannels();
-	if (num_chan > chan) {
-		switch (version) {
-			case FileExporter::VERSION_1: stream << "\t\"data\":[" << std::endl; break;
-			case FileExporter::VERSION_2: stream << "\t\"chan" << chan << "\":[" << std::endl; break;
+	if (channels_ > chan) {
+		switch (version_) {
+			case FileExporter::VERSION_1: stream << "\t\"data\":[\n"; break;
+			case FileExporter::VERSION_2: stream << "\t\"chan" << chan << "\":[\n"; break;
 			default:
 				throwErrorEx("JsonFileExporter::writeData", "unknown file version " +
-				             std::to_string(version), filename);
-		}
-		int chanBufferSize = buffer_.getSize(chan);
-		if (chanBufferSize > 0) {
-			stream << "\t\t" << (buffer_.getMinSample(0, chan) / divisor) 
-				   << ','  << (buffer_.getMaxSample(0, chan) / divisor);
-			for (int i = 1; i < chanBufferSize; ++i) {
-				stream << ',' << (buffer_.getMinSample(i, chan) / divisor) 
-					   << ',' << (buffer_.getMaxSample(i, chan) / divisor);
-			}
+				             std::to_string(version_), filename);
 		}
-		stream << std::endl << "\t]" << (((chan+1) < num_chan) ? "," : "") << std::endl;
 		return;
 	}
 	throwErrorEx("JsonFileExporter::writeData", 
 	             "Channel " + std::to_string(chan) + "does not exist.", filename);
 }
 
-void JsonFileExporter::writeFooter(std::ofstream& stream)
+//------------------------------------------------------------------------------
+
+// Writes the array of points for the given channel, copied from its spool
+// file.
+
+void JsonFileExporter::writeData(std::ostream& stream, int chan,
+                                 std::string filename)
+{
+	writeDataStart(stream, chan, filename);
+	if (sizes_[chan] > 0) {
+		std::fstream& spool = *spools_[static_cast<size_t>(chan)];
+		spool.flush();
+		spool.seekg(0);
+		stream << spool.rdbuf();
+	}
+	writeDataEnd(stream, chan);
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::writeDataEnd(std::ostream& stream, int chan)
+{
+	// Version 1 files hold a single channel, so only version 2 has
+	// more arrays to follow.
+	const bool more = (FileExporter::VERSION_2 == version_) && ((chan+1) < channels_);
+	stream << "\n\t]" << (more ? "," : "") << '\n';
+}
+
+//------------------------------------------------------------------------------
+
+// Checks that the number of points written for the given channel matches the
+// length already written in its header.
+
+void JsonFileExporter::checkLength(int chan)
 {
-	if (stream.is_open()) {
-		stream << '}' << std::endl;
-		closeFile(stream);
+	if (sizes_[chan] != length_) {
+		throwErrorEx("JsonFileExporter::finishOutput",
+		             "wrote " + std::to_string(sizes_[chan]) + " points, expected " +
+		             std::to_string(length_), output_filename_.string());
 	}
 }
 
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::writeFooter(std::ostream& stream)
+{
+	stream << "}\n";
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileExporter::removeSpoolFiles()
+{
+	writers_.clear();
+	spools_.clear();
+
+	for (const auto& spool_filename : spool_filenames_) {
+		boost::system::error_code error;
+		fs::remove(spool_filename, error);
+	}
+	spool_filenames_.clear();
+}
 
+//------------------------------------------------------------------------------
@@ -23,6 +23,11 @@
 #define INC_JSON_FILE_EXPORTER_H
 
 #include "FileExporter.h"
+#include "TextFormat.h"
+
+#include <fstream>
+#include <memory>
+#include <vector>
 
 class JsonFileExporter: public FileExporter
 {
@@ -30,7 +35,7 @@ class JsonFileExporter: public FileExporter
 		JsonFileExporter(WaveformBuffer &buffer,
 		                 const Options &options,
 						 const fs::path& output_filename);
-		~JsonFileExporter() = default;
+		~JsonFileExporter();
 		
 		JsonFileExporter() = delete;
 		JsonFileExporter(JsonFileExporter &&) = delete;
@@ -38,13 +43,38 @@ class JsonFileExporter: public FileExporter
 		JsonFileExporter& operator=(const JsonFileExporter &) = delete;
 
 	private:
-	    void writeFile(std::ofstream& stream);
-		
-		void writeHeader(std::ofstream& stream, int chan, FILE_VERSION version);
-		void writeData(std::ofstream& stream, int chan,
-		               FILE_VERSION version, std::string filename);
-		void writeFooter(std::ofstream& stream);
+		void writeFile(std::ofstream& stream);
+
+		void beginOutput(int channels);
+		void writeOutput();
+		void finishOutput();
+
+		void openOutput(int output, int32_t length);
+		void openSpool(int chan);
+		std::ostream& getDataStream(int chan);
+
+		void writeHeader(std::ostream& stream, int32_t length);
+		void writeDataStart(std::ostream& stream, int chan, std::string filename);
+		void writeData(std::ostream& stream, int chan, std::string filename);
+		void writeDataEnd(std::ostream& stream, int chan);
+		void writeFooter(std::ostream& stream);
+
+		void writePoints(ChunkedTextWriter& writer, std::ostream& stream, int chan);
+		void checkLength(int chan);
+		void removeSpoolFiles();
 
+		// The length is written before the data. A whole buffer is written
+		// directly by writeFile(). If the length was given to begin(),
+		// the header is written first and points go straight to the output
+		// files, except for the channels after the first in a version 2 file.
+		// Otherwise, each channel's points are spooled to a temporary file
+		// until the total is known.
+		std::vector<std::unique_ptr<std::ostream>> outputs_;
+		std::vector<std::string> output_filenames_;
+		std::vector<fs::path> spool_filenames_;
+		std::vector<std::unique_ptr<std::fstream>> spools_; // null if not spooled
+		std::vector<std::unique_ptr<ChunkedTextWriter>> writers_;
+		std::vector<int32_t> sizes_;
 };
 
 #endif
\ No newline at end of file
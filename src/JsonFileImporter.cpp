@@ -0,0 +1,453 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "JsonFileImporter.h"
+#include "MappedFile.h"
+#include "Streams.h"
+#include "WaveformBuffer.h"
+#include "Utils.h"
+#include "Options.h"
+
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+
+// The digit scan below loads 8 characters at a time into an integer, with the
+// first character in the lowest byte.
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+static const bool LITTLE_ENDIAN_HOST = false;
+#else
+static const bool LITTLE_ENDIAN_HOST = true;
+#endif
+
+//------------------------------------------------------------------------------
+
+// Returns the index of the lowest non-zero byte in value, which must not be
+// zero.
+
+static inline unsigned lowestByte(uint64_t value)
+{
+#if defined(__GNUC__)
+	return static_cast<unsigned>(__builtin_ctzll(value)) / 8;
+#else
+	unsigned index = 0;
+	while ((value & 0xFF) == 0) {
+		value >>= 8;
+		++index;
+	}
+	return index;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the number of leading decimal digits in the 8 characters held in
+// value, testing all 8 at once.
+
+static inline unsigned countDigits(uint64_t value)
+{
+	// Only '0' to '9' (0x30 to 0x39) have a high nibble of 3 both before and
+	// after adding 6, so their bytes become 0x33.
+	const uint64_t nibbles = (value & 0xF0F0F0F0F0F0F0F0U) |
+	                         (((value + 0x0606060606060606U) & 0xF0F0F0F0F0F0F0F0U) >> 4);
+
+	// Set the high bit of each byte that isn't a digit
+	const uint64_t other = nibbles ^ 0x3333333333333333U;
+	const uint64_t mask = (((other & 0x7F7F7F7F7F7F7F7FU) + 0x7F7F7F7F7F7F7F7FU) | other) &
+	                      0x8080808080808080U;
+
+	return mask == 0 ? 8 : lowestByte(mask);
+}
+
+//------------------------------------------------------------------------------
+
+// Converts 8 characters of decimal digits to their value, with the first
+// character the most significant. Zero bytes are treated as '0'.
+
+static inline uint32_t convertDigits(uint64_t value)
+{
+	value = ((value & 0x0F0F0F0F0F0F0F0FU) * 2561) >> 8;
+	value = ((value & 0x00FF00FF00FF00FFU) * 6553601) >> 16;
+
+	return static_cast<uint32_t>(((value & 0x0000FFFF0000FFFFU) * 42949672960001U) >> 32);
+}
+
+//------------------------------------------------------------------------------
+
+JsonFileImporter::JsonFileImporter(WaveformBuffer &buffer,
+                                   const Options &options,
+                                   const fs::path& input_filename,
+                                   FileExporter* exporter) :
+	FileImporter(buffer, options, input_filename, exporter),
+	begin_(nullptr),
+	pos_(nullptr),
+	end_(nullptr),
+	length_(-1),
+	bits_(0),
+	mono_(false)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileImporter::readFile(std::ifstream& stream)
+{
+	const std::string filename = input_filename_.string();
+
+	MappedFile mapped_file;
+	std::string contents;
+
+	if (mapped_file.open(filename.c_str())) {
+		begin_ = reinterpret_cast<const char*>(mapped_file.data());
+		end_ = begin_ + mapped_file.size();
+	} else {
+		try {
+			stream.open(filename, std::ios::in | std::ios::binary);
+			contents.assign(std::istreambuf_iterator<char>(stream),
+			                std::istreambuf_iterator<char>());
+		} catch (std::exception& e) {
+			throwErrorEx("JsonFileImporter::readFile", strerror(errno), filename);
+		}
+		begin_ = contents.data();
+		end_ = begin_ + contents.size();
+	}
+
+	pos_ = begin_;
+
+	parse();
+
+	// All points are already in the buffer, so are written in one go.
+	if (exporter_ != nullptr) {
+		exporter_->ExportToFile();
+		buffer_.setSize(0);
+	}
+
+	output_stream << "Completed import of " << input_filename_
+	              << ".  Total points: " << length_ << std::endl;
+
+	begin_ = pos_ = end_ = nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileImporter::parse()
+{
+	int sample_rate = 0;
+	int samples_per_pixel = 0;
+	int channels = 0;
+	int arrays = 0;
+
+	length_ = -1;
+	bits_ = 0;
+	mono_ = false;
+
+	skipSpace();
+	expect('{');
+	skipSpace();
+
+	while (pos_ < end_ && *pos_ != '}') {
+		const std::string key = parseKey();
+		skipSpace();
+		expect(':');
+		skipSpace();
+
+		const bool is_channel = key.size() > 4 && key.compare(0, 4, "chan") == 0 &&
+		                        key.find_first_not_of("0123456789", 4) == std::string::npos;
+
+		if (key == "data" || is_channel) {
+			int chan = 0;
+
+			if (is_channel) {
+				try {
+					chan = std::stoi(key.substr(4));
+				}
+				catch (const std::out_of_range&) {
+					parseError("unexpected field: " + key);
+				}
+			}
+
+			if (chan != arrays) {
+				parseError("unexpected field: " + key);
+			}
+
+			// Each point takes at least 4 characters, e.g., "0,0,", so check
+			// the length against the remaining input before allocating
+			if (length_ > (end_ - pos_) / 4) {
+				parseError("expected " + std::to_string(length_) + " points");
+			}
+
+			if (arrays == 0) {
+				if (sample_rate == 0 || samples_per_pixel == 0 || bits_ == 0 || length_ < 0) {
+					parseError("missing header field");
+				}
+
+				buffer_.setSampleRate(sample_rate);
+				buffer_.setSamplesPerPixel(samples_per_pixel);
+				buffer_.setBits(bits_);
+
+				// Unlike .dat files, channels follow each other, so a
+				// downmix needs all of them first.
+				mono_ = options_.getMono() && (channels != 1);
+
+				if (mono_) {
+					sums_.assign(2 * static_cast<size_t>(length_), 0);
+				}
+			}
+
+			parseArray(chan);
+			++arrays;
+		}
+		else {
+			const int value = parseInt();
+
+			if (key == "sample_rate") {
+				sample_rate = value;
+			}
+			else if (key == "samples_per_pixel") {
+				samples_per_pixel = value;
+			}
+			else if (key == "bits") {
+				if (value != 8 && value != 16) {
+					parseError("invalid bits: " + std::to_string(value));
+				}
+				bits_ = value;
+			}
+			else if (key == "length") {
+				if (value < 0) {
+					parseError("invalid length: " + std::to_string(value));
+				}
+				length_ = value;
+			}
+			else if (key == "channels") {
+				channels = value;
+			}
+			else if (key != "version") {
+				parseError("unexpected field: " + key);
+			}
+		}
+
+		skipSpace();
+
+		if (pos_ < end_ && *pos_ == ',') {
+			++pos_;
+			skipSpace();
+		}
+		else {
+			break;
+		}
+	}
+
+	expect('}');
+	skipSpace();
+
+	if (pos_ != end_) {
+		parseError("unexpected data after end of object");
+	}
+
+	if (arrays == 0) {
+		parseError("missing waveform data");
+	}
+
+	if (channels != 0 && channels != arrays) {
+		parseError("expected " + std::to_string(channels) + " channels, found " +
+		           std::to_string(arrays));
+	}
+
+	if (mono_) {
+		// Same arithmetic as DatFileImporter
+		const uint32_t count = static_cast<uint32_t>(arrays);
+		short* output = buffer_.appendPoints(static_cast<size_t>(length_), 0);
+
+		for (size_t i = 0; i < sums_.size(); ++i) {
+			output[i] = static_cast<short>(sums_[i] / count);
+		}
+
+		sums_.clear();
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Reads one array of min and max values, which must hold exactly length
+// points, into the given channel.
+
+void JsonFileImporter::parseArray(int chan)
+{
+	const size_t count = 2 * static_cast<size_t>(length_);
+	const int scale = (bits_ == 8) ? 256 : 1;
+	const int min_value = -(1 << (bits_ - 1));
+	const int max_value = (1 << (bits_ - 1)) - 1;
+
+	short* output = mono_ ? nullptr : buffer_.appendPoints(static_cast<size_t>(length_), chan);
+
+	expect('[');
+
+	for (size_t i = 0; i < count; ++i) {
+		skipSpace();
+
+		if (i != 0) {
+			expect(',');
+			skipSpace();
+		}
+
+		const int value = parseInt();
+
+		if (value < min_value || value > max_value) {
+			parseError("value out of range: " + std::to_string(value));
+		}
+
+		const short sample = static_cast<short>(value * scale);
+
+		if (mono_) {
+			sums_[i] += sample;
+		}
+		else {
+			output[i] = sample;
+		}
+	}
+
+	skipSpace();
+
+	if (pos_ < end_ && *pos_ != ']') {
+		parseError("expected " + std::to_string(length_) + " points");
+	}
+
+	expect(']');
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileImporter::skipSpace()
+{
+	while (pos_ < end_ &&
+	       (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\t' || *pos_ == '\r')) {
+		++pos_;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileImporter::expect(char c)
+{
+	if (pos_ == end_ || *pos_ != c) {
+		parseError(std::string("expected '") + c + "'");
+	}
+
+	++pos_;
+}
+
+//------------------------------------------------------------------------------
+
+// Field names are plain ASCII, so escapes aren't handled.
+
+std::string JsonFileImporter::parseKey()
+{
+	expect('"');
+
+	const char* end = static_cast<const char*>(
+		memchr(pos_, '"', static_cast<size_t>(end_ - pos_)));
+
+	if (end == nullptr) {
+		parseError("unterminated string");
+	}
+
+	std::string key(pos_, end);
+	pos_ = end + 1;
+
+	return key;
+}
+
+//------------------------------------------------------------------------------
+
+int JsonFileImporter::parseInt()
+{
+	const bool negative = (pos_ < end_ && *pos_ == '-');
+
+	if (negative) {
+		++pos_;
+	}
+
+	int64_t value = 0;
+
+	if (LITTLE_ENDIAN_HOST && end_ - pos_ >= 8) {
+		uint64_t chars;
+		memcpy(&chars, pos_, sizeof(chars));
+
+		const unsigned digits = countDigits(chars);
+
+		if (digits == 0) {
+			parseError("expected a number");
+		}
+
+		if (digits < 8) {
+			// Move the digits to the high bytes, leaving zeros before them
+			value = convertDigits(chars << (8 * (8 - digits)));
+			pos_ += digits;
+
+			return static_cast<int>(negative ? -value : value);
+		}
+	}
+
+	// Long numbers, and those near the end of the input
+	const char* start = pos_;
+
+	while (pos_ < end_ && *pos_ >= '0' && *pos_ <= '9') {
+		value = value * 10 + (*pos_ - '0');
+
+		if (value > static_cast<int64_t>(INT_MAX) + 1) {
+			parseError("number out of range");
+		}
+
+		++pos_;
+	}
+
+	if (pos_ == start) {
+		parseError("expected a number");
+	}
+
+	if (negative) {
+		value = -value;
+	}
+
+	if (value > INT_MAX) {
+		parseError("number out of range");
+	}
+
+	return static_cast<int>(value);
+}
+
+//------------------------------------------------------------------------------
+
+void JsonFileImporter::parseError(const std::string& message) const
+{
+	throwErrorEx("JsonFileImporter::parse",
+	             "Invalid JSON waveform data at offset " +
+	             std::to_string(pos_ - begin_) + ": " + message,
+	             input_filename_.string());
+}
+
+//------------------------------------------------------------------------------
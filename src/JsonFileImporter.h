@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_JSON_FILE_IMPORTER_H)
+#define INC_JSON_FILE_IMPORTER_H
+
+#include "FileImporter.h"
+#include "FileExporter.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads waveform data in the format written by JsonFileExporter: a single
+// object with integer header fields, followed by a "data" array (version 1)
+// or a "chanN" array for each channel (version 2).
+
+class JsonFileImporter: public FileImporter
+{
+	public:
+		JsonFileImporter(WaveformBuffer &buffer,
+		                 const Options &options,
+		                 const fs::path& input_filename,
+		                 FileExporter* exporter = nullptr);
+		~JsonFileImporter() = default;
+
+		JsonFileImporter() = delete;
+		JsonFileImporter(JsonFileImporter &&) = delete;
+		JsonFileImporter(const JsonFileImporter &) = delete;
+		JsonFileImporter& operator=(const JsonFileImporter &) = delete;
+
+	private:
+		void readFile(std::ifstream& stream);
+
+		void parse();
+		void parseArray(int chan);
+
+		void skipSpace();
+		void expect(char c);
+		std::string parseKey();
+		int parseInt();
+		void parseError(const std::string& message) const;
+
+		// Current position and end of the text being parsed
+		const char* begin_;
+		const char* pos_;
+		const char* end_;
+
+		int32_t length_;
+		int bits_;
+		bool mono_;
+
+		// If downmixing to mono, the sum of each value over all channels
+		std::vector<int> sums_;
+};
+
+#endif
\ No newline at end of file
@@ -47,6 +47,13 @@ int main(int argc, const char* const* argv)
         return 1;
     }
 
+    // Keep standard output for the output file, if written there, and show
+    // progress messages on standard error instead. The output file is written
+    // with stdio, which is unaffected.
+    if (options.getOutputFilename() == "-") {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
     OptionHandler option_handler;
 
     bool success = option_handler.run(options);
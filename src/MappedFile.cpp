@@ -0,0 +1,107 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------
+
+MappedFile::MappedFile() :
+    data_(nullptr),
+    size_(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedFile::open(const char* filename)
+{
+    close();
+
+#if defined(_WIN32)
+    (void)filename;
+    return false;
+#else
+    const int fd = ::open(filename, O_RDONLY);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat stat_buffer;
+
+    if (fstat(fd, &stat_buffer) != 0 || !S_ISREG(stat_buffer.st_mode) ||
+        stat_buffer.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(stat_buffer.st_size);
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the file is closed
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    // Data is read once, from start to end
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const uint8_t*>(data);
+    size_ = size;
+
+    return true;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void MappedFile::close()
+{
+#if !defined(_WIN32)
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_MAPPED_FILE_H)
+#define INC_MAPPED_FILE_H
+
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+
+// Read-only memory mapping of a whole file.
+
+class MappedFile
+{
+    public:
+        MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile();
+
+    public:
+        // Returns false if the file can't be mapped, e.g., if it isn't a
+        // regular file, or memory mapping isn't supported.
+        bool open(const char* filename);
+
+        void close();
+
+        const uint8_t* data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        const uint8_t* data_;
+        size_t size_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_MAPPED_FILE_H)
+
+//------------------------------------------------------------------------------
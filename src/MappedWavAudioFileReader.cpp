@@ -0,0 +1,332 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "MappedWavAudioFileReader.h"
+#include "AudioProcessor.h"
+#include "Streams.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <sndfile.h>
+
+//------------------------------------------------------------------------------
+
+static const uint16_t WAVE_FORMAT_PCM        = 0x0001;
+static const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xfffe;
+
+// KSDATAFORMAT_SUBTYPE_PCM, as stored in a WAVE_FORMAT_EXTENSIBLE fmt chunk
+static const unsigned char PCM_SUBFORMAT[16] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+};
+
+//------------------------------------------------------------------------------
+
+static uint16_t read16(const unsigned char* data)
+{
+    return static_cast<uint16_t>(data[0] | data[1] << 8);
+}
+
+//------------------------------------------------------------------------------
+
+static uint32_t read32(const unsigned char* data)
+{
+    return static_cast<uint32_t>(read16(data)) |
+           static_cast<uint32_t>(read16(data + 2)) << 16;
+}
+
+//------------------------------------------------------------------------------
+
+static uint64_t read64(const unsigned char* data)
+{
+    return static_cast<uint64_t>(read32(data)) |
+           static_cast<uint64_t>(read32(data + 4)) << 32;
+}
+
+//------------------------------------------------------------------------------
+
+MappedWavAudioFileReader::MappedWavAudioFileReader() :
+    is_rf64_(false),
+    sample_rate_(0),
+    channels_(0),
+    samples_(nullptr),
+    frames_(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+MappedWavAudioFileReader::~MappedWavAudioFileReader()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedWavAudioFileReader::canRead(const char* input_filename)
+{
+    if (strcmp(input_filename, "-") == 0) {
+        return false;
+    }
+
+    return map(input_filename) && parseHeader();
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedWavAudioFileReader::open(const char* input_filename, bool show_info)
+{
+    // The file may already be mapped and checked by canRead()
+    if (samples_ == nullptr || filename_ != input_filename) {
+        if (!map(input_filename)) {
+            error_stream << "Failed to read file: " << input_filename << '\n'
+                         << "Can't map file into memory\n";
+            return false;
+        }
+
+        if (!parseHeader()) {
+            error_stream << "Failed to read file: " << input_filename << '\n'
+                         << "Not a 16-bit PCM WAV file\n";
+            close();
+            return false;
+        }
+    }
+
+    output_stream << "Input file: " << input_filename << std::endl;
+
+    if (show_info) {
+        const int format = (is_rf64_ ? SF_FORMAT_RF64 : SF_FORMAT_WAV) |
+                           SF_FORMAT_PCM_16;
+
+        output_stream << "Frames: " << frames_
+                      << "\nSample rate: " << sample_rate_ << " Hz"
+                      << "\nChannels: " << channels_
+                      << "\nFormat: 0x" << std::hex << format << std::dec
+                      << "\nSections: 1"
+                      << "\nSeekable: yes\n";
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedWavAudioFileReader::map(const char* input_filename)
+{
+    close();
+
+    if (!file_.open(input_filename)) {
+        return false;
+    }
+
+    filename_ = input_filename;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// Finds the format and data chunks. Only 16-bit integer PCM is accepted, as
+// WAVE_FORMAT_PCM or WAVE_FORMAT_EXTENSIBLE. In RF64 files, sizes too large
+// for the RIFF chunk headers are given in the ds64 chunk.
+
+bool MappedWavAudioFileReader::parseHeader()
+{
+    // The samples are used in place, so must be in the host's byte order.
+
+    const unsigned char* data = file_.data();
+    const size_t size = file_.size();
+
+    if (!isLittleEndian() || data == nullptr || size < 12 || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    if (memcmp(data, "RIFF", 4) == 0) {
+        is_rf64_ = false;
+    }
+    else if (memcmp(data, "RF64", 4) == 0) {
+        is_rf64_ = true;
+    }
+    else {
+        return false;
+    }
+
+    uint64_t ds64_data_size = 0;
+    int block_align = 0;
+
+    size_t position = 12;
+
+    while (position + 8 <= size) {
+        const unsigned char* chunk = data + position;
+        const unsigned char* body = chunk + 8;
+
+        uint64_t chunk_size = read32(chunk + 4);
+
+        const size_t available = size - position - 8;
+
+        if (memcmp(chunk, "ds64", 4) == 0 && is_rf64_) {
+            if (chunk_size < 24 || chunk_size > available) {
+                return false;
+            }
+
+            ds64_data_size = read64(body + 8);
+        }
+        else if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || chunk_size > available) {
+                return false;
+            }
+
+            const uint16_t format_tag = read16(body);
+            const int channels        = read16(body + 2);
+            const int sample_rate     = static_cast<int>(read32(body + 4));
+            const int bits_per_sample = read16(body + 14);
+
+            block_align = read16(body + 12);
+
+            const bool is_pcm = format_tag == WAVE_FORMAT_PCM ||
+                (format_tag == WAVE_FORMAT_EXTENSIBLE && chunk_size >= 40 &&
+                 memcmp(body + 24, PCM_SUBFORMAT, sizeof(PCM_SUBFORMAT)) == 0);
+
+            if (!is_pcm || bits_per_sample != 16 ||
+                channels < 1 || channels > MAX_CHANNELS ||
+                sample_rate <= 0 || block_align != channels * 2) {
+                return false;
+            }
+
+            channels_    = channels;
+            sample_rate_ = sample_rate;
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            if (block_align == 0) {
+                return false;
+            }
+
+            if (is_rf64_ && chunk_size == 0xffffffff) {
+                chunk_size = ds64_data_size;
+            }
+
+            // Mapped pages are aligned, so the samples are too unless the
+            // header is malformed.
+            if ((position + 8) % alignof(short) != 0) {
+                return false;
+            }
+
+            // Use only the audio present, if the file is truncated.
+            const uint64_t data_size = std::min(
+                chunk_size, static_cast<uint64_t>(available)
+            );
+
+            samples_ = reinterpret_cast<const short*>(body);
+            frames_  = static_cast<long long>(data_size / static_cast<uint64_t>(block_align));
+
+            return true;
+        }
+
+        if (chunk_size >= available) {
+            break;
+        }
+
+        // Chunks are padded to an even number of bytes.
+        position += 8 + static_cast<size_t>(chunk_size) + (chunk_size & 1);
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+
+void MappedWavAudioFileReader::close()
+{
+    file_.close();
+    filename_.clear();
+
+    samples_ = nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedWavAudioFileReader::run(AudioProcessor& processor)
+{
+    if (samples_ == nullptr) {
+        return false;
+    }
+
+    const int BUFFER_SIZE = 16384;
+
+    bool success = processor.init(
+        sample_rate_,
+        channels_,
+        static_cast<long>(frames_),
+        BUFFER_SIZE
+    );
+
+    if (success) {
+        const long long start_frame = std::min(
+            std::max(processor.getRangeStartFrame(), 0LL), frames_
+        );
+
+        const long long end_frame = std::max(
+            std::min(processor.getRangeEndFrame(), frames_), start_frame
+        );
+
+        const long long progress_total = end_frame - start_frame;
+
+        if (progress_total > 0) {
+            showProgress(0, progress_total);
+        }
+
+        // Pass the same size buffers as SndFileAudioFileReader, but pointing
+        // into the mapped file.
+
+        const long long buffer_frames = BUFFER_SIZE / channels_;
+
+        long long total_frames_read = 0;
+
+        for (long long position = start_frame; success && position < end_frame; ) {
+            const long long frames = std::min(buffer_frames, end_frame - position);
+
+            success = processor.process(
+                samples_ + position * channels_,
+                static_cast<int>(frames)
+            );
+
+            position += frames;
+            total_frames_read += frames;
+
+            showProgress(total_frames_read, progress_total);
+        }
+
+        output_stream << "\nRead " << total_frames_read << " frames\n";
+
+        processor.done();
+    }
+
+    close();
+
+    return success;
+}
+
+//------------------------------------------------------------------------------
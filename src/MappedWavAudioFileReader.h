@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_MAPPED_WAV_AUDIO_FILE_READER_H)
+#define INC_MAPPED_WAV_AUDIO_FILE_READER_H
+
+//------------------------------------------------------------------------------
+
+#include "AudioFileReader.h"
+#include "MappedFile.h"
+
+#include <string>
+
+//------------------------------------------------------------------------------
+
+// Reads 16-bit little-endian PCM WAV and RF64 files by mapping them into
+// memory, and passes the samples to the processor directly from the mapping,
+// without decoding or copying them. Other files are read using
+// SndFileAudioFileReader.
+
+class MappedWavAudioFileReader : public AudioFileReader
+{
+    public:
+        MappedWavAudioFileReader();
+        virtual ~MappedWavAudioFileReader();
+
+        MappedWavAudioFileReader(const MappedWavAudioFileReader&) = delete;
+        MappedWavAudioFileReader& operator=(const MappedWavAudioFileReader&) = delete;
+
+    public:
+        // Returns true if the given file is a WAV or RF64 file this class can
+        // read. Standard input can't be mapped, so is never read this way.
+        // The file stays mapped, so isn't mapped again by open().
+        bool canRead(const char* input_filename);
+
+        virtual bool open(const char* input_filename, bool show_info = true);
+
+        virtual bool run(AudioProcessor& processor);
+
+    private:
+        bool map(const char* input_filename);
+        bool parseHeader();
+        void close();
+
+    private:
+        MappedFile file_;
+        std::string filename_;
+
+        bool is_rf64_;
+        int sample_rate_;
+        int channels_;
+
+        const short* samples_;
+        long long frames_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_MAPPED_WAV_AUDIO_FILE_READER_H)
+
+//------------------------------------------------------------------------------
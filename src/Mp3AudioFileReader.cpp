@@ -54,17 +54,22 @@
 #include "AudioProcessor.h"
 #include "BStdFile.h"
 #include "Error.h"
+#include "ReadAheadFile.h"
 #include "Streams.h"
 
 #include <sys/stat.h>
 #include <id3tag.h>
 #include <mad.h>
 
+#include <algorithm>
 #include <climits>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <errno.h>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 //------------------------------------------------------------------------------
 
@@ -162,6 +167,11 @@ MadSynth::~MadSynth()
 const int INPUT_BUFFER_SIZE  = 5 * 8192;
 const int OUTPUT_BUFFER_SIZE = 8192;
 
+// Number of frames decoded and discarded before the start of the range of
+// frames the processor needs, to refill the bit reservoir, which may hold
+// up to 511 bytes from earlier frames, and the synthesis filter state.
+const int PRE_ROLL_FRAMES = 16;
+
 //------------------------------------------------------------------------------
 
 // Print human readable information about an audio MPEG frame.
@@ -324,7 +334,12 @@ static short MadFixedToShort(mad_fixed_t fixed)
 Mp3AudioFileReader::Mp3AudioFileReader() :
     show_info_(true),
     file_(nullptr),
-    file_size_(0)
+    file_size_(0),
+    has_seek_index_(false),
+    write_seek_index_(false),
+    downmix_(false),
+    half_sample_rate_(false),
+    approximate_peaks_(false)
 {
 }
 
@@ -341,12 +356,18 @@ bool Mp3AudioFileReader::open(const char* filename, bool show_info)
 {
     show_info_ = show_info;
 
-    file_ = fopen(filename, "rb");
+    if (strcmp(filename, "-") == 0) {
+        file_ = stdin;
+    }
+    else {
+        file_ = fopen(filename, "rb");
+    }
 
     if (file_ != nullptr) {
         output_stream << "Input file: " << filename << std::endl;
 
-        // Get the file size, so we can show a progress indicator.
+        // Get the file size, so we can show a progress indicator. This is not
+        // known when reading from a pipe.
 
         if (!getFileSize()) {
             error_stream << "Failed to determine file size: "
@@ -365,6 +386,18 @@ bool Mp3AudioFileReader::open(const char* filename, bool show_info)
 
             return false;
         }
+
+        // A seek index can only be used with a regular file.
+
+        if (!seek_index_filename_.empty() && file_size_ > 0 &&
+            seek_index_.setSourceFile(filename)) {
+            has_seek_index_ = seek_index_.load(seek_index_filename_.c_str());
+            write_seek_index_ = !has_seek_index_;
+
+            if (has_seek_index_) {
+                output_stream << "Seek index: " << seek_index_filename_ << std::endl;
+            }
+        }
     }
     else {
         error_stream << "Failed to read file: " << filename << '\n'
@@ -376,10 +409,41 @@ bool Mp3AudioFileReader::open(const char* filename, bool show_info)
 
 //------------------------------------------------------------------------------
 
+void Mp3AudioFileReader::setSeekIndexFilename(const std::string& filename)
+{
+    seek_index_filename_ = filename;
+}
+
+//------------------------------------------------------------------------------
+
+void Mp3AudioFileReader::setDownmix(bool downmix)
+{
+    downmix_ = downmix;
+}
+
+//------------------------------------------------------------------------------
+
+void Mp3AudioFileReader::setHalfSampleRate(bool half_sample_rate)
+{
+    half_sample_rate_ = half_sample_rate;
+}
+
+//------------------------------------------------------------------------------
+
+void Mp3AudioFileReader::setApproximatePeaks(bool approximate_peaks)
+{
+    approximate_peaks_ = approximate_peaks;
+}
+
+//------------------------------------------------------------------------------
+
 void Mp3AudioFileReader::close()
 {
     if (file_ != nullptr) {
-        fclose(file_);
+        if (file_ != stdin) {
+            fclose(file_);
+        }
+
         file_ = nullptr;
     }
 }
@@ -396,7 +460,7 @@ bool Mp3AudioFileReader::getFileSize()
         return false;
     }
 
-    file_size_ = stat_buf.st_size;
+    file_size_ = S_ISREG(stat_buf.st_mode) ? stat_buf.st_size : 0;
 
     return true;
 }
@@ -420,7 +484,35 @@ bool Mp3AudioFileReader::skipId3Tags()
         length = 0;
     }
 
-    return fseek(file_, length, SEEK_SET) == 0;
+    if (file_size_ > 0) {
+        return fseek(file_, length, SEEK_SET) == 0;
+    }
+
+    // A pipe can't seek, so skip the rest of the tag by reading it, or keep
+    // the bytes already read if there is no tag.
+
+    if (length == 0) {
+        unread_.assign(buffer, buffer + ID3_TAG_QUERYSIZE);
+        return true;
+    }
+
+    length -= ID3_TAG_QUERYSIZE;
+
+    while (length > 0) {
+        unsigned char skip_buffer[4096];
+
+        const size_t size = std::min(
+            static_cast<size_t>(length), sizeof(skip_buffer)
+        );
+
+        if (fread(skip_buffer, 1, size, file_) != size) {
+            return false;
+        }
+
+        length -= static_cast<long>(size);
+    }
+
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -435,6 +527,84 @@ static constexpr unsigned long fourCC(char a, char b, char c, char d)
 
 //------------------------------------------------------------------------------
 
+// Advances the output frame index past the samples of a frame that is not
+// synthesized, less any encoder delay still to be skipped.
+
+static void countFrameSamples(
+    const struct mad_header& header,
+    int& samples_to_skip,
+    long long& frame_index)
+{
+    const int samples = 32 * static_cast<int>(MAD_NSBSAMPLES(&header));
+    const int skipped = std::min(samples, samples_to_skip);
+
+    samples_to_skip -= skipped;
+    frame_index += samples - skipped;
+}
+
+//------------------------------------------------------------------------------
+
+// Replaces a stereo frame's subband samples with the average of the left and
+// right channels, and marks the frame as single channel, so that only one
+// channel is synthesized. As synthesis is linear, this gives the average of
+// the synthesized channels, apart from rounding and clipping.
+
+static void downmixSubbandSamples(struct mad_frame& frame)
+{
+    const unsigned int subband_samples = MAD_NSBSAMPLES(&frame.header);
+
+    for (unsigned int s = 0; s < subband_samples; s++) {
+        for (unsigned int sb = 0; sb < 32; sb++) {
+            frame.sbsample[0][s][sb] =
+                frame.sbsample[0][s][sb] / 2 + frame.sbsample[1][s][sb] / 2;
+        }
+    }
+
+    frame.header.mode = MAD_MODE_SINGLE_CHANNEL;
+}
+
+//------------------------------------------------------------------------------
+
+// Fills the PCM output with an estimate of the amplitude of the audio, in
+// place of mad_synth_frame(). Each subband sample period gives 32 output
+// samples. With the scaling libmad uses, a full scale sine wave gives subband
+// samples of amplitude 1.0, so the root sum of squares of the subband samples
+// in a period is close to the RMS level of the synthesized audio. Output
+// samples alternate in sign, so that the waveform's minimum and maximum are
+// both given by the estimate.
+
+static void estimatePeaks(const struct mad_frame& frame, struct mad_pcm& pcm)
+{
+    const unsigned int channels = MAD_NCHANNELS(&frame.header);
+    const unsigned int subband_samples = MAD_NSBSAMPLES(&frame.header);
+
+    pcm.samplerate = frame.header.samplerate;
+    pcm.channels   = static_cast<unsigned short>(channels);
+    pcm.length     = static_cast<unsigned short>(32 * subband_samples);
+
+    for (unsigned int channel = 0; channel < channels; channel++) {
+        for (unsigned int s = 0; s < subband_samples; s++) {
+            double sum = 0.0;
+
+            for (unsigned int sb = 0; sb < 32; sb++) {
+                const double value = mad_f_todouble(frame.sbsample[channel][s][sb]);
+                sum += value * value;
+            }
+
+            const mad_fixed_t peak = mad_f_tofixed(std::min(std::sqrt(sum), 1.0));
+
+            mad_fixed_t* samples = &pcm.samples[channel][32 * s];
+
+            for (unsigned int i = 0; i < 32; i += 2) {
+                samples[i]     = peak;
+                samples[i + 1] = -peak;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
 bool Mp3AudioFileReader::run(AudioProcessor& processor)
 {
     if (file_ == nullptr) {
@@ -458,6 +628,19 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
     int samples_to_skip = 0;
     int channels = 0;
 
+    // The range of frames the processor needs. MP3 files can't be seeked
+    // exactly, so frames before the start are counted from their headers
+    // (see the comment marked {5} below).
+    long long start_frame = 0;
+    long long end_frame = std::numeric_limits<long long>::max();
+    long long frame_index = 0;
+    int frame_samples = 0;
+    bool stopped_early = false;
+
+    // Position in the file of the start of the input buffer, for the seek
+    // index, which is only used with regular files.
+    long long buffer_offset = ftell(file_);
+
     // Decoding options can here be set in the options field of the stream
     // structure.
 
@@ -466,20 +649,48 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
     // marked {3} below). Neither the standard C fread() function nor the POSIX
     // read() system call provides this feature. We thus need to perform our
     // reads through an interface having this feature, this is implemented here
-    // by the bstdfile.c module.
+    // by the bstdfile.c module, or by ReadAheadFile when reading ahead on a
+    // background thread.
+
+    std::unique_ptr<BStdFile> bstd_file;
+    std::unique_ptr<ReadAheadFile> read_ahead;
 
-    BStdFile bstd_file(file_);
+    if (read_ahead_size_ > 0 && file_size_ > 0) {
+        read_ahead.reset(new ReadAheadFile(file_, read_ahead_size_));
+    }
+    else {
+        bstd_file.reset(new BStdFile(file_));
+    }
 
     // Initialize the structures used by libmad.
     MadStream stream;
     MadFrame frame;
     MadSynth synth;
 
+    if (half_sample_rate_) {
+        mad_stream_options(&stream, MAD_OPTION_HALFSAMPLERATE);
+    }
+
     mad_timer_t timer;
     mad_timer_reset(&timer);
 
     GaplessPlaybackInfo gapless_playback_info;
 
+    // Adds the frame just decoded to the seek index, if writing one.
+
+    auto index_frame = [&]() {
+        if (write_seek_index_ && frame_count % Mp3SeekIndex::INTERVAL == 0) {
+            Mp3SeekIndex::Entry entry;
+
+            entry.offset          = static_cast<uint64_t>(buffer_offset + (stream.this_frame - input_buffer));
+            entry.frame_index     = static_cast<uint64_t>(frame_index);
+            entry.frame_number    = static_cast<uint32_t>(frame_count);
+            entry.samples_to_skip = static_cast<uint32_t>(samples_to_skip);
+
+            seek_index_.addEntry(entry);
+        }
+    };
+
     // This is the decoding loop.
 
     for (;;) {
@@ -507,6 +718,8 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
             // largest frame? (448000*(1152/32000))/8
 
             if (stream.next_frame != nullptr) {
+                buffer_offset += stream.next_frame - input_buffer;
+
                 remaining = static_cast<size_t>(stream.bufend - stream.next_frame);
                 memmove(input_buffer, stream.next_frame, remaining);
                 read_start = input_buffer + remaining;
@@ -520,12 +733,29 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
 
             // Fill-in the buffer. If an error occurs print a message and leave
             // the decoding loop. If the end of stream is reached we also leave
-            // the loop but the return status is left untouched.
+            // the loop but the return status is left untouched. Any bytes read
+            // from a pipe before decoding started come first.
 
-            read_size = bstd_file.read(read_start, 1, read_size);
+            const size_t unread_size = std::min(unread_.size(), read_size);
+
+            if (unread_size > 0) {
+                memcpy(read_start, unread_.data(), unread_size);
+                unread_.clear();
+            }
+
+            if (read_ahead != nullptr) {
+                read_size = unread_size + read_ahead->read(
+                    read_start + unread_size, read_size - unread_size
+                );
+            }
+            else {
+                read_size = unread_size + bstd_file->read(
+                    read_start + unread_size, 1, read_size - unread_size
+                );
+            }
 
             if (read_size <= 0) {
-                if (ferror(file_)) {
+                if (read_ahead != nullptr ? read_ahead->error() : ferror(file_) != 0) {
                     error_stream << "\nRead error on bit-stream: "
                                  << strerror(errno) << '\n';
                     status = STATUS_READ_ERROR;
@@ -554,7 +784,7 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
             //    bytes to be present in the buffer past the end of the current
             //    frame in order to decode the frame."
 
-            if (bstd_file.eof()) {
+            if (read_ahead != nullptr ? read_ahead->eof() : bstd_file->eof() != 0) {
                 guard_ptr = read_start + read_size;
                 memset(guard_ptr, 0, MAD_BUFFER_GUARD);
                 read_size += MAD_BUFFER_GUARD;
@@ -565,6 +795,89 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
             stream.error = MAD_ERROR_NONE;
         }
 
+        // {5} Up to shortly before the range of frames the processor needs,
+        // only the frame headers are decoded, to count their samples without
+        // the cost of Huffman decoding and synthesis. The frames just before
+        // the range are then decoded and discarded. Until the bit reservoir
+        // is refilled, these fail with MAD_ERROR_BADDATAPTR, and are counted
+        // in the same way.
+
+        // With a seek index, move to the last indexed frame before the frames
+        // to be decoded, and walk the frame headers from there.
+
+        if (frame_count != 0 && has_seek_index_ &&
+            start_frame - frame_index > PRE_ROLL_FRAMES * frame_samples) {
+            const Mp3SeekIndex::Entry* entry = seek_index_.findEntry(
+                start_frame - PRE_ROLL_FRAMES * frame_samples
+            );
+
+            if (entry != nullptr &&
+                static_cast<long long>(entry->frame_index) > frame_index) {
+                const bool seeked = read_ahead != nullptr ?
+                    read_ahead->seek(static_cast<long long>(entry->offset)) :
+                    fseek(file_, static_cast<long>(entry->offset), SEEK_SET) == 0;
+
+                if (!seeked) {
+                    error_stream << "\nSeek error on bit-stream: "
+                                 << strerror(errno) << '\n';
+                    status = STATUS_READ_ERROR;
+                    break;
+                }
+
+                if (read_ahead == nullptr) {
+                    bstd_file.reset(new BStdFile(file_));
+                }
+
+                // Refill the input buffer from the new position
+                mad_stream_buffer(&stream, input_buffer, 0);
+                stream.error = MAD_ERROR_BUFLEN;
+                stream.md_len = 0;
+
+                buffer_offset   = static_cast<long long>(entry->offset);
+                frame_index     = static_cast<long long>(entry->frame_index);
+                frame_count     = entry->frame_number;
+                samples_to_skip = static_cast<int>(entry->samples_to_skip);
+
+                timer = frame.header.duration;
+                mad_timer_multiply(&timer, static_cast<signed long>(frame_count));
+
+                continue;
+            }
+        }
+
+        if (frame_count != 0 &&
+            start_frame - frame_index > PRE_ROLL_FRAMES * frame_samples) {
+            if (mad_header_decode(&frame.header, &stream)) {
+                if (MAD_RECOVERABLE(stream.error) ||
+                    stream.error == MAD_ERROR_BUFLEN) {
+                    continue;
+                }
+                else {
+                    error_stream << "\nUnrecoverable frame level error: "
+                                 << mad_stream_errorstr(&stream) << '\n';
+                    status = STATUS_READ_ERROR;
+                    break;
+                }
+            }
+
+            // mad_header_decode() marks the header as incomplete, so that
+            // mad_frame_decode() would decode the rest of this frame rather
+            // than move on to the next one.
+            frame.header.flags &= ~MAD_FLAG_INCOMPLETE;
+
+            // The bit reservoir no longer follows on from the skipped frames.
+            stream.md_len = 0;
+
+            index_frame();
+
+            frame_count++;
+            mad_timer_add(&timer, frame.header.duration);
+
+            countFrameSamples(frame.header, samples_to_skip, frame_index);
+
+            continue;
+        }
+
         // Decode the next MPEG frame. The streams is read from the buffer, its
         // constituents are broken down and stored the the frame structure,
         // ready for examination/alteration or PCM synthesis. Decoding options
@@ -590,6 +903,18 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
         // part and re-sync to the next frame.
 
         if (mad_frame_decode(&frame, &stream)) {
+            if (stream.error == MAD_ERROR_BADDATAPTR &&
+                frame_count != 0 && frame_index < start_frame) {
+                index_frame();
+
+                frame_count++;
+                mad_timer_add(&timer, frame.header.duration);
+
+                countFrameSamples(frame.header, samples_to_skip, frame_index);
+
+                continue;
+            }
+
             if (MAD_RECOVERABLE(stream.error)) {
                 // Do not print a message if the error is a loss of
                 // synchronization and this loss is due to the end of stream
@@ -692,18 +1017,29 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
 
         if (frame_count == 0) {
             const int sample_rate = static_cast<int>(frame.header.samplerate);
-            channels = MAD_NCHANNELS(&frame.header);
+            channels = downmix_ ? 1 : MAD_NCHANNELS(&frame.header);
 
             if (show_info_) {
                 showInfo(output_stream, frame.header, gapless_playback_info);
             }
 
-            if (!processor.init(sample_rate, channels, 0, OUTPUT_BUFFER_SIZE)) {
+            // The seek index gives the length, if known.
+            const long length = has_seek_index_ ?
+                static_cast<long>(seek_index_.getFrameCount()) : 0;
+
+            if (!processor.init(sample_rate, channels, length, OUTPUT_BUFFER_SIZE)) {
                 status = STATUS_PROCESS_ERROR;
                 break;
             }
 
-            showProgress(0, file_size_);
+            start_frame = processor.getRangeStartFrame();
+            end_frame   = processor.getRangeEndFrame();
+
+            frame_samples = 32 * static_cast<int>(MAD_NSBSAMPLES(&frame.header));
+
+            if (file_size_ > 0) {
+                showProgress(0, file_size_);
+            }
         }
 
         // Accounting. The computed frame duration is in the frame header
@@ -714,31 +1050,52 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
         // there, as some functions of libmad's timer module receive some of
         // their mad_timer_t arguments by value!
 
+        index_frame();
+
         frame_count++;
 
         mad_timer_add(&timer, frame.header.duration);
 
+        if (downmix_ && MAD_NCHANNELS(&frame.header) == 2) {
+            downmixSubbandSamples(frame);
+        }
+
         // Once decoded the frame is synthesized to PCM samples. No errors are
         // reported by mad_synth_frame().
 
-        mad_synth_frame(&synth, &frame);
+        if (approximate_peaks_) {
+            estimatePeaks(frame, synth.pcm);
+        }
+        else {
+            mad_synth_frame(&synth, &frame);
+        }
 
         // Synthesized samples must be converted from libmad's fixed point
         // number to the consumer format. Here we use signed 16 bit integers on
         // two channels. Integer samples are temporarily stored in a buffer that
-        // is flushed when full.
+        // is flushed when full. At half sample rate, each sample is output
+        // twice.
+
+        const int sample_shift = half_sample_rate_ && !approximate_peaks_ ? 1 : 0;
+        const int length = synth.pcm.length << sample_shift;
 
-        for (int i = 0; i < synth.pcm.length; i++) {
+        for (int i = 0; i < length; i++) {
             if (samples_to_skip == 0) {
-                // Left channel
-                *output_ptr++ = MadFixedToShort(synth.pcm.samples[0][i]);
+                if (frame_index >= start_frame && frame_index < end_frame) {
+                    const int sample = i >> sample_shift;
+
+                    // Left channel
+                    *output_ptr++ = MadFixedToShort(synth.pcm.samples[0][sample]);
 
-                // Right channel. If the decoded stream is monophonic then the
-                // right output channel is the same as the left one.
+                    // Right channel. If the decoded stream is monophonic then
+                    // the right output channel is the same as the left one.
 
-                if (MAD_NCHANNELS(&frame.header) == 2) {
-                    *output_ptr++ = MadFixedToShort(synth.pcm.samples[1][i]);
+                    if (MAD_NCHANNELS(&frame.header) == 2) {
+                        *output_ptr++ = MadFixedToShort(synth.pcm.samples[1][sample]);
+                    }
                 }
+
+                frame_index++;
             }
             else {
                 samples_to_skip--;
@@ -747,9 +1104,12 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
             // Flush the output buffer if it is full
 
             if (output_ptr == output_buffer_end) {
-                long pos = ftell(file_);
+                if (file_size_ > 0) {
+                    long pos = read_ahead != nullptr ?
+                        static_cast<long>(read_ahead->tell()) : ftell(file_);
 
-                showProgress(pos, file_size_);
+                    showProgress(pos, file_size_);
+                }
 
                 const int frames = OUTPUT_BUFFER_SIZE / channels;
 
@@ -763,6 +1123,11 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
                 output_ptr = output_buffer;
             }
         }
+
+        if (frame_index >= end_frame) {
+            stopped_early = true;
+            break;
+        }
     }
 
     // If the output buffer is not empty and no error occurred during the last
@@ -782,7 +1147,9 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
 
     if (status == STATUS_OK) {
         // Report 100% done.
-        showProgress(file_size_, file_size_);
+        if (file_size_ > 0) {
+            showProgress(file_size_, file_size_);
+        }
 
         char buffer[80];
 
@@ -806,10 +1173,31 @@ bool Mp3AudioFileReader::run(AudioProcessor& processor)
 
         output_stream << "\nFrames decoded: " << frame_count
                       << " (" << buffer << ")\n";
+
+        if (read_ahead != nullptr) {
+            showWaitTime(read_ahead->getWaitTime());
+        }
+
+        // The index is only complete if the whole file was read.
+
+        if (write_seek_index_ && !stopped_early) {
+            seek_index_.setFrameCount(static_cast<uint64_t>(frame_index));
+
+            if (seek_index_.save(seek_index_filename_.c_str())) {
+                output_stream << "Wrote seek index: " << seek_index_filename_ << '\n';
+            }
+            else {
+                error_stream << "Failed to write seek index: "
+                             << seek_index_filename_ << '\n';
+            }
+        }
     }
 
     processor.done();
 
+    // Stop reading ahead before closing the file.
+    read_ahead.reset();
+
     close();
 
     return status == STATUS_OK;
@@ -27,8 +27,11 @@
 //------------------------------------------------------------------------------
 
 #include "AudioFileReader.h"
+#include "Mp3SeekIndex.h"
 
 #include <cstdio>
+#include <string>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -46,6 +49,26 @@ class Mp3AudioFileReader : public AudioFileReader
 
         virtual bool run(AudioProcessor& processor);
 
+        // Reads the frame positions from the given seek index file, if it
+        // matches the input file, or else writes them to it after reading
+        // the whole input file. Must be called before open().
+        void setSeekIndexFilename(const std::string& filename);
+
+        // Outputs stereo audio as a single channel, the average of the left
+        // and right channels. This is faster than synthesizing both channels,
+        // and is intended for generating mono waveform data.
+        void setDownmix(bool downmix);
+
+        // Synthesizes every other sample only, and outputs each of these
+        // twice, so that the sample rate and length are unchanged. This is
+        // faster, but loses detail, so is intended for zoomed out waveforms.
+        void setHalfSampleRate(bool half_sample_rate);
+
+        // Experimental: outputs an estimate of the amplitude of the audio,
+        // from the decoded subband samples, without synthesizing it. This is
+        // intended for very zoomed out waveforms only.
+        void setApproximatePeaks(bool approximate_peaks);
+
     private:
         void close();
         bool getFileSize();
@@ -55,6 +78,18 @@ class Mp3AudioFileReader : public AudioFileReader
         bool show_info_;
         FILE* file_;
         long file_size_;
+
+        // Bytes already read from a pipe that are still to be decoded
+        std::vector<unsigned char> unread_;
+
+        std::string seek_index_filename_;
+        Mp3SeekIndex seek_index_;
+        bool has_seek_index_;
+        bool write_seek_index_;
+
+        bool downmix_;
+        bool half_sample_rate_;
+        bool approximate_peaks_;
 };
 
 //------------------------------------------------------------------------------
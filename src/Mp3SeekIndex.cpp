@@ -0,0 +1,231 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "Mp3SeekIndex.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+//------------------------------------------------------------------------------
+
+static const char MAGIC[4] = { 'A', 'W', 'S', 'I' };
+
+// Version 1 also held the encoder delay and padding, which the entries
+// already account for
+static const uint32_t VERSION = 2;
+
+// Amount of the start of the MP3 file that is hashed
+static const size_t HASH_SIZE = 65536;
+
+//------------------------------------------------------------------------------
+
+template<typename T>
+static void write(std::ostream& stream, T value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//------------------------------------------------------------------------------
+
+template<typename T>
+static T read(std::istream& stream)
+{
+    T value = 0;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+//------------------------------------------------------------------------------
+
+// FNV-1a hash of the given data.
+
+static uint64_t hash(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+
+Mp3SeekIndex::Mp3SeekIndex() :
+    file_size_(0),
+    modified_time_(0),
+    hash_(0),
+    frame_count_(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool Mp3SeekIndex::setSourceFile(const char* filename)
+{
+    struct stat stat_buf;
+
+    if (stat(filename, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode)) {
+        return false;
+    }
+
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+
+    if (!file) {
+        return false;
+    }
+
+    std::vector<char> data(HASH_SIZE);
+
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+    file_size_     = static_cast<uint64_t>(stat_buf.st_size);
+    modified_time_ = static_cast<int64_t>(stat_buf.st_mtime);
+    hash_          = hash(data.data(), static_cast<size_t>(file.gcount()));
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool Mp3SeekIndex::load(const char* filename)
+{
+    clear();
+
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+
+    if (!file) {
+        return false;
+    }
+
+    char magic[sizeof(MAGIC)];
+
+    file.read(magic, sizeof(magic));
+
+    if (!file || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        read<uint32_t>(file) != VERSION ||
+        read<uint64_t>(file) != file_size_ ||
+        read<int64_t>(file) != modified_time_ ||
+        read<uint64_t>(file) != hash_ ||
+        read<uint32_t>(file) != INTERVAL) {
+        return false;
+    }
+
+    frame_count_ = read<uint64_t>(file);
+
+    const uint32_t size = read<uint32_t>(file);
+
+    for (uint32_t i = 0; i < size && file; ++i) {
+        Entry entry;
+
+        entry.offset          = read<uint64_t>(file);
+        entry.frame_index     = read<uint64_t>(file);
+        entry.frame_number    = read<uint32_t>(file);
+        entry.samples_to_skip = read<uint32_t>(file);
+
+        entries_.push_back(entry);
+    }
+
+    if (!file) {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool Mp3SeekIndex::save(const char* filename) const
+{
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+
+    if (!file) {
+        return false;
+    }
+
+    file.write(MAGIC, sizeof(MAGIC));
+
+    write<uint32_t>(file, VERSION);
+    write<uint64_t>(file, file_size_);
+    write<int64_t>(file, modified_time_);
+    write<uint64_t>(file, hash_);
+    write<uint32_t>(file, INTERVAL);
+    write<uint64_t>(file, frame_count_);
+    write<uint32_t>(file, static_cast<uint32_t>(entries_.size()));
+
+    for (const auto& entry : entries_) {
+        write<uint64_t>(file, entry.offset);
+        write<uint64_t>(file, entry.frame_index);
+        write<uint32_t>(file, entry.frame_number);
+        write<uint32_t>(file, entry.samples_to_skip);
+    }
+
+    file.close();
+
+    return !file.fail();
+}
+
+//------------------------------------------------------------------------------
+
+void Mp3SeekIndex::clear()
+{
+    frame_count_ = 0;
+
+    entries_.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void Mp3SeekIndex::addEntry(const Entry& entry)
+{
+    entries_.push_back(entry);
+}
+
+//------------------------------------------------------------------------------
+
+const Mp3SeekIndex::Entry* Mp3SeekIndex::findEntry(const long long frame_index) const
+{
+    if (frame_index < 0) {
+        return nullptr;
+    }
+
+    // Entries are in frame order
+    const auto i = std::upper_bound(
+        entries_.begin(),
+        entries_.end(),
+        static_cast<uint64_t>(frame_index),
+        [](uint64_t index, const Entry& entry) {
+            return index < entry.frame_index;
+        }
+    );
+
+    return i == entries_.begin() ? nullptr : &*(i - 1);
+}
+
+//------------------------------------------------------------------------------
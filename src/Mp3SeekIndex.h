@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_MP3_SEEK_INDEX_H)
+#define INC_MP3_SEEK_INDEX_H
+
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// The positions of every INTERVAL'th frame of an MP3 file, which can be saved
+// alongside it, so that later reads can seek close to a given sample without
+// walking the frame headers before it. A saved index is only used if the size,
+// modification time, and start of the MP3 file are unchanged.
+
+class Mp3SeekIndex
+{
+    public:
+        static const uint32_t INTERVAL = 32;
+
+        struct Entry
+        {
+            // Position of the frame in the file
+            uint64_t offset;
+
+            // Number of samples per channel output before the frame
+            uint64_t frame_index;
+
+            // Number of MP3 frames before the frame, not counting any
+            // Xing/Info frame
+            uint32_t frame_number;
+
+            // Encoder delay samples still to be skipped at the frame
+            uint32_t samples_to_skip;
+        };
+
+    public:
+        Mp3SeekIndex();
+
+    public:
+        // Identifies the MP3 file the index is for.
+        bool setSourceFile(const char* filename);
+
+        bool load(const char* filename);
+        bool save(const char* filename) const;
+
+        void clear();
+
+        void addEntry(const Entry& entry);
+
+        // Returns the last entry at or before the given sample, or nullptr if
+        // there is none.
+        const Entry* findEntry(long long frame_index) const;
+
+        uint64_t getFrameCount() const { return frame_count_; }
+        void setFrameCount(uint64_t frame_count) { frame_count_ = frame_count; }
+
+    private:
+        uint64_t file_size_;
+        int64_t modified_time_;
+        uint64_t hash_;
+
+        uint64_t frame_count_;
+
+        std::vector<Entry> entries_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_MP3_SEEK_INDEX_H)
+
+//------------------------------------------------------------------------------
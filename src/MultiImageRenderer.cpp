@@ -0,0 +1,189 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "MultiImageRenderer.h"
+#include "GdImageRenderer.h"
+#include "Options.h"
+#include "Streams.h"
+#include "WaveformBuffer.h"
+#include "WaveformRescaler.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+//------------------------------------------------------------------------------
+
+MultiImageRenderer::MultiImageRenderer(const Options& options) :
+    options_(options),
+    colors_(createWaveformColors(options))
+{
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the filename of the image of the given size, e.g., test-200x40.png
+// for output file test.png. The suffix is added after the size.
+
+fs::path MultiImageRenderer::getOutputFilename(
+    const fs::path& output_filename,
+    const PngSize& size,
+    const std::string& suffix)
+{
+    std::string name = output_filename.stem().string() + "-" +
+        std::to_string(size.width) + "x" + std::to_string(size.height);
+
+    if (size.has_samples_per_pixel) {
+        name += "@";
+        name += size.auto_samples_per_pixel ?
+            "auto" : std::to_string(size.samples_per_pixel);
+    }
+
+    name += suffix + output_filename.extension().string();
+
+    return output_filename.parent_path() / name;
+}
+
+//------------------------------------------------------------------------------
+
+// Renders each image at the given zoom level, from the buffer and from
+// versions of it rescaled to each lower resolution needed. Each channel is
+// rendered separately, unless stacking channels in one image.
+
+bool MultiImageRenderer::render(
+    WaveformBuffer& buffer,
+    const std::vector<int>& samples_per_pixel,
+    const fs::path& output_filename)
+{
+    const int input_samples_per_pixel = buffer.getSamplesPerPixel();
+
+    for (const int value : samples_per_pixel) {
+        if (value < input_samples_per_pixel) {
+            error_stream << "Invalid zoom, minimum: " << input_samples_per_pixel << '\n';
+            return false;
+        }
+    }
+
+    if (buffer.getNumChannels() == 1 || options_.getStackChannels()) {
+        return renderChannel(buffer, samples_per_pixel, output_filename, "");
+    }
+
+    std::vector<WaveformBuffer> buffers = buffer.SplitChannels();
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const std::string suffix = "-chan" + std::to_string(i);
+
+        if (!renderChannel(buffers[i], samples_per_pixel, output_filename, suffix)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool MultiImageRenderer::renderChannel(
+    const WaveformBuffer& buffer,
+    const std::vector<int>& samples_per_pixel,
+    const fs::path& output_filename,
+    const std::string& suffix)
+{
+    const std::vector<PngSize>& sizes = options_.getPngSizes();
+
+    std::vector<int> levels(samples_per_pixel);
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+
+    // Buffer to render from at each zoom level
+    std::map<int, const WaveformBuffer*> level_buffers;
+    std::vector<std::unique_ptr<WaveformBuffer>> rescaled_buffers;
+
+    for (const int level : levels) {
+        if (level == buffer.getSamplesPerPixel()) {
+            level_buffers[level] = &buffer;
+            continue;
+        }
+
+        // Rescale from the lowest resolution level so far that this level is
+        // a multiple of, as the result is then the same as rescaling from the
+        // input buffer
+        const WaveformBuffer* source_buffer = &buffer;
+
+        for (auto i = rescaled_buffers.rbegin(); i != rescaled_buffers.rend(); ++i) {
+            if (level % (*i)->getSamplesPerPixel() == 0) {
+                source_buffer = i->get();
+                break;
+            }
+        }
+
+        std::unique_ptr<WaveformBuffer> rescaled_buffer(new WaveformBuffer);
+
+        WaveformRescaler rescaler;
+
+        if (!rescaler.rescale(*source_buffer, *rescaled_buffer, level)) {
+            return false;
+        }
+
+        level_buffers[level] = rescaled_buffer.get();
+        rescaled_buffers.push_back(std::move(rescaled_buffer));
+    }
+
+    const int image_count = static_cast<int>(sizes.size());
+
+    std::vector<fs::path> filenames;
+
+    for (const auto& size : sizes) {
+        filenames.push_back(getOutputFilename(output_filename, size, suffix));
+
+        output_stream << "Saving to file: " << filenames.back().string() << std::endl;
+    }
+
+    return renderImagesConcurrently(
+        image_count,
+        [&](int i, GdImageRenderer& renderer) {
+            const size_t index = static_cast<size_t>(i);
+            const PngSize& size = sizes[index];
+
+            return renderer.create(
+                *level_buffers.at(samples_per_pixel[index]),
+                options_.getStartTime(),
+                size.width,
+                size.height,
+                colors_,
+                options_.getRenderAxisLabels(),
+                options_.isAutoAmplitudeScale(),
+                options_.getAmplitudeScale(),
+                options_.getPngPalette()) &&
+                renderer.saveAsPng(
+                    filenames[index].string().c_str(),
+                    options_.getPngCompressionLevel());
+        }
+    );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_MULTI_IMAGE_RENDERER_H)
+#define INC_MULTI_IMAGE_RENDERER_H
+
+//------------------------------------------------------------------------------
+
+#include "WaveformColors.h"
+
+#include <boost/filesystem.hpp>
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+class Options;
+class WaveformBuffer;
+struct PngSize;
+
+//------------------------------------------------------------------------------
+
+// Renders waveform images of each size given with the --png-sizes option from
+// the same waveform data. Each zoom level needed is rescaled once, from the
+// previous level where possible, and the images are then rendered
+// concurrently. Each image is written to <name>-<W>x<H>[@<zoom>].png, named
+// after the given output filename.
+
+class MultiImageRenderer
+{
+    public:
+        explicit MultiImageRenderer(const Options& options);
+
+        MultiImageRenderer(const MultiImageRenderer&) = delete;
+        MultiImageRenderer& operator=(const MultiImageRenderer&) = delete;
+
+    public:
+        bool render(
+            WaveformBuffer& buffer,
+            const std::vector<int>& samples_per_pixel,
+            const boost::filesystem::path& output_filename
+        );
+
+        static boost::filesystem::path getOutputFilename(
+            const boost::filesystem::path& output_filename,
+            const PngSize& size,
+            const std::string& suffix = ""
+        );
+
+    private:
+        bool renderChannel(
+            const WaveformBuffer& buffer,
+            const std::vector<int>& samples_per_pixel,
+            const boost::filesystem::path& output_filename,
+            const std::string& suffix
+        );
+
+    private:
+        const Options& options_;
+        const WaveformColors colors_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_MULTI_IMAGE_RENDERER_H)
+
+//------------------------------------------------------------------------------
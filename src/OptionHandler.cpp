@@ -25,8 +25,11 @@
 #include "Config.h"
 
 #include "DurationCalculator.h"
+#include "MappedWavAudioFileReader.h"
 #include "Mp3AudioFileReader.h"
 #include "Options.h"
+#include "PipelinedAudioProcessor.h"
+#include "RawAudioFileReader.h"
 #include "SndFileAudioFileReader.h"
 #include "Streams.h"
 #include "WaveformBuffer.h"
@@ -37,12 +40,20 @@
 #include "TxtFileExporter.h"
 #include "PngFileExporter.h"
 #include "DatFileImporter.h"
+#include "JsonFileImporter.h"
+#include "MultiImageRenderer.h"
+#include "TileRenderer.h"
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 
-#include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -53,18 +64,79 @@ static bool useLibSndFile(const fs::path& ext)
 
 //------------------------------------------------------------------------------
 
+static bool isAudioFile(const fs::path& ext)
+{
+    return ext == ".mp3" || ext == ".raw" || useLibSndFile(ext);
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the input file type, from the --input-format option if given, as it
+// must be when reading from standard input, or else from the input filename.
+
+static fs::path getInputFileExt(
+    const Options& options,
+    const fs::path& input_filename)
+{
+    const std::string& format = options.getInputFormat();
+
+    return format.empty() ? input_filename.extension() : fs::path("." + format);
+}
+
+//------------------------------------------------------------------------------
+
 static std::unique_ptr<AudioFileReader> createAudioFileReader(
-    const fs::path& filename)
+    const fs::path& filename,
+    const fs::path& ext,
+    const Options& options)
 {
     std::unique_ptr<AudioFileReader> reader;
 
-    const fs::path ext = filename.extension();
+    // 16-bit PCM WAV files need no decoding, so are read from memory, unless
+    // reading through a background thread is requested.
+
+    std::unique_ptr<MappedWavAudioFileReader> wav_reader;
 
-    if (useLibSndFile(ext)) {
-        reader.reset(new SndFileAudioFileReader);
+    if (ext == ".wav" && options.getReadAheadSize() == 0) {
+        wav_reader.reset(new MappedWavAudioFileReader);
+    }
+
+    if (wav_reader && wav_reader->canRead(filename.c_str())) {
+        reader = std::move(wav_reader);
+    }
+    else if (useLibSndFile(ext)) {
+        SndFileAudioFileReader* sndfile_reader = new SndFileAudioFileReader;
+        reader.reset(sndfile_reader);
+
+        sndfile_reader->setThreads(options.getThreads());
     }
     else if (ext == ".mp3") {
-        reader.reset(new Mp3AudioFileReader);
+        Mp3AudioFileReader* mp3_reader = new Mp3AudioFileReader;
+        reader.reset(mp3_reader);
+
+        mp3_reader->setSeekIndexFilename(options.getMp3IndexFilename());
+
+        const bool fast_decode = options.getMp3FastDecode();
+        const bool approximate_peaks = options.getMp3ApproximatePeaks();
+
+        mp3_reader->setDownmix(
+            options.getMono() && (fast_decode || approximate_peaks)
+        );
+
+        mp3_reader->setHalfSampleRate(fast_decode);
+        mp3_reader->setApproximatePeaks(approximate_peaks);
+    }
+    else if (ext == ".raw") {
+        RawAudioFileReader* raw_reader = new RawAudioFileReader;
+        reader.reset(raw_reader);
+
+        raw_reader->setFormat(
+            options.getRawSampleRate(),
+            options.getRawChannels(),
+            options.getRawSampleType() == "f32le" ?
+                RawAudioFileReader::SampleType::F32LE :
+                RawAudioFileReader::SampleType::S16LE
+        );
     }
     else {
         const std::string message = boost::str(
@@ -74,11 +146,85 @@ static std::unique_ptr<AudioFileReader> createAudioFileReader(
         throw std::runtime_error(message);
     }
 
+    reader->setReadAheadSize(
+        static_cast<size_t>(options.getReadAheadSize()) * 1024
+    );
+
     return reader;
 }
 
 //------------------------------------------------------------------------------
 
+// Reads audio from the reader into the processor, which runs on a separate
+// thread if the --pipeline option is given.
+
+static bool runAudioFileReader(
+    AudioFileReader& reader,
+    AudioProcessor& processor,
+    const Options& options)
+{
+    if (options.getPipeline()) {
+        PipelinedAudioProcessor pipeline(processor);
+
+        // The processor may fail on the last buffers after the reader has
+        // finished passing them on.
+        const bool success = reader.run(pipeline);
+
+        return success && !pipeline.failed();
+    }
+    else {
+        return reader.run(processor);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the output file type, from the --output-format option if given, as
+// it must be when writing to standard output, or else from the output
+// filename.
+
+static fs::path getOutputFileExt(
+    const Options& options,
+    const fs::path& output_filename)
+{
+    const std::string& format = options.getOutputFormat();
+
+    return format.empty() ? output_filename.extension() : fs::path("." + format);
+}
+
+//------------------------------------------------------------------------------
+
+static std::unique_ptr<FileExporter> createFileExporter(
+    WaveformBuffer& buffer,
+    const Options& options,
+    const fs::path& output_filename)
+{
+    std::unique_ptr<FileExporter> exporter;
+
+    const fs::path ext = getOutputFileExt(options, output_filename);
+
+    if (ext == ".dat") {
+        exporter.reset(new DatFileExporter(buffer, options, output_filename));
+    }
+    else if (ext == ".txt") {
+        exporter.reset(new TxtFileExporter(buffer, options, output_filename));
+    }
+    else if (ext == ".json") {
+        exporter.reset(new JsonFileExporter(buffer, options, output_filename));
+    }
+    else {
+        const std::string message = boost::str(
+            boost::format("Unknown file type: %1%") % output_filename
+        );
+
+        throw std::runtime_error(message);
+    }
+
+    return exporter;
+}
+
+//------------------------------------------------------------------------------
+
 static std::unique_ptr<ScaleFactor> createScaleFactor(const Options& options)
 {
     std::unique_ptr<ScaleFactor> scale_factor;
@@ -113,6 +259,60 @@ static std::unique_ptr<ScaleFactor> createScaleFactor(const Options& options)
 
 //------------------------------------------------------------------------------
 
+// Returns the scale factor of an image of the given size, which fits the whole
+// waveform to the image width if using auto zoom.
+
+static std::unique_ptr<ScaleFactor> createScaleFactor(
+    const PngSize& size,
+    const double duration)
+{
+    std::unique_ptr<ScaleFactor> scale_factor;
+
+    if (size.auto_samples_per_pixel) {
+        scale_factor.reset(new DurationScaleFactor(0.0, duration, size.width));
+    }
+    else {
+        scale_factor.reset(new SamplesPerPixelScaleFactor(size.samples_per_pixel));
+    }
+
+    return scale_factor;
+}
+
+//------------------------------------------------------------------------------
+
+// Gives the highest resolution of a set of scale factors, so that waveform
+// data generated at this scale can be rescaled to each of them.
+
+class MinimumScaleFactor : public ScaleFactor
+{
+    public:
+        explicit MinimumScaleFactor(
+            const std::vector<std::unique_ptr<ScaleFactor>>& scale_factors) :
+            scale_factors_(scale_factors)
+        {
+        }
+
+    public:
+        virtual int getSamplesPerPixel(int sample_rate) const
+        {
+            int samples_per_pixel = std::numeric_limits<int>::max();
+
+            for (const auto& scale_factor : scale_factors_) {
+                samples_per_pixel = std::min(
+                    samples_per_pixel,
+                    scale_factor->getSamplesPerPixel(sample_rate)
+                );
+            }
+
+            return samples_per_pixel;
+        }
+
+    private:
+        const std::vector<std::unique_ptr<ScaleFactor>>& scale_factors_;
+};
+
+//------------------------------------------------------------------------------
+
 // Returns the equivalent audio duration of the given waveform buffer.
 
 static double getDuration(const WaveformBuffer& buffer, int chan = 0)
@@ -124,10 +324,13 @@ static double getDuration(const WaveformBuffer& buffer, int chan = 0)
 
 // Returns the duration of the given audio file, in seconds.
 
-static double getDuration(const fs::path& input_filename)
+static double getDuration(
+    const fs::path& input_filename,
+    const fs::path& ext,
+    const Options& options)
 {
     std::unique_ptr<AudioFileReader> audio_file_reader(
-        createAudioFileReader(input_filename)
+        createAudioFileReader(input_filename, ext, options)
     );
 
     if (!audio_file_reader->open(input_filename.string().c_str())) {
@@ -157,17 +360,22 @@ OptionHandler::OptionHandler()
 
 bool OptionHandler::convertAudioFormat(
     const fs::path& input_filename,
-    const fs::path& output_filename)
+    const fs::path& output_filename,
+    const Options& options)
 {
     Mp3AudioFileReader reader;
 
+    reader.setReadAheadSize(
+        static_cast<size_t>(options.getReadAheadSize()) * 1024
+    );
+
     if (!reader.open(input_filename.string().c_str())) {
         return false;
     }
 
     WavFileWriter writer(output_filename.string().c_str());
 
-    return reader.run(writer);
+    return runAudioFileReader(reader, writer, options);
 }
 
 //------------------------------------------------------------------------------
@@ -179,10 +387,12 @@ bool OptionHandler::generateWaveformData(
 {
     const std::unique_ptr<ScaleFactor> scale_factor = createScaleFactor(options);
 
-    const fs::path output_file_ext = output_filename.extension();
-
     const std::unique_ptr<AudioFileReader> audio_file_reader =
-        createAudioFileReader(input_filename);
+        createAudioFileReader(
+            input_filename,
+            getInputFileExt(options, input_filename),
+            options
+        );
 
     if (audio_file_reader == nullptr) {
         error_stream << "Unknown file type: " << input_filename << '\n';
@@ -193,27 +403,17 @@ bool OptionHandler::generateWaveformData(
         return false;
     }
 
+	// The generator passes each block of points to the exporter as it goes,
+	// so the buffer never holds the whole waveform.
 	WaveformBuffer buffer;
-    WaveformGenerator processor(buffer, *scale_factor, options.getMono());
-
-    if (!audio_file_reader->run(processor)) {
-        return false;
-    }
+	const std::unique_ptr<FileExporter> exporter =
+		createFileExporter(buffer, options, output_filename);
 
-    assert(output_file_ext == ".dat" || output_file_ext == ".json");
+    WaveformGenerator processor(
+        buffer, *scale_factor, options.getMono(), exporter.get()
+    );
 
-	bool ret = false;
-	if (output_file_ext == ".dat") {
-		DatFileExporter dat(buffer, options, output_filename);
-		ret = dat.ExportToFile();
-	} else if (output_file_ext == ".txt"){
-		TxtFileExporter txt(buffer, options, output_filename);
-		ret = txt.ExportToFile();
-	} else {
-		JsonFileExporter json(buffer, options, output_filename);
-		ret = json.ExportToFile();
-	}
-	return ret;
+    return runAudioFileReader(*audio_file_reader, processor, options);
 }
 
 //------------------------------------------------------------------------------
@@ -225,30 +425,67 @@ bool OptionHandler::convertWaveformData(
 {
 	bool success = true;
 	WaveformBuffer buffer;
+
+	// Points are exported as they are read. Unless given explicitly, the
+	// exporter keeps the bits of the input file.
+	const std::unique_ptr<FileExporter> exporter =
+		createFileExporter(buffer, options, output_filename);
+
 	const fs::path input_file_ext = input_filename.extension();
 	if (input_file_ext == ".dat") {
-		DatFileImporter dat(buffer, options, input_filename);
+		DatFileImporter dat(buffer, options, input_filename, exporter.get());
 		success = dat.ImportFromFile();
 	}
-
-	if (!options.hasBits()) {
-		const_cast<Options&>(options).setBits(buffer.getBits());
-	}
-    const fs::path output_file_ext = output_filename.extension();
-
-	if (output_file_ext == ".json") {
-		JsonFileExporter json(buffer, options, output_filename);
-		success = json.ExportToFile();
-	}
-	else if (output_file_ext == ".txt") {
-		TxtFileExporter txt(buffer, options, output_filename);
-		success = txt.ExportToFile();
+	else if (input_file_ext == ".json") {
+		JsonFileImporter json(buffer, options, input_filename, exporter.get());
+		success = json.ImportFromFile();
 	}
 	return success;
 }
 
 
 
+//------------------------------------------------------------------------------
+
+// Limits import of a .dat file to the points covered by the rendered image,
+// given by the start time and image width. The file's header must already
+// have been read into the buffer.
+
+static void setRenderPointRange(
+    DatFileImporter& dat,
+    const WaveformBuffer& buffer,
+    const Options& options,
+    int output_samples_per_pixel)
+{
+    const int input_samples_per_pixel = buffer.getSamplesPerPixel();
+
+    if (output_samples_per_pixel < input_samples_per_pixel ||
+        options.getStartTime() < 0.0) {
+        // Reported as an error when rendering
+        return;
+    }
+
+    // See GdImageRenderer::secondsToPixels()
+    const int64_t start_index = static_cast<int64_t>(
+        options.getStartTime() * buffer.getSampleRate() / output_samples_per_pixel
+    );
+
+    // Include the point after the image, as rescaling may need part of it
+    const int64_t end_index = start_index + options.getImageWidth() + 1;
+
+    const int64_t max_point = std::numeric_limits<int32_t>::max();
+
+    const int64_t first = std::min(
+        start_index * output_samples_per_pixel / input_samples_per_pixel, max_point
+    );
+
+    const int64_t last = std::min(
+        end_index * output_samples_per_pixel / input_samples_per_pixel + 1, max_point
+    );
+
+    dat.setPointRange(static_cast<int32_t>(first), static_cast<int32_t>(last - first));
+}
+
 //------------------------------------------------------------------------------
 
 bool OptionHandler::renderWaveformImage(
@@ -267,11 +504,40 @@ bool OptionHandler::renderWaveformImage(
     int output_samples_per_pixel = 0;
 	WaveformBuffer buffer;
     
-    const fs::path input_file_ext = input_filename.extension();
+    const fs::path input_file_ext = getInputFileExt(options, input_filename);
+
+    if (input_file_ext == ".dat" || input_file_ext == ".json") {
+        if (input_file_ext == ".json") {
+            JsonFileImporter json(buffer, options, input_filename);
+            ret = json.ImportFromFile();
+        }
+        else if (calculate_duration) {
+            DatFileImporter dat(buffer, options, input_filename);
+            ret = dat.ImportFromFile();
+        }
+        else {
+            DatFileImporter dat(buffer, options, input_filename);
+
+            // The header is read only once, and gives the sample rate needed
+            // to choose which points to import
+            dat.ImportHeaderFromFile();
+
+            const int samples_per_pixel = scale_factor->getSamplesPerPixel(
+                buffer.getSampleRate()
+            );
+
+            // The block index, if any, gives the same image as the full
+            // waveform data when the zoom level is a multiple of its
+            // resolution.
+            if (dat.ImportIndexFromFile(samples_per_pixel)) {
+                output_stream << "Rendering from block index" << std::endl;
+            }
+            else {
+                setRenderPointRange(dat, buffer, options, samples_per_pixel);
+                ret = dat.ImportFromFile();
+            }
+        }
 
-    if (input_file_ext == ".dat") {
-		DatFileImporter dat(buffer, options, input_filename);
-		ret = dat.ImportFromFile();
         if (calculate_duration) {
             const double duration = getDuration(buffer);
             scale_factor.reset(
@@ -287,11 +553,11 @@ bool OptionHandler::renderWaveformImage(
         double duration = 0.0;
 
         if (calculate_duration) {
-            duration = getDuration(input_filename);
+            duration = getDuration(input_filename, input_file_ext, options);
         }
 
         std::unique_ptr<AudioFileReader> audio_file_reader(
-            createAudioFileReader(input_filename)
+            createAudioFileReader(input_filename, input_file_ext, options)
         );
 
         if (!audio_file_reader->open(input_filename.string().c_str(), !calculate_duration)) {
@@ -306,7 +572,17 @@ bool OptionHandler::renderWaveformImage(
 
         WaveformGenerator processor(buffer, *scale_factor, options.getMono());
 
-        if (!audio_file_reader->run(processor)) {
+        // Decode only the audio shown in the image, including the point after
+        // it, as for .dat files. An invalid start time is reported when
+        // rendering.
+        if (!calculate_duration && options.getStartTime() >= 0.0) {
+            processor.setPointRange(
+                options.getStartTime(),
+                options.getImageWidth() + 1
+            );
+        }
+
+        if (!runAudioFileReader(*audio_file_reader, processor, options)) {
             return false;
         }
 
@@ -319,6 +595,142 @@ bool OptionHandler::renderWaveformImage(
 
 //------------------------------------------------------------------------------
 
+// Renders an image of each size given by the --png-sizes option, reading or
+// generating the waveform data only once. Audio files are processed at the
+// highest resolution of any of the images.
+
+bool OptionHandler::renderWaveformImages(
+    const fs::path& input_filename,
+    const fs::path& output_filename,
+    const Options& options)
+{
+    const std::vector<PngSize>& sizes = options.getPngSizes();
+
+    const bool calculate_duration = std::any_of(
+        sizes.begin(),
+        sizes.end(),
+        [](const PngSize& size) { return size.auto_samples_per_pixel; }
+    );
+
+    WaveformBuffer buffer;
+
+    std::vector<std::unique_ptr<ScaleFactor>> scale_factors;
+
+    const fs::path input_file_ext = getInputFileExt(options, input_filename);
+
+    if (input_file_ext == ".dat" || input_file_ext == ".json") {
+        if (input_file_ext == ".json") {
+            JsonFileImporter json(buffer, options, input_filename);
+
+            if (!json.ImportFromFile()) {
+                return false;
+            }
+        }
+        else {
+            DatFileImporter dat(buffer, options, input_filename);
+
+            if (!dat.ImportFromFile()) {
+                return false;
+            }
+        }
+
+        const double duration = calculate_duration ? getDuration(buffer) : 0.0;
+
+        for (const auto& size : sizes) {
+            scale_factors.push_back(createScaleFactor(size, duration));
+        }
+    }
+    else {
+        const double duration = calculate_duration ?
+            getDuration(input_filename, input_file_ext, options) : 0.0;
+
+        for (const auto& size : sizes) {
+            scale_factors.push_back(createScaleFactor(size, duration));
+        }
+
+        std::unique_ptr<AudioFileReader> audio_file_reader(
+            createAudioFileReader(input_filename, input_file_ext, options)
+        );
+
+        if (!audio_file_reader->open(input_filename.string().c_str(), !calculate_duration)) {
+            return false;
+        }
+
+        const MinimumScaleFactor scale_factor(scale_factors);
+
+        WaveformGenerator processor(buffer, scale_factor, options.getMono());
+
+        if (!runAudioFileReader(*audio_file_reader, processor, options)) {
+            return false;
+        }
+    }
+
+    std::vector<int> samples_per_pixel;
+
+    for (const auto& scale_factor : scale_factors) {
+        samples_per_pixel.push_back(
+            scale_factor->getSamplesPerPixel(buffer.getSampleRate())
+        );
+    }
+
+    MultiImageRenderer renderer(options);
+
+    return renderer.render(buffer, samples_per_pixel, output_filename);
+}
+
+//------------------------------------------------------------------------------
+
+// Renders image tiles at the resolution of the input waveform data, or of the
+// given zoom level for audio files, and at each lower resolution.
+
+bool OptionHandler::renderWaveformTiles(
+    const fs::path& input_filename,
+    const fs::path& output_directory,
+    const Options& options)
+{
+    WaveformBuffer buffer;
+
+    const fs::path input_file_ext = getInputFileExt(options, input_filename);
+
+    if (input_file_ext == ".dat") {
+        DatFileImporter dat(buffer, options, input_filename);
+
+        if (!dat.ImportFromFile()) {
+            return false;
+        }
+    }
+    else if (input_file_ext == ".json") {
+        JsonFileImporter json(buffer, options, input_filename);
+
+        if (!json.ImportFromFile()) {
+            return false;
+        }
+    }
+    else {
+        const std::unique_ptr<ScaleFactor> scale_factor = createScaleFactor(options);
+
+        std::unique_ptr<AudioFileReader> audio_file_reader(
+            createAudioFileReader(input_filename, input_file_ext, options)
+        );
+
+        if (!audio_file_reader->open(input_filename.string().c_str())) {
+            return false;
+        }
+
+        WaveformGenerator processor(buffer, *scale_factor, options.getMono());
+
+        if (!runAudioFileReader(*audio_file_reader, processor, options)) {
+            return false;
+        }
+    }
+
+    TileRenderer renderer(options);
+
+    return renderer.render(buffer, output_directory);
+}
+
+//------------------------------------------------------------------------------
+
 bool OptionHandler::run(const Options& options)
 {
     if (options.getHelp()) {
@@ -333,19 +745,35 @@ bool OptionHandler::run(const Options& options)
     const fs::path input_filename  = options.getInputFilename();
     const fs::path output_filename = options.getOutputFilename();
 
-    const fs::path input_file_ext  = input_filename.extension();
-    const fs::path output_file_ext = output_filename.extension();
+    const fs::path input_file_ext  = getInputFileExt(options, input_filename);
+    const fs::path output_file_ext = getOutputFileExt(options, output_filename);
 
     bool success;
 
     try {
-        if (input_file_ext == ".mp3" && output_file_ext == ".wav") {
+        if (options.getTiles()) {
+            if (input_file_ext == ".dat" ||
+                input_file_ext == ".json" ||
+                isAudioFile(input_file_ext)) {
+                success = renderWaveformTiles(
+                    input_filename,
+                    output_filename,
+                    options
+                );
+            }
+            else {
+                error_stream << "Can't generate tiles from " << input_filename << '\n';
+                success = false;
+            }
+        }
+        else if (input_file_ext == ".mp3" && output_file_ext == ".wav") {
             success = convertAudioFormat(
                 input_filename,
-                output_filename
+                output_filename,
+                options
             );
         }
-        else if ((input_file_ext == ".mp3" || useLibSndFile(input_file_ext)) &&
+        else if (isAudioFile(input_file_ext) &&
                  (output_file_ext == ".dat" || output_file_ext == ".json" ||
 		          output_file_ext == ".txt")) {
             success = generateWaveformData(
@@ -354,8 +782,10 @@ bool OptionHandler::run(const Options& options)
                 options
             );
         }
-        else if (input_file_ext == ".dat" &&
-                 (output_file_ext == ".txt" || output_file_ext == ".json")) {
+        else if ((input_file_ext == ".dat" &&
+                  (output_file_ext == ".txt" || output_file_ext == ".json")) ||
+                 (input_file_ext == ".json" &&
+                  (output_file_ext == ".dat" || output_file_ext == ".txt"))) {
             success = convertWaveformData(
                 input_filename,
                 output_filename,
@@ -363,13 +793,22 @@ bool OptionHandler::run(const Options& options)
             );
         }
         else if ((input_file_ext == ".dat" ||
-                  input_file_ext == ".mp3" ||
-                  useLibSndFile(input_file_ext)) && output_file_ext == ".png") {
-            success = renderWaveformImage(
-                input_filename,
-                output_filename,
-                options
-            );
+                  input_file_ext == ".json" ||
+                  isAudioFile(input_file_ext)) && output_file_ext == ".png") {
+            if (options.getPngSizes().empty()) {
+                success = renderWaveformImage(
+                    input_filename,
+                    output_filename,
+                    options
+                );
+            }
+            else {
+                success = renderWaveformImages(
+                    input_filename,
+                    output_filename,
+                    options
+                );
+            }
         }
         else {
             error_stream << "Can't generate " << output_filename
@@ -50,7 +50,8 @@ class OptionHandler
     private:
         bool convertAudioFormat(
             const fs::path& input_filename,
-            const fs::path& output_filename
+            const fs::path& output_filename,
+            const Options& options
         );
 
         bool generateWaveformData(
@@ -71,6 +72,18 @@ class OptionHandler
             const Options& options
         );
 
+        bool renderWaveformImages(
+            const fs::path& input_filename,
+            const fs::path& output_filename,
+            const Options& options
+        );
+
+        bool renderWaveformTiles(
+            const fs::path& input_filename,
+            const fs::path& output_directory,
+            const Options& options
+        );
+
 		std::string getOutputFilename(const fs::path& output_filename, 
 		                              int chan_num, const Options& options);
 };
@@ -22,12 +22,17 @@
 //------------------------------------------------------------------------------
 
 #include "Options.h"
+#include "AudioFileReader.h"
 #include "Config.h"
 #include "Error.h"
 #include "MathUtil.h"
 #include "Streams.h"
 #include "Rgba.h"
 
+#include <boost/algorithm/string.hpp>
+#include <boost/regex.hpp>
+
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <string>
@@ -58,7 +63,22 @@ Options::Options() :
     render_axis_labels_(true),
     auto_amplitude_scale_(false),
     amplitude_scale_(1.0),
-    png_compression_level_(-1) // default
+    png_compression_level_(-1), // default
+    mono_(true),
+    file_version_(2),
+    block_index_(false),
+    block_size_(4096),
+    png_palette_(false),
+    tiles_(false),
+    stack_channels_(false),
+    mp3_fast_decode_(false),
+    mp3_approximate_peaks_(false),
+    read_ahead_size_(0),
+    pipeline_(false),
+    threads_(1),
+    raw_sample_rate_(0),
+    raw_channels_(0),
+    raw_sample_type_("s16le")
 {
 }
 
@@ -80,6 +100,7 @@ bool Options::parseCommandLine(int argc, const char* const* argv)
 
     std::string amplitude_scale;
     std::string samples_per_pixel;
+    std::string png_sizes;
 
     desc_.add_options()(
         "help",
@@ -90,11 +111,52 @@ bool Options::parseCommandLine(int argc, const char* const* argv)
     )(
         "input-filename,i",
         po::value<std::string>(&input_filename_)->required(),
-        "input file name (.mp3, .wav, .flac, .dat)"
+        "input file name (.mp3, .wav, .flac, .dat, .json), or - for standard input"
+    )(
+        "input-format",
+        po::value<std::string>(&input_format_),
+        "input file format (mp3, wav, flac, ogg, raw), if not given by the input file name"
+    )(
+        "sample-rate",
+        po::value<int>(&raw_sample_rate_),
+        "raw input audio sample rate, in Hz"
+    )(
+        "channels",
+        po::value<int>(&raw_channels_),
+        "raw input audio number of channels"
+    )(
+        "sample-type",
+        po::value<std::string>(&raw_sample_type_)->default_value(raw_sample_type_),
+        "raw input audio sample type (s16le, f32le)"
+    )(
+        "mp3-index",
+        po::value<std::string>(&mp3_index_filename_),
+        "MP3 seek index file name, written after reading the whole input file, and read to seek within it"
+    )(
+        "mp3-fast-decode",
+        "decode MP3 audio at half sample rate, and mixed down to mono unless --mono 0, for zoomed out waveforms"
+    )(
+        "mp3-approximate-peaks",
+        "estimate MP3 waveform peaks without synthesizing the audio, for very zoomed out waveforms (experimental)"
+    )(
+        "read-ahead",
+        po::value<int>(&read_ahead_size_)->default_value(0),
+        "read the input audio file on a background thread, up to this many kilobytes ahead of decoding (0 = off)"
+    )(
+        "pipeline",
+        "process decoded audio on a separate thread to decoding"
+    )(
+        "threads",
+        po::value<int>(&threads_)->default_value(1),
+        "number of threads to decode seekable FLAC, Ogg, or WAV input files with"
     )(
         "output-filename,o",
         po::value<std::string>(&output_filename_)->required(),
-        "output file name (.wav, .dat, .png, .json)"
+        "output file name (.wav, .dat, .png, .json), or - for standard output"
+    )(
+        "output-format",
+        po::value<std::string>(&output_format_),
+        "output file format (dat, json, txt, png), if not given by the output file name"
     )(
         "zoom,z",
         po::value<std::string>(&samples_per_pixel)->default_value("256"),
@@ -157,6 +219,19 @@ bool Options::parseCommandLine(int argc, const char* const* argv)
         "compression",
         po::value<int>(&png_compression_level_)->default_value(-1),
         "PNG compression level: 0 (none) to 9 (best), or -1 (default)"
+    )(
+        "palette",
+        "render waveform image with an indexed color palette"
+    )(
+        "tiles",
+        "render waveform image tiles at each zoom level, into the output directory"
+    )(
+        "stack-channels",
+        "render all channels in one waveform image, one above another"
+    )(
+        "png-sizes",
+        po::value<std::string>(&png_sizes),
+        "render waveform images of each size, as WxH[@zoom],..."
     )(
 	    "mono,m",
 	    po::value<bool>(&mono_)->default_value(1),
@@ -164,7 +239,14 @@ bool Options::parseCommandLine(int argc, const char* const* argv)
 	)(
 	    "file-version,f",
 		po::value<int>(&file_version_)->default_value(2),
-		"File version to write.  Currently available, 1 or 2"
+		"File version to write.  Currently available, 1, 2 or 3 (.dat only)"
+	)(
+	    "block-index",
+	    "write a block index to .dat files"
+	)(
+	    "block-size",
+	    po::value<int>(&block_size_)->default_value(4096),
+	    "points per block, for .dat file version 3 and block index"
 	);
 
     po::variables_map variables_map;
@@ -182,6 +264,13 @@ bool Options::parseCommandLine(int argc, const char* const* argv)
         }
 
         render_axis_labels_ = variables_map.count("no-axis-labels") == 0;
+        block_index_ = variables_map.count("block-index") != 0;
+        png_palette_ = variables_map.count("palette") != 0;
+        tiles_       = variables_map.count("tiles") != 0;
+        stack_channels_ = variables_map.count("stack-channels") != 0;
+        mp3_fast_decode_ = variables_map.count("mp3-fast-decode") != 0;
+        mp3_approximate_peaks_ = variables_map.count("mp3-approximate-peaks") != 0;
+        pipeline_ = variables_map.count("pipeline") != 0;
 
         const auto& end_option = variables_map["end"];
         has_end_time_ = !end_option.defaulted();
@@ -210,10 +299,101 @@ bool Options::parseCommandLine(int argc, const char* const* argv)
         handleAmplitudeScaleOption(amplitude_scale);
         handleZoomOption(samples_per_pixel);
 
+        if (!png_sizes.empty()) {
+            handlePngSizesOption(png_sizes);
+        }
+
         if (png_compression_level_ < -1 || png_compression_level_ > 9) {
             error_stream << "Invalid compression level: must be from 0 (none) to 9 (best), or -1 (default)\n";
             success = false;
         }
+
+        if (block_size_ < 1) {
+            error_stream << "Invalid block size: minimum 1\n";
+            success = false;
+        }
+
+        if (read_ahead_size_ < 0) {
+            error_stream << "Invalid read-ahead size: must be zero or more\n";
+            success = false;
+        }
+
+        if (threads_ < 1) {
+            error_stream << "Invalid number of threads: minimum 1\n";
+            success = false;
+        }
+
+        if (!input_format_.empty() &&
+            input_format_ != "mp3" && input_format_ != "wav" &&
+            input_format_ != "flac" && input_format_ != "ogg" &&
+            input_format_ != "oga" && input_format_ != "raw") {
+            error_stream << "Invalid input format: must be mp3, wav, flac, ogg, or raw\n";
+            success = false;
+        }
+
+        // Raw audio has no header, so its format must be given.
+
+        const bool raw_input = input_format_ == "raw" ||
+            (input_format_.empty() && input_filename_.size() > 4 &&
+             input_filename_.compare(input_filename_.size() - 4, 4, ".raw") == 0);
+
+        if (raw_input) {
+            if (raw_sample_rate_ <= 0) {
+                error_stream << "Sample rate must be given with --sample-rate for raw input\n";
+                success = false;
+            }
+
+            if (raw_channels_ <= 0) {
+                error_stream << "Number of channels must be given with --channels for raw input\n";
+                success = false;
+            }
+            else if (raw_channels_ > AudioFileReader::MAX_CHANNELS) {
+                error_stream << "Invalid number of channels: maximum " << AudioFileReader::MAX_CHANNELS << '\n';
+                success = false;
+            }
+        }
+
+        if (raw_sample_type_ != "s16le" && raw_sample_type_ != "f32le") {
+            error_stream << "Invalid sample type: must be s16le or f32le\n";
+            success = false;
+        }
+
+        if (input_filename_ == "-") {
+            if (input_format_.empty()) {
+                error_stream << "Input format must be given with --input-format when reading from standard input\n";
+                success = false;
+            }
+
+            const bool auto_png_size = std::any_of(
+                png_sizes_.begin(),
+                png_sizes_.end(),
+                [](const PngSize& size) { return size.auto_samples_per_pixel; }
+            );
+
+            if (auto_samples_per_pixel_ || auto_png_size) {
+                error_stream << "Can't use --zoom auto when reading from standard input\n";
+                success = false;
+            }
+        }
+
+        if (!output_format_.empty() &&
+            output_format_ != "dat" && output_format_ != "json" &&
+            output_format_ != "txt" && output_format_ != "png") {
+            error_stream << "Invalid output format: must be dat, json, txt, or png\n";
+            success = false;
+        }
+
+        if (output_filename_ == "-") {
+            if (output_format_.empty()) {
+                error_stream << "Output format must be given with --output-format when writing to standard output\n";
+                success = false;
+            }
+
+            if (tiles_ || !png_sizes_.empty()) {
+                error_stream << "Can't write more than one image to standard output\n";
+                success = false;
+            }
+        }
     }
     catch (const std::runtime_error& e) {
         reportError(e);
@@ -277,6 +457,55 @@ void Options::handleZoomOption(const std::string& option_value)
 
 //------------------------------------------------------------------------------
 
+// Parses a comma separated list of image sizes, each of which may be followed
+// by its own zoom level, e.g., "200x40@auto,4000x300@64".
+
+void Options::handlePngSizesOption(const std::string& option_value)
+{
+    static const boost::regex regex("^([0-9]+)x([0-9]+)(@(auto|[0-9]+))?$");
+
+    std::vector<std::string> values;
+    boost::split(values, option_value, boost::is_any_of(","));
+
+    png_sizes_.clear();
+
+    for (const auto& value : values) {
+        boost::smatch match;
+
+        if (!boost::regex_match(value, match, regex)) {
+            throwErrorEx("Options::handlePngSizesOption",
+                         "Invalid PNG size: " + value + ", must be WxH or WxH@zoom");
+        }
+
+        PngSize size;
+
+        try {
+            size.width  = std::stoi(match[1].str());
+            size.height = std::stoi(match[2].str());
+
+            size.has_samples_per_pixel  = match[3].matched;
+            size.auto_samples_per_pixel = auto_samples_per_pixel_;
+            size.samples_per_pixel      = samples_per_pixel_;
+
+            if (match[4] == "auto") {
+                size.auto_samples_per_pixel = true;
+            }
+            else if (match[4].matched) {
+                size.auto_samples_per_pixel = false;
+                size.samples_per_pixel = std::stoi(match[4].str());
+            }
+        }
+        catch (std::out_of_range& e) {
+            throwErrorEx("Options::handlePngSizesOption",
+                         "Invalid PNG size: " + value + ", number too large");
+        }
+
+        png_sizes_.push_back(size);
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void Options::showUsage(std::ostream& stream) const
 {
     showVersion(stream);
@@ -33,6 +33,21 @@
 #include <iosfwd>
 #include <string>
 #include <stdexcept>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// An image size given with the --png-sizes option, and its zoom level, which
+// is that of the --zoom option unless given with the size.
+
+struct PngSize
+{
+    int width;
+    int height;
+    bool has_samples_per_pixel;
+    bool auto_samples_per_pixel;
+    int samples_per_pixel;
+};
 
 //------------------------------------------------------------------------------
 
@@ -57,6 +72,40 @@ class Options
             return output_filename_;
         }
 
+        const std::string& getInputFormat() const
+        {
+            return input_format_;
+        }
+
+        const std::string& getMp3IndexFilename() const
+        {
+            return mp3_index_filename_;
+        }
+
+        bool getMp3FastDecode() const { return mp3_fast_decode_; }
+        bool getMp3ApproximatePeaks() const { return mp3_approximate_peaks_; }
+
+        // Returns the read-ahead size in kilobytes, or zero if not used.
+        int getReadAheadSize() const { return read_ahead_size_; }
+
+        bool getPipeline() const { return pipeline_; }
+
+        int getThreads() const { return threads_; }
+
+        // Format of raw input audio, which has no header
+        int getRawSampleRate() const { return raw_sample_rate_; }
+        int getRawChannels() const { return raw_channels_; }
+
+        const std::string& getRawSampleType() const
+        {
+            return raw_sample_type_;
+        }
+
+        const std::string& getOutputFormat() const
+        {
+            return output_format_;
+        }
+
         double getStartTime() const { return start_time_; }
         double getEndTime() const { return end_time_; }
         bool hasEndTime() const { return has_end_time_; }
@@ -100,6 +149,17 @@ class Options
 		void setFileVersion(int version) { file_version_ = version; }
 		int getFileVersion() const { return file_version_; }
 
+		bool getBlockIndex() const { return block_index_; }
+		int getBlockSize() const { return block_size_; }
+
+		bool getPngPalette() const { return png_palette_; }
+
+		bool getTiles() const { return tiles_; }
+
+		bool getStackChannels() const { return stack_channels_; }
+
+		const std::vector<PngSize>& getPngSizes() const { return png_sizes_; }
+
         void showUsage(std::ostream& stream) const;
         void showVersion(std::ostream& stream) const;
 
@@ -108,6 +168,7 @@ class Options
     private:
         void handleAmplitudeScaleOption(const std::string& option_value);
         void handleZoomOption(const std::string& option_value);
+        void handlePngSizesOption(const std::string& option_value);
 
     private:
         boost::program_options::options_description desc_;
@@ -118,7 +179,10 @@ class Options
         bool version_;
 
         std::string input_filename_;
+        std::string input_format_;
+        std::string mp3_index_filename_;
         std::string output_filename_;
+        std::string output_format_;
 
         double start_time_;
         double end_time_;
@@ -156,6 +220,20 @@ class Options
         int png_compression_level_;
 		bool mono_;
 		int file_version_;
+		bool block_index_;
+		int block_size_;
+		bool png_palette_;
+		bool tiles_;
+		bool stack_channels_;
+		bool mp3_fast_decode_;
+		bool mp3_approximate_peaks_;
+		int read_ahead_size_;
+		bool pipeline_;
+		int threads_;
+		int raw_sample_rate_;
+		int raw_channels_;
+		std::string raw_sample_type_;
+		std::vector<PngSize> png_sizes_;
 };
 
 //------------------------------------------------------------------------------
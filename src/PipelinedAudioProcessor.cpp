@@ -0,0 +1,249 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "PipelinedAudioProcessor.h"
+
+#include <algorithm>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+
+// Number of buffers in the ring
+static const size_t BUFFER_COUNT = 8;
+
+// Number of times a thread checks for the other before blocking
+static const int SPIN_COUNT = 100;
+
+//------------------------------------------------------------------------------
+
+PipelinedAudioProcessor::PipelinedAudioProcessor(AudioProcessor& processor) :
+    processor_(processor),
+    channels_(0),
+    buffer_frames_(0),
+    write_count_(0),
+    read_count_(0),
+    finished_(false),
+    failed_(false),
+    producer_waiting_(false),
+    consumer_waiting_(false)
+{
+}
+
+//------------------------------------------------------------------------------
+
+PipelinedAudioProcessor::~PipelinedAudioProcessor()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+
+bool PipelinedAudioProcessor::init(
+    const int sample_rate,
+    const int channels,
+    const long frame_count,
+    const int buffer_size)
+{
+    if (!processor_.init(sample_rate, channels, frame_count, buffer_size)) {
+        return false;
+    }
+
+    channels_ = channels;
+    buffer_frames_ = std::max(buffer_size / std::max(channels, 1), 1);
+
+    buffers_.assign(
+        BUFFER_COUNT,
+        std::vector<short>(static_cast<size_t>(buffer_frames_ * channels))
+    );
+    frame_counts_.assign(BUFFER_COUNT, 0);
+
+    write_count_ = 0;
+    read_count_  = 0;
+    finished_    = false;
+    failed_      = false;
+
+    thread_ = std::thread(&PipelinedAudioProcessor::consume, this);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// Waits until the given predicate is true. The predicate is checked again
+// with the mutex locked after setting the waiting flag, and notify() locks
+// the mutex if it sees the flag, so a wakeup can't be missed between the
+// check and the wait.
+
+template<typename Predicate>
+void PipelinedAudioProcessor::wait(
+    std::condition_variable& condition,
+    std::atomic<bool>& waiting,
+    Predicate predicate)
+{
+    for (int i = 0; i < SPIN_COUNT; ++i) {
+        if (predicate()) {
+            return;
+        }
+
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    waiting.store(true);
+    condition.wait(lock, predicate);
+    waiting.store(false);
+}
+
+//------------------------------------------------------------------------------
+
+void PipelinedAudioProcessor::notify(
+    std::condition_variable& condition,
+    std::atomic<bool>& waiting)
+{
+    if (waiting.load()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+
+        condition.notify_one();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool PipelinedAudioProcessor::process(
+    const short* input_buffer,
+    const int input_frame_count)
+{
+    int frames_done = 0;
+
+    while (frames_done < input_frame_count) {
+        const size_t write_count = write_count_.load(std::memory_order_relaxed);
+
+        // Wait for the processing thread to free a buffer.
+
+        wait(producer_condition_, producer_waiting_, [&] {
+            return failed_.load() ||
+                write_count - read_count_.load() < buffers_.size();
+        });
+
+        if (failed_.load()) {
+            return false;
+        }
+
+        const size_t index = write_count % buffers_.size();
+
+        const int frames = std::min(input_frame_count - frames_done, buffer_frames_);
+
+        memcpy(
+            buffers_[index].data(),
+            input_buffer + frames_done * channels_,
+            static_cast<size_t>(frames * channels_) * sizeof(short)
+        );
+
+        frame_counts_[index] = frames;
+
+        write_count_.store(write_count + 1);
+        notify(consumer_condition_, consumer_waiting_);
+
+        frames_done += frames;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PipelinedAudioProcessor::consume()
+{
+    size_t read_count = 0;
+
+    for (;;) {
+        wait(consumer_condition_, consumer_waiting_, [&] {
+            return finished_.load() || read_count != write_count_.load();
+        });
+
+        // Check again after seeing the finished flag, in case the last
+        // buffer was written just before it was set.
+
+        if (read_count == write_count_.load()) {
+            break;
+        }
+
+        const size_t index = read_count % buffers_.size();
+
+        if (!failed_.load() &&
+            !processor_.process(buffers_[index].data(), frame_counts_[index])) {
+            failed_.store(true);
+        }
+
+        read_count_.store(++read_count);
+        notify(producer_condition_, producer_waiting_);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PipelinedAudioProcessor::stop()
+{
+    if (thread_.joinable()) {
+        finished_.store(true);
+        notify(consumer_condition_, consumer_waiting_);
+
+        thread_.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PipelinedAudioProcessor::done()
+{
+    // Wait for the processing thread to finish with the remaining buffers.
+    stop();
+
+    processor_.done();
+}
+
+//------------------------------------------------------------------------------
+
+bool PipelinedAudioProcessor::failed() const
+{
+    return failed_.load();
+}
+
+//------------------------------------------------------------------------------
+
+long long PipelinedAudioProcessor::getRangeStartFrame() const
+{
+    return processor_.getRangeStartFrame();
+}
+
+//------------------------------------------------------------------------------
+
+long long PipelinedAudioProcessor::getRangeEndFrame() const
+{
+    return processor_.getRangeEndFrame();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_PIPELINED_AUDIO_PROCESSOR_H)
+#define INC_PIPELINED_AUDIO_PROCESSOR_H
+
+//------------------------------------------------------------------------------
+
+#include "AudioProcessor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Passes audio to another processor on a separate thread, so that decoding
+// and processing overlap. Blocks of audio are copied into a ring of buffers,
+// shared between the two threads without locking, as each thread only
+// advances its own position in the ring. A thread that has to wait for the
+// other spins briefly, then blocks until woken.
+
+class PipelinedAudioProcessor : public AudioProcessor
+{
+    public:
+        explicit PipelinedAudioProcessor(AudioProcessor& processor);
+        virtual ~PipelinedAudioProcessor();
+
+        PipelinedAudioProcessor(const PipelinedAudioProcessor&) = delete;
+        PipelinedAudioProcessor& operator=(const PipelinedAudioProcessor&) = delete;
+
+    public:
+        virtual bool init(
+            int sample_rate,
+            int channels,
+            long frame_count,
+            int buffer_size
+        );
+
+        virtual bool process(
+            const short* input_buffer,
+            int input_frame_count
+        );
+
+        virtual void done();
+
+        virtual long long getRangeStartFrame() const;
+        virtual long long getRangeEndFrame() const;
+
+        // Returns true if the processor failed. Failures on the last buffers
+        // are only known after done(), when process() has already returned.
+        bool failed() const;
+
+    private:
+        void consume();
+        void stop();
+
+        template<typename Predicate>
+        void wait(
+            std::condition_variable& condition,
+            std::atomic<bool>& waiting,
+            Predicate predicate
+        );
+
+        void notify(
+            std::condition_variable& condition,
+            std::atomic<bool>& waiting
+        );
+
+    private:
+        AudioProcessor& processor_;
+
+        int channels_;
+        int buffer_frames_;
+
+        std::vector<std::vector<short>> buffers_;
+        std::vector<int> frame_counts_;
+
+        // Number of buffers written by the decoding thread, and read by the
+        // processing thread
+        std::atomic<size_t> write_count_;
+        std::atomic<size_t> read_count_;
+
+        // Set when no more buffers will be written
+        std::atomic<bool> finished_;
+
+        // Set when the processor fails, after which the remaining buffers
+        // are discarded
+        std::atomic<bool> failed_;
+
+        // Used only when a thread has to block, each flag being set while
+        // that thread waits on its condition variable
+        std::mutex mutex_;
+        std::condition_variable producer_condition_;
+        std::condition_variable consumer_condition_;
+        std::atomic<bool> producer_waiting_;
+        std::atomic<bool> consumer_waiting_;
+
+        std::thread thread_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_PIPELINED_AUDIO_PROCESSOR_H)
+
+//------------------------------------------------------------------------------
@@ -27,48 +27,9 @@
 #include "WaveformRescaler.h"
 #include "Utils.h"
 
-#include <boost/format.hpp>
-
-//------------------------------------------------------------------------------
-
-static WaveformColors createWaveformColors(const Options& options)
-{
-    WaveformColors colors;
-
-    const std::string& color_scheme = options.getColorScheme();
-
-    if (color_scheme == "audacity") {
-        colors = audacity_waveform_colors;
-    }
-    else if (color_scheme == "audition") {
-        colors = audition_waveform_colors;
-    }
-    else {
-        std::string message = boost::str(
-            boost::format("Unknown color scheme: %1%") % color_scheme
-        );
-
-        throw std::runtime_error(message);
-    }
-
-    if (options.hasBorderColor()) {
-        colors.border_color = options.getBorderColor();
-    }
-
-    if (options.hasBackgroundColor()) {
-        colors.background_color = options.getBackgroundColor();
-    }
-
-    if (options.hasWaveformColor()) {
-        colors.waveform_color = options.getWaveformColor();
-    }
-
-    if (options.hasAxisLabelColor()) {
-        colors.axis_label_color = options.getAxisLabelColor();
-    }
-
-    return colors;
-}
+#include <cstdio>
+#include <string>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
@@ -84,67 +45,88 @@ PngFileExporter::PngFileExporter(WaveformBuffer& buffer,
 void PngFileExporter::writeFile(std::ofstream& stream)
 {
 	UNUSED(stream);
-	// TODO: GdImageRenderer.cpp must be modified to handle the new WaveformBuffer
-	// object, and draw the appropriate image.  This is beyond my scope of work,
-	// and thus, I am unable to complete this.
+
+	if (options_.getStackChannels()) {
+		// All channels in one image, one above another
+		const std::string filename = output_filename_.string();
+		output_stream << "Saving to file: " << filename << std::endl;
+		renderImage(buffer_, filename);
+		return;
+	}
+
 	std::vector<WaveformBuffer> buffers = buffer_.SplitChannels();
-	// Force output to VERSION_1.  This can be removed when GdImageRenderer is fixed;
-	// The SplitChannels that was added to WaveformBuffer can be removed as well.
+	// Force output to VERSION_1, so that each channel's image is named after
+	// its channel number.
 	const_cast<Options&>(options_).setFileVersion(FileExporter::VERSION_1);
 	
-	int channel = 0;
-	std::for_each(buffers.begin(), buffers.end(), [&](auto &b) {
-		int chan = channel++;
-		std::string filename = getOutputFilename(output_filename_, chan);
-		output_stream << "Saving to file: " << filename << std::endl;
-		WaveformBuffer output_buffer;
-		const WaveformColors colors = createWaveformColors(options_);
-		GdImageRenderer renderer;
-		
-		const int input_samples_per_pixel = b.getSamplesPerPixel();
+	// Get every filename first, so that an output that can only hold one
+	// image is reported before any are written.
+	std::vector<std::string> filenames;
+	for (size_t chan = 0; chan < buffers.size(); ++chan) {
+		filenames.push_back(getOutputFilename(output_filename_, static_cast<int>(chan)));
+	}
+
+	for (size_t chan = 0; chan < buffers.size(); ++chan) {
+		output_stream << "Saving to file: " << filenames[chan] << std::endl;
+		renderImage(buffers[chan], filenames[chan]);
+	}
+}
 
-		// Assume no rescale is required, and default render_buffer to channel buffer.
-		WaveformBuffer* render_buffer = &b;
-		
-		if (output_samples_per_pixel_ > input_samples_per_pixel) {
-			// Need to rescale.  Use the render_buffer and rescale into output_buffer.
-			WaveformRescaler rescaler;
+void PngFileExporter::renderImage(WaveformBuffer& buffer, const std::string& filename)
+{
+	WaveformBuffer output_buffer;
+	const WaveformColors colors = createWaveformColors(options_);
+	GdImageRenderer renderer;
+	
+	const int input_samples_per_pixel = buffer.getSamplesPerPixel();
 
-			if (!rescaler.rescale(
-			    *render_buffer,
-			    output_buffer,
-			    output_samples_per_pixel_))
-			{
-				throwErrorEx("PngFileExporter::writeFile", 
-				             "Unable to rescale render buffer.", filename);
-			}
-			// Render from the now rescaled output_buffer.
-			render_buffer = &output_buffer;
-		}
-		else if (output_samples_per_pixel_ < input_samples_per_pixel) {
-			// Can't rescale.  Not enough resolution on input.
-			throwErrorEx("PngFileExporter::writeFile", "Invalid zoom, minimum: " + 
-			             std::to_string(input_samples_per_pixel), filename);
-		}
-		
-		
-		if (!renderer.create(
-			                 *render_buffer,
-			                 options_.getStartTime(),
-			                 options_.getImageWidth(),
-			                 options_.getImageHeight(),
-			                 colors,
-			                 options_.getRenderAxisLabels(),
-			                 options_.isAutoAmplitudeScale(),
-			                 options_.getAmplitudeScale()))
+	// Assume no rescale is required, and default render_buffer to the input buffer.
+	WaveformBuffer* render_buffer = &buffer;
+	
+	if (output_samples_per_pixel_ > input_samples_per_pixel) {
+		// Need to rescale.  Use the render_buffer and rescale into output_buffer.
+		WaveformRescaler rescaler;
+
+		if (!rescaler.rescale(
+		    *render_buffer,
+		    output_buffer,
+		    output_samples_per_pixel_))
 		{
-			throwErrorEx("PngFileExporter::writeFile",
-			             "Unable to render PNG.", filename);
-		}
-		if (!renderer.saveAsPng(filename.c_str(),
-		                        options_.getPngCompressionLevel())) {
-			throwErrorEx("PngFileExporter::writeFile",
-			             "Unable to save PNG.", filename);
+			throwErrorEx("PngFileExporter::writeFile", 
+			             "Unable to rescale render buffer.", filename);
 		}
-	});
+		// Render from the now rescaled output_buffer.
+		render_buffer = &output_buffer;
+	}
+	else if (output_samples_per_pixel_ < input_samples_per_pixel) {
+		// Can't rescale.  Not enough resolution on input.
+		throwErrorEx("PngFileExporter::writeFile", "Invalid zoom, minimum: " + 
+		             std::to_string(input_samples_per_pixel), filename);
+	}
+	
+	if (!renderer.create(
+		                 *render_buffer,
+		                 options_.getStartTime(),
+		                 options_.getImageWidth(),
+		                 options_.getImageHeight(),
+		                 colors,
+		                 options_.getRenderAxisLabels(),
+		                 options_.isAutoAmplitudeScale(),
+		                 options_.getAmplitudeScale(),
+		                 options_.getPngPalette()))
+	{
+		throwErrorEx("PngFileExporter::writeFile",
+		             "Unable to render PNG.", filename);
+	}
+	const int compression_level = options_.getPngCompressionLevel();
+
+	// A filename of "-" writes to standard output
+	const bool saved = (filename == "-") ?
+		renderer.saveAsPng(stdout, compression_level) && fflush(stdout) == 0 :
+		renderer.saveAsPng(filename.c_str(), compression_level);
+
+	if (!saved) {
+		throwErrorEx("PngFileExporter::writeFile",
+		             "Unable to save PNG.", filename);
+	}
 }
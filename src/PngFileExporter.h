@@ -35,6 +35,8 @@ class PngFileExporter: public FileExporter
 
 	private:
 		virtual void writeFile(std::ofstream& stream);
+
+		void renderImage(WaveformBuffer& buffer, const std::string& filename);
 		
 		int output_samples_per_pixel_;
 };
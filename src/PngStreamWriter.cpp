@@ -0,0 +1,440 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "PngStreamWriter.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+//------------------------------------------------------------------------------
+
+// Approximate size of each group of uncompressed rows
+const size_t GROUP_SIZE = 1 << 20;
+
+// Size of the buffer used to receive compressed data
+const size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+
+const uint8_t PNG_SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+const uint8_t COLOR_TYPE_RGB     = 2;
+const uint8_t COLOR_TYPE_INDEXED = 3;
+const uint8_t COLOR_TYPE_RGBA    = 6;
+
+const uint8_t FILTER_SUB = 1;
+const uint8_t FILTER_UP  = 2;
+
+//------------------------------------------------------------------------------
+
+static void putUInt32(uint8_t* data, const uint32_t value)
+{
+    data[0] = static_cast<uint8_t>(value >> 24);
+    data[1] = static_cast<uint8_t>(value >> 16);
+    data[2] = static_cast<uint8_t>(value >> 8);
+    data[3] = static_cast<uint8_t>(value);
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the zlib stream header for the given compression level. See RFC 1950.
+
+static void getZlibHeader(uint8_t* header, const int compression_level)
+{
+    int flevel;
+
+    if (compression_level == Z_DEFAULT_COMPRESSION || compression_level == 6) {
+        flevel = 2;
+    }
+    else if (compression_level < 2) {
+        flevel = 0;
+    }
+    else if (compression_level < 6) {
+        flevel = 1;
+    }
+    else {
+        flevel = 3;
+    }
+
+    const int cmf = 0x78; // deflate, 32K window
+    int flg = flevel << 6;
+
+    flg += 31 - ((cmf << 8) + flg) % 31;
+
+    header[0] = static_cast<uint8_t>(cmf);
+    header[1] = static_cast<uint8_t>(flg);
+}
+
+//------------------------------------------------------------------------------
+
+PngStreamWriter::PngStreamWriter(
+    const int width,
+    const int height,
+    const bool has_alpha) :
+    width_(width),
+    height_(height),
+    channels_(has_alpha ? 4 : 3),
+    bit_depth_(8)
+{
+    init();
+}
+
+//------------------------------------------------------------------------------
+
+PngStreamWriter::PngStreamWriter(
+    const int width,
+    const int height,
+    const std::vector<RGBA>& palette) :
+    width_(width),
+    height_(height),
+    channels_(1),
+    bit_depth_(8),
+    palette_(palette)
+{
+    assert(!palette.empty() && palette.size() <= 256);
+
+    if (palette_.size() <= 2) {
+        bit_depth_ = 1;
+    }
+    else if (palette_.size() <= 4) {
+        bit_depth_ = 2;
+    }
+    else if (palette_.size() <= 16) {
+        bit_depth_ = 4;
+    }
+
+    init();
+}
+
+//------------------------------------------------------------------------------
+
+void PngStreamWriter::init()
+{
+    assert(width_ > 0);
+    assert(height_ > 0);
+
+    const size_t bits = static_cast<size_t>(width_) * static_cast<size_t>(channels_ * bit_depth_);
+
+    // Each row starts with its filter type
+    row_size_ = 1 + (bits + 7) / 8;
+
+    rows_per_group_ = static_cast<int>(std::max(GROUP_SIZE / row_size_, size_t(1)));
+}
+
+//------------------------------------------------------------------------------
+
+// Packs a row of palette indexes, one per byte, to the image's bit depth.
+
+void PngStreamWriter::packRow(const uint8_t* indexes, uint8_t* row) const
+{
+    const int pixels_per_byte = 8 / bit_depth_;
+
+    std::fill(row, row + row_size_ - 1, 0);
+
+    for (int x = 0; x < width_; ++x) {
+        const int shift = 8 - bit_depth_ * (x % pixels_per_byte + 1);
+
+        row[x / pixels_per_byte] |= static_cast<uint8_t>(indexes[x] << shift);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Filters and deflates a group of rows into a raw deflate stream. Each group
+// but the last ends on a byte boundary, with a sync flush, so the groups can
+// simply be concatenated.
+
+bool PngStreamWriter::compressGroup(
+    const RowGenerator& generate_row,
+    const int first_row,
+    const int compression_level,
+    Group& group) const
+{
+    const int end_row = std::min(first_row + rows_per_group_, height_);
+
+    const size_t pixels_size = row_size_ - 1;
+
+    std::vector<uint8_t> previous(pixels_size);
+    std::vector<uint8_t> current(pixels_size);
+    std::vector<uint8_t> filtered(row_size_);
+    std::vector<uint8_t> output(OUTPUT_BUFFER_SIZE);
+
+    // Palette indexes, before packing into fewer than 8 bits each
+    std::vector<uint8_t> indexes(bit_depth_ < 8 ? static_cast<size_t>(width_) : 0);
+
+    auto get_row = [&](int y, uint8_t* row) {
+        if (indexes.empty()) {
+            generate_row(y, row);
+        }
+        else {
+            generate_row(y, &indexes[0]);
+            packRow(&indexes[0], row);
+        }
+    };
+
+    if (first_row > 0) {
+        get_row(first_row - 1, &previous[0]);
+    }
+
+    z_stream stream = z_stream();
+
+    int result = deflateInit2(
+        &stream,
+        compression_level,
+        Z_DEFLATED,
+        -MAX_WBITS, // raw deflate, without zlib header or trailer
+        8,
+        Z_RLE
+    );
+
+    if (result != Z_OK) {
+        return false;
+    }
+
+    group.data.clear();
+    group.adler  = adler32(0L, Z_NULL, 0);
+    group.length = 0;
+
+    for (int y = first_row; y < end_row && result != Z_STREAM_ERROR; ++y) {
+        get_row(y, &current[0]);
+
+        // The Up filter leaves only the edges of the waveform in each row,
+        // except in the first row, where the Sub filter leaves its edges
+        // instead.
+        if (y == 0) {
+            const size_t bpp = static_cast<size_t>(std::max(channels_ * bit_depth_ / 8, 1));
+
+            filtered[0] = FILTER_SUB;
+
+            for (size_t i = 0; i < pixels_size; ++i) {
+                const uint8_t left = i >= bpp ? current[i - bpp] : 0;
+                filtered[i + 1] = static_cast<uint8_t>(current[i] - left);
+            }
+        }
+        else {
+            filtered[0] = FILTER_UP;
+
+            for (size_t i = 0; i < pixels_size; ++i) {
+                filtered[i + 1] = static_cast<uint8_t>(current[i] - previous[i]);
+            }
+        }
+
+        group.adler = adler32(group.adler, &filtered[0], static_cast<uInt>(row_size_));
+        group.length += row_size_;
+
+        const bool is_last_row = y == end_row - 1;
+        const int flush = !is_last_row     ? Z_NO_FLUSH :
+                          end_row < height_ ? Z_SYNC_FLUSH : Z_FINISH;
+
+        stream.next_in  = &filtered[0];
+        stream.avail_in = static_cast<uInt>(row_size_);
+
+        do {
+            stream.next_out  = &output[0];
+            stream.avail_out = static_cast<uInt>(output.size());
+
+            result = deflate(&stream, flush);
+
+            if (result == Z_STREAM_ERROR) {
+                break;
+            }
+
+            const size_t size = output.size() - stream.avail_out;
+            group.data.insert(group.data.end(), output.begin(), output.begin() + size);
+        } while (stream.avail_out == 0);
+
+        std::swap(previous, current);
+    }
+
+    deflateEnd(&stream);
+
+    return result != Z_STREAM_ERROR;
+}
+
+//------------------------------------------------------------------------------
+
+bool PngStreamWriter::writeChunk(
+    const Output& output,
+    const char* type,
+    const uint8_t* data,
+    const size_t size) const
+{
+    uint8_t header[8];
+    putUInt32(header, static_cast<uint32_t>(size));
+    std::copy(type, type + 4, header + 4);
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+
+    if (size > 0) {
+        crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+
+    uint8_t trailer[4];
+    putUInt32(trailer, static_cast<uint32_t>(crc));
+
+    return output(header, sizeof(header)) &&
+           (size == 0 || output(data, size)) &&
+           output(trailer, sizeof(trailer));
+}
+
+//------------------------------------------------------------------------------
+
+// Writes the palette, and the alpha of each color if any are transparent.
+
+bool PngStreamWriter::writePalette(const Output& output) const
+{
+    std::vector<uint8_t> colors;
+    std::vector<uint8_t> alphas;
+
+    bool has_alpha = false;
+
+    for (const RGBA& color : palette_) {
+        colors.push_back(static_cast<uint8_t>(color.red));
+        colors.push_back(static_cast<uint8_t>(color.green));
+        colors.push_back(static_cast<uint8_t>(color.blue));
+        alphas.push_back(static_cast<uint8_t>(color.alpha));
+
+        has_alpha = has_alpha || color.hasAlpha();
+    }
+
+    return writeChunk(output, "PLTE", colors.data(), colors.size()) &&
+           (!has_alpha || writeChunk(output, "tRNS", alphas.data(), alphas.size()));
+}
+
+//------------------------------------------------------------------------------
+
+bool PngStreamWriter::write(
+    FILE* file,
+    const RowGenerator& generate_row,
+    const int compression_level) const
+{
+    auto output = [file](const uint8_t* data, size_t size) {
+        return fwrite(data, size, 1, file) == 1;
+    };
+
+    return write(output, generate_row, compression_level);
+}
+
+//------------------------------------------------------------------------------
+
+bool PngStreamWriter::write(
+    const Output& output,
+    const RowGenerator& generate_row,
+    const int compression_level) const
+{
+    if (!output(PNG_SIGNATURE, sizeof(PNG_SIGNATURE))) {
+        return false;
+    }
+
+    uint8_t ihdr[13];
+    putUInt32(ihdr, static_cast<uint32_t>(width_));
+    putUInt32(ihdr + 4, static_cast<uint32_t>(height_));
+    ihdr[8]  = static_cast<uint8_t>(bit_depth_);
+    ihdr[9]  = !palette_.empty() ? COLOR_TYPE_INDEXED :
+               channels_ == 4    ? COLOR_TYPE_RGBA : COLOR_TYPE_RGB;
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlace
+
+    if (!writeChunk(output, "IHDR", ihdr, sizeof(ihdr))) {
+        return false;
+    }
+
+    if (!palette_.empty() && !writePalette(output)) {
+        return false;
+    }
+
+    const int group_count = (height_ + rows_per_group_ - 1) / rows_per_group_;
+
+    const int threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+
+    // Compress a batch of groups concurrently, then write them out in order,
+    // so that only one batch is held in memory at a time
+    for (int batch_start = 0; batch_start < group_count; batch_start += threads) {
+        const int batch_size = std::min(threads, group_count - batch_start);
+
+        std::vector<Group> groups(static_cast<size_t>(batch_size));
+        std::vector<char> succeeded(static_cast<size_t>(batch_size));
+
+        auto compress = [&](int index) {
+            const size_t i = static_cast<size_t>(index);
+
+            succeeded[i] = compressGroup(
+                generate_row,
+                (batch_start + index) * rows_per_group_,
+                compression_level,
+                groups[i]
+            );
+        };
+
+        std::vector<std::thread> workers;
+
+        for (int index = 1; index < batch_size; ++index) {
+            workers.emplace_back(compress, index);
+        }
+
+        compress(0);
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (int index = 0; index < batch_size; ++index) {
+            const size_t i = static_cast<size_t>(index);
+
+            if (!succeeded[i]) {
+                return false;
+            }
+
+            Group& group = groups[i];
+
+            adler = adler32_combine(adler, group.adler, static_cast<z_off_t>(group.length));
+
+            const int group_index = batch_start + index;
+
+            if (group_index == 0) {
+                uint8_t header[2];
+                getZlibHeader(header, compression_level);
+                group.data.insert(group.data.begin(), header, header + 2);
+            }
+
+            if (group_index == group_count - 1) {
+                uint8_t trailer[4];
+                putUInt32(trailer, static_cast<uint32_t>(adler));
+                group.data.insert(group.data.end(), trailer, trailer + 4);
+            }
+
+            if (!writeChunk(output, "IDAT", group.data.data(), group.data.size())) {
+                return false;
+            }
+        }
+    }
+
+    return writeChunk(output, "IEND", nullptr, 0);
+}
+
+//------------------------------------------------------------------------------
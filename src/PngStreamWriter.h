@@ -0,0 +1,119 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_PNG_STREAM_WRITER_H)
+#define INC_PNG_STREAM_WRITER_H
+
+//------------------------------------------------------------------------------
+
+#include "Rgba.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Writes a PNG image one group of rows at a time, so that memory use depends
+// on the image width but not its height. The rows are generated on demand and
+// each group is deflated independently, so that groups can be compressed
+// concurrently, then joined into a single zlib stream.
+
+class PngStreamWriter
+{
+    public:
+        // Fills a row of 8-bit RGB or RGBA pixels, or of palette indexes, one
+        // byte per pixel. May be called concurrently from several threads, for
+        // different rows.
+        typedef std::function<void(int y, uint8_t* row)> RowGenerator;
+
+        // Receives the encoded image, a piece at a time. Returns false on
+        // failure.
+        typedef std::function<bool(const uint8_t* data, size_t size)> Output;
+
+        PngStreamWriter(int width, int height, bool has_alpha);
+
+        // Writes an indexed color image, with the smallest bit depth that
+        // holds the palette, which may have up to 256 colors.
+        PngStreamWriter(int width, int height, const std::vector<RGBA>& palette);
+
+        PngStreamWriter(const PngStreamWriter&) = delete;
+        PngStreamWriter& operator=(const PngStreamWriter&) = delete;
+
+    public:
+        bool write(
+            FILE* file,
+            const RowGenerator& generate_row,
+            int compression_level
+        ) const;
+
+        bool write(
+            const Output& output,
+            const RowGenerator& generate_row,
+            int compression_level
+        ) const;
+
+    private:
+        struct Group
+        {
+            std::vector<uint8_t> data;
+            unsigned long adler;
+            unsigned long length;
+        };
+
+        bool compressGroup(
+            const RowGenerator& generate_row,
+            int first_row,
+            int compression_level,
+            Group& group
+        ) const;
+
+        void init();
+
+        void packRow(const uint8_t* indexes, uint8_t* row) const;
+
+        bool writePalette(const Output& output) const;
+
+        bool writeChunk(
+            const Output& output,
+            const char* type,
+            const uint8_t* data,
+            size_t size
+        ) const;
+
+    private:
+        int width_;
+        int height_;
+        int channels_;
+        int bit_depth_;
+        std::vector<RGBA> palette_;
+        size_t row_size_;
+        int rows_per_group_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_PNG_STREAM_WRITER_H)
+
+//------------------------------------------------------------------------------
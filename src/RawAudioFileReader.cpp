@@ -0,0 +1,325 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "RawAudioFileReader.h"
+#include "AudioProcessor.h"
+#include "Streams.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+static int getSampleSize(const RawAudioFileReader::SampleType sample_type)
+{
+    return sample_type == RawAudioFileReader::SampleType::F32LE ? 4 : 2;
+}
+
+//------------------------------------------------------------------------------
+
+RawAudioFileReader::RawAudioFileReader() :
+    sample_rate_(0),
+    channels_(0),
+    sample_type_(SampleType::S16LE),
+    file_(nullptr),
+    frames_(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+RawAudioFileReader::~RawAudioFileReader()
+{
+    close();
+}
+
+//------------------------------------------------------------------------------
+
+void RawAudioFileReader::setFormat(
+    const int sample_rate,
+    const int channels,
+    const SampleType sample_type)
+{
+    sample_rate_ = sample_rate;
+    channels_    = channels;
+    sample_type_ = sample_type;
+}
+
+//------------------------------------------------------------------------------
+
+bool RawAudioFileReader::open(const char* input_filename, bool show_info)
+{
+    if (sample_rate_ <= 0 || channels_ <= 0) {
+        error_stream << "Failed to read file: " << input_filename << '\n'
+                     << "Raw audio sample rate and channels not given\n";
+        return false;
+    }
+
+    if (channels_ > MAX_CHANNELS) {
+        error_stream << "Failed to read file: " << input_filename << '\n'
+                     << "Invalid number of channels: " << channels_ << '\n';
+        return false;
+    }
+
+    if (strcmp(input_filename, "-") == 0) {
+        file_ = stdin;
+    }
+    else {
+        file_ = fopen(input_filename, "rb");
+    }
+
+    if (file_ == nullptr) {
+        error_stream << "Failed to read file: " << input_filename << '\n'
+                     << strerror(errno) << '\n';
+        return false;
+    }
+
+    // The number of frames is known only for regular files, and any partial
+    // frame at the end is ignored.
+
+    struct stat stat_buf;
+
+    if (fstat(fileno(file_), &stat_buf) == 0 && S_ISREG(stat_buf.st_mode)) {
+        frames_ = static_cast<long long>(stat_buf.st_size) /
+                  (getSampleSize(sample_type_) * channels_);
+    }
+
+    output_stream << "Input file: " << input_filename << std::endl;
+
+    if (show_info) {
+        if (frames_ > 0) {
+            output_stream << "Frames: " << frames_ << '\n';
+        }
+
+        output_stream << "Sample rate: " << sample_rate_ << " Hz"
+                      << "\nChannels: " << channels_
+                      << "\nFormat: raw "
+                      << (sample_type_ == SampleType::F32LE ? "f32le" : "s16le")
+                      << '\n';
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+void RawAudioFileReader::close()
+{
+    if (file_ != nullptr) {
+        if (file_ != stdin) {
+            fclose(file_);
+        }
+
+        file_ = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the frame reached, which is earlier if the input is shorter. When
+// the length isn't known, as when reading from standard input, the frames
+// before the given one are read and discarded, without converting them.
+
+long long RawAudioFileReader::seekFrame(const long long frame)
+{
+    if (frame <= 0) {
+        return 0;
+    }
+
+    if (frames_ > 0) {
+        const long long position = std::min(frame, frames_);
+
+        const off_t offset = static_cast<off_t>(
+            position * getSampleSize(sample_type_) * channels_
+        );
+
+        if (fseeko(file_, offset, SEEK_SET) == 0) {
+            return position;
+        }
+    }
+
+    const size_t frame_size = static_cast<size_t>(
+        getSampleSize(sample_type_) * channels_
+    );
+
+    unsigned char buffer[16384 * 4];
+
+    const long long max_frames = static_cast<long long>(sizeof(buffer) / frame_size);
+
+    long long position = 0;
+
+    while (position < frame) {
+        const size_t frames_read = fread(
+            buffer,
+            frame_size,
+            static_cast<size_t>(std::min(max_frames, frame - position)),
+            file_
+        );
+
+        if (frames_read == 0) {
+            break;
+        }
+
+        position += static_cast<long long>(frames_read);
+    }
+
+    return position;
+}
+
+//------------------------------------------------------------------------------
+
+// Converts up to the given number of frames of s16le or f32le input to
+// 16-bit samples in host byte order. Returns the number of whole frames read.
+
+long long RawAudioFileReader::readFrames(short* buffer, const long long frames)
+{
+    const size_t samples = static_cast<size_t>(frames * channels_);
+
+    if (sample_type_ == SampleType::S16LE) {
+        const size_t samples_read = fread(buffer, sizeof(short), samples, file_);
+
+        if (!isLittleEndian()) {
+            for (size_t i = 0; i < samples_read; ++i) {
+                const uint16_t value = static_cast<uint16_t>(buffer[i]);
+
+                buffer[i] = static_cast<short>(
+                    static_cast<uint16_t>(value << 8 | value >> 8)
+                );
+            }
+        }
+
+        return static_cast<long long>(samples_read) / channels_;
+    }
+    else {
+        unsigned char input_buffer[16384 * 4];
+
+        const size_t samples_read = fread(
+            input_buffer, 4, std::min(samples, sizeof(input_buffer) / 4), file_
+        );
+
+        // Scale floating-point samples from [-1.0, 1.0] to 16-bit integer
+        // range, clipping any outside it.
+
+        for (size_t i = 0; i < samples_read; ++i) {
+            const unsigned char* bytes = input_buffer + i * 4;
+
+            const uint32_t bits = static_cast<uint32_t>(bytes[0]) |
+                                  static_cast<uint32_t>(bytes[1]) << 8 |
+                                  static_cast<uint32_t>(bytes[2]) << 16 |
+                                  static_cast<uint32_t>(bytes[3]) << 24;
+
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+
+            value = std::max(-1.0f, std::min(value, 1.0f));
+
+            buffer[i] = static_cast<short>(
+                value * std::numeric_limits<short>::max()
+            );
+        }
+
+        return static_cast<long long>(samples_read) / channels_;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool RawAudioFileReader::run(AudioProcessor& processor)
+{
+    if (file_ == nullptr) {
+        return false;
+    }
+
+    const int BUFFER_SIZE = 16384;
+
+    short input_buffer[BUFFER_SIZE];
+
+    bool success = processor.init(
+        sample_rate_,
+        channels_,
+        static_cast<long>(frames_),
+        BUFFER_SIZE
+    );
+
+    if (success) {
+        const long long end_frame = processor.getRangeEndFrame();
+        const long long start_frame = seekFrame(processor.getRangeStartFrame());
+
+        const long long progress_total = frames_ > 0 ?
+            std::min(end_frame, frames_) - start_frame : 0;
+
+        if (progress_total > 0) {
+            showProgress(0, progress_total);
+        }
+
+        const long long buffer_frames = BUFFER_SIZE / channels_;
+
+        long long position = start_frame;
+        long long total_frames_read = 0;
+
+        while (success && position < end_frame) {
+            const long long frames_read = readFrames(
+                input_buffer,
+                std::min(buffer_frames, end_frame - position)
+            );
+
+            if (frames_read <= 0) {
+                break;
+            }
+
+            success = processor.process(
+                input_buffer,
+                static_cast<int>(frames_read)
+            );
+
+            position += frames_read;
+            total_frames_read += frames_read;
+
+            if (progress_total > 0) {
+                showProgress(total_frames_read, progress_total);
+            }
+        }
+
+        if (ferror(file_)) {
+            error_stream << "\nFailed to read file: " << strerror(errno) << '\n';
+            success = false;
+        }
+
+        output_stream << "\nRead " << total_frames_read << " frames\n";
+
+        processor.done();
+    }
+
+    close();
+
+    return success;
+}
+
+//------------------------------------------------------------------------------
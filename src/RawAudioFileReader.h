@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_RAW_AUDIO_FILE_READER_H)
+#define INC_RAW_AUDIO_FILE_READER_H
+
+//------------------------------------------------------------------------------
+
+#include "AudioFileReader.h"
+
+#include <cstdio>
+
+//------------------------------------------------------------------------------
+
+// Reads headerless interleaved PCM audio, such as the output of an upstream
+// decoder piped to standard input, in the format given by setFormat().
+
+class RawAudioFileReader : public AudioFileReader
+{
+    public:
+        enum class SampleType {
+            S16LE, // 16-bit signed integer, little-endian
+            F32LE  // 32-bit floating point, little-endian
+        };
+
+    public:
+        RawAudioFileReader();
+        virtual ~RawAudioFileReader();
+
+        RawAudioFileReader(const RawAudioFileReader&) = delete;
+        RawAudioFileReader& operator=(const RawAudioFileReader&) = delete;
+
+    public:
+        // Must be called before open().
+        void setFormat(int sample_rate, int channels, SampleType sample_type);
+
+        virtual bool open(const char* input_filename, bool show_info = true);
+
+        virtual bool run(AudioProcessor& processor);
+
+    private:
+        void close();
+        long long seekFrame(long long frame);
+        long long readFrames(short* buffer, long long frames);
+
+    private:
+        int sample_rate_;
+        int channels_;
+        SampleType sample_type_;
+
+        FILE* file_;
+
+        // Total number of frames, or zero if not known, when reading from
+        // a pipe
+        long long frames_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_RAW_AUDIO_FILE_READER_H)
+
+//------------------------------------------------------------------------------
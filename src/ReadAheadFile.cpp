@@ -0,0 +1,282 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "ReadAheadFile.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+
+static const size_t BLOCK_COUNT = 4;
+
+static const size_t MIN_BLOCK_SIZE = 4096;
+
+//------------------------------------------------------------------------------
+
+ReadAheadFile::ReadAheadFile(FILE* file, size_t size) :
+    file_(file),
+    size_(-1),
+    blocks_(BLOCK_COUNT),
+    block_sizes_(BLOCK_COUNT, 0),
+    first_block_(0),
+    filled_blocks_(0),
+    block_position_(0),
+    position_(ftell(file)),
+    done_(false),
+    error_(false),
+    stop_(false),
+    wait_time_(0)
+{
+    const size_t block_size = std::max(size / BLOCK_COUNT, MIN_BLOCK_SIZE);
+
+    for (auto& block : blocks_) {
+        block.resize(block_size);
+    }
+
+    struct stat stat_buf;
+
+    if (fstat(fileno(file), &stat_buf) == 0 && S_ISREG(stat_buf.st_mode)) {
+        size_ = static_cast<long long>(stat_buf.st_size);
+    }
+
+    start();
+}
+
+//------------------------------------------------------------------------------
+
+ReadAheadFile::~ReadAheadFile()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+
+void ReadAheadFile::start()
+{
+    stop_ = false;
+    thread_ = std::thread(&ReadAheadFile::readBlocks, this);
+}
+
+//------------------------------------------------------------------------------
+
+void ReadAheadFile::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    condition_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Fills each free block in turn, until the end of the file.
+
+void ReadAheadFile::readBlocks()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!done_) {
+        condition_.wait(lock, [this] {
+            return stop_ || filled_blocks_ < blocks_.size();
+        });
+
+        if (stop_) {
+            break;
+        }
+
+        // The consumer doesn't use this block until it is counted as filled,
+        // so it can be read into without the lock held.
+
+        const size_t index = (first_block_ + filled_blocks_) % blocks_.size();
+        std::vector<unsigned char>& block = blocks_[index];
+
+        lock.unlock();
+
+        const size_t bytes = fread(block.data(), 1, block.size(), file_);
+        const bool failed = bytes < block.size() && ferror(file_);
+
+        lock.lock();
+
+        block_sizes_[index] = bytes;
+
+        if (bytes > 0) {
+            filled_blocks_++;
+        }
+
+        if (bytes < block.size()) {
+            done_ = true;
+            error_ = failed;
+        }
+
+        condition_.notify_all();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void ReadAheadFile::waitForBlock(std::unique_lock<std::mutex>& lock)
+{
+    if (filled_blocks_ == 0 && !done_) {
+        const auto start_time = std::chrono::steady_clock::now();
+
+        condition_.wait(lock, [this] {
+            return filled_blocks_ > 0 || done_;
+        });
+
+        wait_time_ += std::chrono::steady_clock::now() - start_time;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+size_t ReadAheadFile::read(void* buffer, size_t size)
+{
+    unsigned char* output = static_cast<unsigned char*>(buffer);
+    size_t total = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (total < size) {
+        waitForBlock(lock);
+
+        if (filled_blocks_ == 0) {
+            break;
+        }
+
+        const unsigned char* block = blocks_[first_block_].data();
+        const size_t block_size = block_sizes_[first_block_];
+
+        const size_t count = std::min(size - total, block_size - block_position_);
+
+        // The background thread doesn't change a filled block, so it can be
+        // copied from without the lock held.
+
+        lock.unlock();
+
+        memcpy(output + total, block + block_position_, count);
+
+        lock.lock();
+
+        total += count;
+        block_position_ += count;
+
+        if (block_position_ == block_size) {
+            first_block_ = (first_block_ + 1) % blocks_.size();
+            filled_blocks_--;
+            block_position_ = 0;
+
+            condition_.notify_all();
+        }
+    }
+
+    position_ += static_cast<long long>(total);
+
+    return total;
+}
+
+//------------------------------------------------------------------------------
+
+bool ReadAheadFile::eof()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    waitForBlock(lock);
+
+    return filled_blocks_ == 0 && done_;
+}
+
+//------------------------------------------------------------------------------
+
+bool ReadAheadFile::error() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return error_;
+}
+
+//------------------------------------------------------------------------------
+
+bool ReadAheadFile::seek(long long offset)
+{
+    if (offset == tell()) {
+        return true;
+    }
+
+    stop();
+
+    const bool success = fseek(file_, static_cast<long>(offset), SEEK_SET) == 0;
+
+    if (success) {
+        position_ = offset;
+    }
+    else {
+        // Continue reading from the file's position, if it has changed.
+        position_ = ftell(file_);
+    }
+
+    first_block_    = 0;
+    filled_blocks_  = 0;
+    block_position_ = 0;
+    done_           = false;
+    error_          = false;
+
+    start();
+
+    return success;
+}
+
+//------------------------------------------------------------------------------
+
+long long ReadAheadFile::tell() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return position_;
+}
+
+//------------------------------------------------------------------------------
+
+long long ReadAheadFile::getSize() const
+{
+    return size_;
+}
+
+//------------------------------------------------------------------------------
+
+double ReadAheadFile::getWaitTime() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return std::chrono::duration<double>(wait_time_).count();
+}
+
+//------------------------------------------------------------------------------
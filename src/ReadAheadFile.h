@@ -0,0 +1,122 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_READ_AHEAD_FILE_H)
+#define INC_READ_AHEAD_FILE_H
+
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Reads a file on a background thread, ahead of its consumer, into a ring of
+// reusable blocks. Reading from a slow device, such as a network file system,
+// then overlaps with decoding, and the consumer only waits if it catches up
+// with the file.
+
+class ReadAheadFile
+{
+    public:
+        // Reads from the file's current position, using buffers of the given
+        // total size. The file is not closed.
+        ReadAheadFile(FILE* file, size_t size);
+        ~ReadAheadFile();
+
+        ReadAheadFile(const ReadAheadFile&) = delete;
+        ReadAheadFile& operator=(const ReadAheadFile&) = delete;
+
+    public:
+        // Reads up to the given number of bytes, waiting for them if not yet
+        // available. Returns fewer bytes only at the end of the file, or on
+        // error.
+        size_t read(void* buffer, size_t size);
+
+        // Returns true if no more bytes can be read, which, as with BStdFile,
+        // is known as soon as the last bytes are read.
+        bool eof();
+
+        bool error() const;
+
+        // Moves to the given position in the file, discarding any bytes
+        // already read ahead.
+        bool seek(long long offset);
+
+        // Returns the position in the file of the next byte to be read.
+        long long tell() const;
+
+        // Returns the file size, or -1 if not known.
+        long long getSize() const;
+
+        // Returns the total time spent waiting for bytes to be read, in
+        // seconds.
+        double getWaitTime() const;
+
+    private:
+        void start();
+        void stop();
+
+        void readBlocks();
+
+        // Waits until a block is available to the consumer, or the end of
+        // the file is reached. Must be called with the mutex locked.
+        void waitForBlock(std::unique_lock<std::mutex>& lock);
+
+    private:
+        FILE* file_;
+        long long size_;
+
+        std::vector<std::vector<unsigned char>> blocks_;
+        std::vector<size_t> block_sizes_;
+
+        // Index of the block being read by the consumer, and number of
+        // blocks filled by the background thread, from this block onwards
+        size_t first_block_;
+        size_t filled_blocks_;
+
+        // Position of the next byte to be read in the first block
+        size_t block_position_;
+
+        long long position_;
+
+        bool done_;
+        bool error_;
+        bool stop_;
+
+        std::chrono::steady_clock::duration wait_time_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+        std::thread thread_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_READ_AHEAD_FILE_H)
+
+//------------------------------------------------------------------------------
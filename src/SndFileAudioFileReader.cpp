@@ -25,10 +25,23 @@
 #include "AudioProcessor.h"
 #include "Streams.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Number of processor buffers in each part of the file decoded by a separate
+// thread
+
+static const int PARALLEL_CHUNK_BUFFERS = 4;
 
 //------------------------------------------------------------------------------
 
@@ -45,7 +58,9 @@ static void showInfo(std::ostream& stream, const SF_INFO& info)
 //------------------------------------------------------------------------------
 
 SndFileAudioFileReader::SndFileAudioFileReader() :
-    input_file_(nullptr)
+    input_file_(nullptr),
+    threads_(1),
+    file_(nullptr)
 {
     memset(&info_, 0, sizeof(info_));
 }
@@ -61,7 +76,22 @@ SndFileAudioFileReader::~SndFileAudioFileReader()
 
 bool SndFileAudioFileReader::open(const char* input_filename, bool show_info)
 {
-    input_file_ = sf_open(input_filename, SFM_READ, &info_);
+    if (strcmp(input_filename, "-") == 0) {
+        // libsndfile reads from a pipe without seeking, for formats whose
+        // header comes before the audio data.
+
+        input_file_ = sf_open_fd(fileno(stdin), SFM_READ, &info_, 0);
+    }
+    else {
+        if (read_ahead_size_ > 0) {
+            input_file_ = openWithReadAhead(input_filename);
+        }
+        else {
+            input_file_ = sf_open(input_filename, SFM_READ, &info_);
+        }
+
+        filename_ = input_filename;
+    }
 
     if (input_file_ != nullptr) {
         output_stream << "Input file: " << input_filename << std::endl;
@@ -80,12 +110,192 @@ bool SndFileAudioFileReader::open(const char* input_filename, bool show_info)
 
 //------------------------------------------------------------------------------
 
+void SndFileAudioFileReader::setThreads(int threads)
+{
+    threads_ = threads;
+}
+
+//------------------------------------------------------------------------------
+
 void SndFileAudioFileReader::close()
 {
     if (input_file_ != nullptr) {
         sf_close(input_file_);
         input_file_ = nullptr;
     }
+
+    read_ahead_.reset();
+
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// libsndfile virtual I/O functions, for reading through a ReadAheadFile.
+
+static sf_count_t getFileLength(void* user_data)
+{
+    return static_cast<ReadAheadFile*>(user_data)->getSize();
+}
+
+//------------------------------------------------------------------------------
+
+static sf_count_t seekFile(sf_count_t offset, int whence, void* user_data)
+{
+    ReadAheadFile* file = static_cast<ReadAheadFile*>(user_data);
+
+    if (whence == SEEK_CUR) {
+        offset += file->tell();
+    }
+    else if (whence == SEEK_END) {
+        offset += file->getSize();
+    }
+
+    file->seek(offset);
+
+    return file->tell();
+}
+
+//------------------------------------------------------------------------------
+
+static sf_count_t readFile(void* buffer, sf_count_t count, void* user_data)
+{
+    ReadAheadFile* file = static_cast<ReadAheadFile*>(user_data);
+
+    return static_cast<sf_count_t>(
+        file->read(buffer, static_cast<size_t>(count))
+    );
+}
+
+//------------------------------------------------------------------------------
+
+static sf_count_t writeFile(const void*, sf_count_t, void*)
+{
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+static sf_count_t tellFile(void* user_data)
+{
+    return static_cast<ReadAheadFile*>(user_data)->tell();
+}
+
+//------------------------------------------------------------------------------
+
+SNDFILE* SndFileAudioFileReader::openWithReadAhead(const char* input_filename)
+{
+    file_ = fopen(input_filename, "rb");
+
+    if (file_ == nullptr) {
+        return nullptr;
+    }
+
+    read_ahead_.reset(new ReadAheadFile(file_, read_ahead_size_));
+
+    SF_VIRTUAL_IO virtual_io;
+
+    virtual_io.get_filelen = getFileLength;
+    virtual_io.seek        = seekFile;
+    virtual_io.read        = readFile;
+    virtual_io.write       = writeFile;
+    virtual_io.tell        = tellFile;
+
+    SNDFILE* input_file = sf_open_virtual(
+        &virtual_io, SFM_READ, &info_, read_ahead_.get()
+    );
+
+    if (input_file == nullptr) {
+        close();
+    }
+
+    return input_file;
+}
+
+//------------------------------------------------------------------------------
+
+// Moves to the given frame, and returns the frame reached, which is earlier if
+// the input is shorter. Inputs that can't seek, such as pipes, are read up to
+// the given frame.
+
+sf_count_t SndFileAudioFileReader::seekFrame(const sf_count_t frame)
+{
+    if (frame <= 0) {
+        return 0;
+    }
+
+    if (info_.seekable) {
+        const sf_count_t position = sf_seek(
+            input_file_, std::min(frame, info_.frames), SEEK_SET
+        );
+
+        if (position >= 0) {
+            return position;
+        }
+    }
+
+    const int BUFFER_SIZE = 16384;
+
+    short buffer[BUFFER_SIZE];
+
+    const sf_count_t max_frames = BUFFER_SIZE / info_.channels;
+
+    sf_count_t position = 0;
+
+    while (position < frame) {
+        const sf_count_t frames_read = sf_readf_short(
+            input_file_,
+            buffer,
+            std::min(max_frames, frame - position)
+        );
+
+        if (frames_read <= 0) {
+            break;
+        }
+
+        position += frames_read;
+    }
+
+    return position;
+}
+
+//------------------------------------------------------------------------------
+
+// Reads up to the given number of frames as 16-bit samples, and returns the
+// number of frames read.
+
+static sf_count_t readFrames(
+    SNDFILE* input_file,
+    const SF_INFO& info,
+    const bool is_floating_point,
+    short* buffer,
+    float* float_buffer,
+    const sf_count_t frames)
+{
+    sf_count_t frames_read;
+
+    if (is_floating_point) {
+        frames_read = sf_readf_float(input_file, float_buffer, frames);
+
+        // Scale floating-point samples from [-1.0, 1.0] to 16-bit integer
+        // range. Note: we don't use SFC_SET_SCALE_FLOAT_INT_READ as this
+        // scales using the overall measured waveform peak amplitude,
+        // resulting in an unwanted amplitude change.
+
+        for (int i = 0; i < frames_read * info.channels; ++i) {
+            buffer[i] = static_cast<short>(
+                float_buffer[i] * std::numeric_limits<short>::max()
+            );
+        }
+    }
+    else {
+        frames_read = sf_readf_short(input_file, buffer, frames);
+    }
+
+    return frames_read;
 }
 
 //------------------------------------------------------------------------------
@@ -111,56 +321,287 @@ bool SndFileAudioFileReader::run(AudioProcessor& processor)
 
     sf_count_t total_frames_read = 0;
 
+    // When reading from a pipe, the number of frames may not be known until
+    // the end of the input.
+
+    const sf_count_t total_frames =
+        info_.seekable && info_.frames != SF_COUNT_MAX ? info_.frames : 0;
+
     bool success = true;
 
-    success = processor.init(info_.samplerate, info_.channels, static_cast<long>(info_.frames), BUFFER_SIZE);
+    success = processor.init(info_.samplerate, info_.channels, static_cast<long>(total_frames), BUFFER_SIZE);
 
     if (success) {
-        showProgress(0, info_.frames);
+        // Read only the range of frames the processor needs, seeking to the
+        // first of them if possible.
+
+        const sf_count_t end_frame = processor.getRangeEndFrame();
+        const sf_count_t start_frame = seekFrame(processor.getRangeStartFrame());
+
+        sf_count_t position = start_frame;
+
+        const sf_count_t progress_total = total_frames > 0 ?
+            std::min(end_frame, total_frames) - start_frame : 0;
+
+        if (progress_total > 0) {
+            showProgress(0, progress_total);
+        }
+
+        // Large ranges of seekable files are decoded on several threads.
+
+        const sf_count_t range_end = std::min(end_frame, total_frames);
+
+        const bool parallel = threads_ > 1 && total_frames > 0 &&
+            !filename_.empty() &&
+            range_end - start_frame > PARALLEL_CHUNK_BUFFERS * frames_to_read;
+
+        if (parallel) {
+            success = runParallel(
+                processor,
+                static_cast<int>(frames_to_read),
+                start_frame,
+                range_end,
+                progress_total,
+                total_frames_read
+            );
+        }
+        else {
+            while (success && frames_read == frames_to_read && position < end_frame) {
+                frames_to_read = std::min(
+                    static_cast<sf_count_t>(BUFFER_SIZE / info_.channels),
+                    end_frame - position
+                );
 
-        while (success && frames_read == frames_to_read) {
-            if (is_floating_point) {
-                frames_read = sf_readf_float(
+                frames_read = readFrames(
                     input_file_,
+                    info_,
+                    is_floating_point,
+                    input_buffer,
                     float_buffer,
                     frames_to_read
                 );
 
-                // Scale floating-point samples from [-1.0, 1.0] to 16-bit
-                // integer range. Note: we don't use SFC_SET_SCALE_FLOAT_INT_READ
-                // as this scales using the overall measured waveform peak
-                // amplitude, resulting in an unwanted amplitude change.
+                success = processor.process(
+                    input_buffer,
+                    static_cast<int>(frames_read)
+                );
+
+                total_frames_read += frames_read;
+                position += frames_read;
 
-                for (int i = 0; i < frames_read * info_.channels; ++i) {
-                    input_buffer[i] = static_cast<short>(
-                        float_buffer[i] * std::numeric_limits<short>::max()
-                    );
+                if (progress_total > 0) {
+                    showProgress(total_frames_read, progress_total);
                 }
             }
-            else {
-                frames_read = sf_readf_short(
-                    input_file_,
-                    input_buffer,
-                    frames_to_read
+        }
+
+        output_stream << "\nRead " << total_frames_read << " frames\n";
+
+        if (read_ahead_ != nullptr) {
+            showWaitTime(read_ahead_->getWaitTime());
+        }
+
+        processor.done();
+    }
+
+    close();
+
+    return success;
+}
+
+//------------------------------------------------------------------------------
+
+// Decodes the given range of frames in fixed size chunks, each thread with its
+// own libsndfile handle decoding every n'th chunk, and passes the decoded
+// frames to the processor in order, in the same size buffers as run().
+
+bool SndFileAudioFileReader::runParallel(
+    AudioProcessor& processor,
+    const int buffer_frames,
+    const sf_count_t start_frame,
+    const sf_count_t end_frame,
+    const sf_count_t progress_total,
+    sf_count_t& total_frames_read)
+{
+    struct Chunk
+    {
+        std::vector<short> samples;
+        sf_count_t frames;
+        bool filled;
+        bool error;
+    };
+
+    const int sub_type = info_.format & SF_FORMAT_SUBMASK;
+
+    const bool is_floating_point = sub_type == SF_FORMAT_FLOAT ||
+                                   sub_type == SF_FORMAT_DOUBLE;
+
+    const sf_count_t chunk_frames =
+        static_cast<sf_count_t>(buffer_frames) * PARALLEL_CHUNK_BUFFERS;
+
+    const sf_count_t chunk_count =
+        (end_frame - start_frame + chunk_frames - 1) / chunk_frames;
+
+    const int threads = static_cast<int>(
+        std::min(static_cast<sf_count_t>(threads_), chunk_count)
+    );
+
+    // Each thread may fill up to two chunks ahead of the processor.
+    std::vector<Chunk> chunks(static_cast<size_t>(threads) * 2);
+
+    for (auto& chunk : chunks) {
+        chunk.frames = 0;
+        chunk.filled = false;
+        chunk.error  = false;
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    // Index of the next chunk to be processed
+    sf_count_t next_chunk = 0;
+
+    bool stop = false;
+
+    const sf_count_t slots = static_cast<sf_count_t>(chunks.size());
+
+    auto decode = [&](const int thread) {
+        SF_INFO info;
+        memset(&info, 0, sizeof(info));
+
+        SNDFILE* input_file = sf_open(filename_.c_str(), SFM_READ, &info);
+
+        const size_t chunk_size = static_cast<size_t>(chunk_frames * info_.channels);
+
+        std::vector<short> samples(chunk_size);
+        std::vector<float> float_buffer(is_floating_point ? chunk_size : 0);
+
+        for (sf_count_t index = thread; index < chunk_count; index += threads) {
+            const sf_count_t first_frame = start_frame + index * chunk_frames;
+            const sf_count_t frames = std::min(chunk_frames, end_frame - first_frame);
+
+            samples.resize(chunk_size);
+
+            sf_count_t frames_read = 0;
+
+            const bool error = input_file == nullptr ||
+                sf_seek(input_file, first_frame, SEEK_SET) != first_frame;
+
+            if (!error) {
+                frames_read = readFrames(
+                    input_file,
+                    info_,
+                    is_floating_point,
+                    samples.data(),
+                    float_buffer.data(),
+                    frames
                 );
             }
 
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // Wait until the chunk that last used this slot is processed.
+
+            condition.wait(lock, [&] {
+                return stop || index < next_chunk + slots;
+            });
+
+            if (stop) {
+                break;
+            }
+
+            Chunk& chunk = chunks[static_cast<size_t>(index % slots)];
+
+            chunk.samples.swap(samples);
+            chunk.frames = frames_read;
+            chunk.filled = true;
+            chunk.error  = error;
+
+            condition.notify_all();
+
+            if (error) {
+                break;
+            }
+        }
+
+        if (input_file != nullptr) {
+            sf_close(input_file);
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (int thread = 0; thread < threads; ++thread) {
+        workers.emplace_back(decode, thread);
+    }
+
+    bool success = true;
+
+    std::vector<short> samples;
+
+    for (; next_chunk < chunk_count && success; ) {
+        sf_count_t frames;
+        bool error;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            Chunk& chunk = chunks[static_cast<size_t>(next_chunk % slots)];
+
+            condition.wait(lock, [&] { return chunk.filled; });
+
+            samples.swap(chunk.samples);
+            frames = chunk.frames;
+            error  = chunk.error;
+
+            chunk.filled = false;
+            next_chunk++;
+
+            condition.notify_all();
+        }
+
+        if (error) {
+            error_stream << "\nFailed to read file: " << filename_ << '\n';
+            success = false;
+            break;
+        }
+
+        for (sf_count_t done = 0; done < frames && success; done += buffer_frames) {
+            const sf_count_t count = std::min(
+                static_cast<sf_count_t>(buffer_frames), frames - done
+            );
+
             success = processor.process(
-                input_buffer,
-                static_cast<int>(frames_read)
+                samples.data() + done * info_.channels,
+                static_cast<int>(count)
             );
 
-            total_frames_read += frames_read;
+            total_frames_read += count;
 
-            showProgress(total_frames_read, info_.frames);
+            if (progress_total > 0) {
+                showProgress(total_frames_read, progress_total);
+            }
         }
 
-        output_stream << "\nRead " << total_frames_read << " frames\n";
+        // A short chunk is the end of the file.
 
-        processor.done();
+        const sf_count_t first_frame = start_frame + (next_chunk - 1) * chunk_frames;
+
+        if (frames < std::min(chunk_frames, end_frame - first_frame)) {
+            break;
+        }
     }
 
-    close();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+
+    condition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
 
     return success;
 }
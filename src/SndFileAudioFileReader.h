@@ -27,7 +27,10 @@
 //------------------------------------------------------------------------------
 
 #include "AudioFileReader.h"
+#include "ReadAheadFile.h"
 
+#include <cstdio>
+#include <memory>
 #include <string>
 
 #include <sndfile.h>
@@ -48,12 +51,37 @@ class SndFileAudioFileReader : public AudioFileReader
 
         virtual bool run(AudioProcessor& processor);
 
+        // Decodes seekable input files on the given number of threads, each
+        // reading a separate part of the file. Must be called before run().
+        void setThreads(int threads);
+
     private:
         void close();
+        sf_count_t seekFrame(sf_count_t frame);
+
+        bool runParallel(
+            AudioProcessor& processor,
+            int buffer_frames,
+            sf_count_t start_frame,
+            sf_count_t end_frame,
+            sf_count_t progress_total,
+            sf_count_t& total_frames_read
+        );
+
+        SNDFILE* openWithReadAhead(const char* input_filename);
 
     private:
         SNDFILE* input_file_;
         SF_INFO info_;
+
+        // Empty when reading from standard input
+        std::string filename_;
+
+        int threads_;
+
+        // Used with read-ahead only
+        FILE* file_;
+        std::unique_ptr<ReadAheadFile> read_ahead_;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "TextFormat.h"
+
+#include <ostream>
+
+//------------------------------------------------------------------------------
+
+namespace TextFormat {
+
+//------------------------------------------------------------------------------
+
+const char DIGIT_PAIRS[200] = {
+    '0','0', '0','1', '0','2', '0','3', '0','4', '0','5', '0','6', '0','7', '0','8', '0','9',
+    '1','0', '1','1', '1','2', '1','3', '1','4', '1','5', '1','6', '1','7', '1','8', '1','9',
+    '2','0', '2','1', '2','2', '2','3', '2','4', '2','5', '2','6', '2','7', '2','8', '2','9',
+    '3','0', '3','1', '3','2', '3','3', '3','4', '3','5', '3','6', '3','7', '3','8', '3','9',
+    '4','0', '4','1', '4','2', '4','3', '4','4', '4','5', '4','6', '4','7', '4','8', '4','9',
+    '5','0', '5','1', '5','2', '5','3', '5','4', '5','5', '5','6', '5','7', '5','8', '5','9',
+    '6','0', '6','1', '6','2', '6','3', '6','4', '6','5', '6','6', '6','7', '6','8', '6','9',
+    '7','0', '7','1', '7','2', '7','3', '7','4', '7','5', '7','6', '7','7', '7','8', '7','9',
+    '8','0', '8','1', '8','2', '8','3', '8','4', '8','5', '8','6', '8','7', '8','8', '8','9',
+    '9','0', '9','1', '9','2', '9','3', '9','4', '9','5', '9','6', '9','7', '9','8', '9','9'
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace TextFormat
+
+//------------------------------------------------------------------------------
+
+ChunkedTextWriter::ChunkedTextWriter(
+    std::ostream& stream,
+    const size_t max_item_length,
+    const int threads) :
+    stream_(stream),
+    max_item_length_(max_item_length),
+    threads_(threads > 0 ? static_cast<size_t>(threads) : std::thread::hardware_concurrency())
+{
+    if (threads_ == 0) {
+        threads_ = 1;
+    }
+
+    // Buffers are allocated on first use, and only as large as needed, so
+    // that short sequences don't reserve memory for every thread.
+    buffers_.resize(threads_);
+}
+
+//------------------------------------------------------------------------------
+
+char* ChunkedTextWriter::getBuffer(const size_t index, const size_t items)
+{
+    std::vector<char>& buffer = buffers_[index];
+
+    const size_t size = items * max_item_length_;
+
+    if (buffer.size() < size) {
+        buffer.resize(size);
+    }
+
+    return &buffer[0];
+}
+
+//------------------------------------------------------------------------------
+
+void ChunkedTextWriter::writeBuffer(const size_t index, const char* end)
+{
+    const char* begin = &buffers_[index][0];
+
+    stream_.write(begin, end - begin);
+}
+
+//------------------------------------------------------------------------------
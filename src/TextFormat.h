@@ -0,0 +1,184 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_TEXT_FORMAT_H)
+#define INC_TEXT_FORMAT_H
+
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstring>
+#include <iosfwd>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace TextFormat {
+    // Maximum number of characters written by formatInt(), e.g: "-2147483648"
+    const size_t MAX_INT_LENGTH = 11;
+
+    // Two-character decimal representations of 00 to 99
+    extern const char DIGIT_PAIRS[200];
+
+    // Writes the decimal representation of value to buffer, which must have
+    // room for at least MAX_INT_LENGTH characters. Returns a pointer to the
+    // character following the last one written. No terminator is written.
+
+    inline char* formatInt(char* buffer, int value)
+    {
+        unsigned int magnitude = static_cast<unsigned int>(value);
+
+        if (value < 0) {
+            *buffer++ = '-';
+            magnitude = 0U - magnitude;
+        }
+
+        // Format digits right to left, two at a time, into a local buffer
+        char digits[10];
+        char* end = digits + sizeof(digits);
+        char* start = end;
+
+        while (magnitude >= 100) {
+            const unsigned int pair = (magnitude % 100) * 2;
+            magnitude /= 100;
+            start -= 2;
+            start[0] = DIGIT_PAIRS[pair];
+            start[1] = DIGIT_PAIRS[pair + 1];
+        }
+
+        if (magnitude >= 10) {
+            const unsigned int pair = magnitude * 2;
+            start -= 2;
+            start[0] = DIGIT_PAIRS[pair];
+            start[1] = DIGIT_PAIRS[pair + 1];
+        }
+        else {
+            *--start = static_cast<char>('0' + magnitude);
+        }
+
+        const size_t length = static_cast<size_t>(end - start);
+        memcpy(buffer, start, length);
+
+        return buffer + length;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Formats a sequence of items as text into reusable memory buffers and writes
+// them to an output stream. Large sequences are split into chunks that are
+// formatted concurrently, then written to the stream in their original order.
+
+class ChunkedTextWriter
+{
+    public:
+        ChunkedTextWriter(
+            std::ostream& stream,
+            size_t max_item_length,
+            int threads = 0
+        );
+
+        ChunkedTextWriter(const ChunkedTextWriter&) = delete;
+        ChunkedTextWriter& operator=(const ChunkedTextWriter&) = delete;
+
+    public:
+        // Calls format_item(index, output) for each index in [0, count).
+        // format_item must write at most max_item_length characters to output
+        // and return a pointer past the last character written.
+
+        template<typename FormatFunc>
+        void write(size_t count, FormatFunc format_item);
+
+    private:
+        // Number of items formatted by each thread before the results are
+        // written to the stream
+        static const size_t CHUNK_SIZE = 65536;
+
+        char* getBuffer(size_t index, size_t items);
+        void writeBuffer(size_t index, const char* end);
+
+    private:
+        std::ostream& stream_;
+        size_t max_item_length_;
+        size_t threads_;
+        std::vector<std::vector<char>> buffers_;
+};
+
+//------------------------------------------------------------------------------
+
+template<typename FormatFunc>
+void ChunkedTextWriter::write(size_t count, FormatFunc format_item)
+{
+    size_t begin = 0;
+
+    while (begin < count) {
+        const size_t remaining = count - begin;
+        const size_t chunks = (remaining + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        const size_t round_chunks = chunks < threads_ ? chunks : threads_;
+
+        std::vector<char*> ends(round_chunks);
+
+        auto format_chunk = [&](size_t chunk) {
+            const size_t first = begin + chunk * CHUNK_SIZE;
+            size_t last = first + CHUNK_SIZE;
+
+            if (last > count) {
+                last = count;
+            }
+
+            char* output = getBuffer(chunk, last - first);
+
+            for (size_t i = first; i < last; ++i) {
+                output = format_item(i, output);
+            }
+
+            ends[chunk] = output;
+        };
+
+        std::vector<std::thread> workers;
+
+        for (size_t chunk = 1; chunk < round_chunks; ++chunk) {
+            workers.emplace_back(format_chunk, chunk);
+        }
+
+        format_chunk(0);
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (size_t chunk = 0; chunk < round_chunks; ++chunk) {
+            writeBuffer(chunk, ends[chunk]);
+        }
+
+        const size_t done = round_chunks * CHUNK_SIZE;
+        begin = done < remaining ? begin + done : count;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_TEXT_FORMAT_H)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,196 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "TileRenderer.h"
+#include "GdImageRenderer.h"
+#include "Options.h"
+#include "Streams.h"
+#include "WaveformBuffer.h"
+#include "WaveformRescaler.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+//------------------------------------------------------------------------------
+
+// Returns the start time of the tile that begins at the given pixel, such
+// that GdImageRenderer converts it back to the same pixel, despite rounding.
+
+static double getStartTime(const WaveformBuffer& buffer, const int pixel)
+{
+    const int sample_rate       = buffer.getSampleRate();
+    const int samples_per_pixel = buffer.getSamplesPerPixel();
+
+    double seconds = static_cast<double>(pixel) * samples_per_pixel / sample_rate;
+
+    // See GdImageRenderer::secondsToPixels()
+    while (static_cast<int>(seconds * sample_rate / samples_per_pixel) < pixel) {
+        seconds = std::nextafter(seconds, std::numeric_limits<double>::max());
+    }
+
+    return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+TileRenderer::TileRenderer(const Options& options) :
+    options_(options),
+    colors_(createWaveformColors(options))
+{
+}
+
+//------------------------------------------------------------------------------
+
+// Renders the tiles of each channel into a separate directory, if the buffer
+// has more than one channel.
+
+bool TileRenderer::render(
+    WaveformBuffer& buffer,
+    const fs::path& output_directory)
+{
+    if (options_.getImageWidth() < 1) {
+        error_stream << "Invalid image width: minimum 1\n";
+        return false;
+    }
+
+    if (buffer.getNumChannels() == 1) {
+        return renderChannel(buffer, output_directory);
+    }
+
+    std::vector<WaveformBuffer> buffers = buffer.SplitChannels();
+
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const fs::path channel_directory =
+            output_directory / ("chan" + std::to_string(i));
+
+        if (!renderChannel(buffers[i], channel_directory)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool TileRenderer::renderChannel(
+    const WaveformBuffer& buffer,
+    const fs::path& output_directory)
+{
+    const int tile_width = options_.getImageWidth();
+
+    int levels = 1;
+
+    for (int size = buffer.getSize(); size > tile_width; size = (size + 1) / 2) {
+        levels++;
+    }
+
+    // Use the same amplitude scale for all tiles, so that they match
+    double amplitude_scale = options_.getAmplitudeScale();
+
+    if (options_.isAutoAmplitudeScale()) {
+        amplitude_scale = GdImageRenderer::getAutoAmplitudeScale(
+            buffer, 0, buffer.getSize()
+        );
+    }
+
+    const WaveformBuffer* level_buffer = &buffer;
+    std::unique_ptr<WaveformBuffer> rescaled_buffer;
+
+    for (int zoom = levels - 1; zoom >= 0; --zoom) {
+        if (zoom != levels - 1) {
+            const int samples_per_pixel = level_buffer->getSamplesPerPixel();
+
+            if (samples_per_pixel > std::numeric_limits<int>::max() / 2) {
+                error_stream << "Invalid zoom: maximum " << std::numeric_limits<int>::max() << '\n';
+                return false;
+            }
+
+            std::unique_ptr<WaveformBuffer> next_buffer(new WaveformBuffer);
+
+            WaveformRescaler rescaler;
+
+            if (!rescaler.rescale(*level_buffer, *next_buffer, samples_per_pixel * 2)) {
+                return false;
+            }
+
+            rescaled_buffer = std::move(next_buffer);
+            level_buffer = rescaled_buffer.get();
+        }
+
+        const fs::path level_directory = output_directory / std::to_string(zoom);
+
+        if (!renderLevel(*level_buffer, amplitude_scale, level_directory)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// Renders the tiles of one zoom level concurrently.
+
+bool TileRenderer::renderLevel(
+    const WaveformBuffer& buffer,
+    const double amplitude_scale,
+    const fs::path& level_directory)
+{
+    const int tile_width = options_.getImageWidth();
+    const int tile_count = (buffer.getSize() + tile_width - 1) / tile_width;
+
+    output_stream << "Rendering " << tile_count << " tiles at "
+                  << buffer.getSamplesPerPixel() << " samples/pixel to "
+                  << level_directory.string() << '\n';
+
+    fs::create_directories(level_directory);
+
+    return renderImagesConcurrently(
+        tile_count,
+        [&](int x, GdImageRenderer& renderer) {
+            const fs::path filename = level_directory / (std::to_string(x) + ".png");
+
+            return renderer.create(
+                buffer,
+                getStartTime(buffer, x * tile_width),
+                tile_width,
+                options_.getImageHeight(),
+                colors_,
+                options_.getRenderAxisLabels(),
+                false,
+                amplitude_scale,
+                options_.getPngPalette()) &&
+                renderer.saveAsPng(
+                    filename.string().c_str(),
+                    options_.getPngCompressionLevel());
+        }
+    );
+}
+
+//------------------------------------------------------------------------------
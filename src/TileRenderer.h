@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_TILE_RENDERER_H)
+#define INC_TILE_RENDERER_H
+
+//------------------------------------------------------------------------------
+
+#include "WaveformColors.h"
+
+#include <boost/filesystem.hpp>
+
+//------------------------------------------------------------------------------
+
+class Options;
+class WaveformBuffer;
+
+//------------------------------------------------------------------------------
+
+// Renders a pyramid of fixed size waveform image tiles, as used by deep zoom
+// viewers. The most detailed zoom level is that of the given waveform data,
+// and each following level is rescaled from the previous one at half its
+// resolution, until the whole waveform fits in one tile. Only tiles that
+// cover the waveform are written, to <directory>/<zoom>/<x>.png, where zoom
+// level 0 is the least detailed.
+
+class TileRenderer
+{
+    public:
+        explicit TileRenderer(const Options& options);
+
+        TileRenderer(const TileRenderer&) = delete;
+        TileRenderer& operator=(const TileRenderer&) = delete;
+
+    public:
+        bool render(
+            WaveformBuffer& buffer,
+            const boost::filesystem::path& output_directory
+        );
+
+    private:
+        bool renderChannel(
+            const WaveformBuffer& buffer,
+            const boost::filesystem::path& output_directory
+        );
+
+        bool renderLevel(
+            const WaveformBuffer& buffer,
+            double amplitude_scale,
+            const boost::filesystem::path& level_directory
+        );
+
+    private:
+        const Options& options_;
+        const WaveformColors colors_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_TILE_RENDERER_H)
+
+//------------------------------------------------------------------------------
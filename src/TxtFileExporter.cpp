@@ -23,67 +23,104 @@
 #include "Streams.h"
 #include "WaveformBuffer.h"
 #include "Options.h"
+#include "TextFormat.h"
 #include "Utils.h"
 
 //------------------------------------------------------------------------------
 
+// Longest line written by writeData(): "min,max,chan\n"
+
+static const size_t MAX_LINE_LENGTH = 3 * TextFormat::MAX_INT_LENGTH + 3;
+
+//------------------------------------------------------------------------------
+
 TxtFileExporter::TxtFileExporter(WaveformBuffer &buffer,
                                  const Options &options,
                                  const fs::path& output_filename):
-	FileExporter(buffer, options, output_filename),
-	bits_(options.getBits())
+	FileExporter(buffer, options, output_filename)
 {
 }
 
 //------------------------------------------------------------------------------
 
-void TxtFileExporter::writeFile(std::ofstream& stream) {
-	if (!buffer_.channelSizesMatch()) {
-		std::stringstream ss;
-		ss << "channel sizes do not match. " << std::endl;
-		for (int i = 0; i < buffer_.getNumChannels(); ++i) {
-			ss << "\tChannel: " << i << " size: "
-			   << buffer_.getSize(i) << std::endl;
+void TxtFileExporter::beginOutput(int channels)
+{
+	if (FileExporter::VERSION_3 == version_) {
+		throwErrorEx("TxtFileExporter::beginOutput",
+		             "file version 3 is only available for .dat files",
+		             output_filename_.string());
+	}
+
+	channels_ = channels;
+	streams_.clear();
+	writers_.clear();
+
+	const int outputs = (FileExporter::VERSION_1 == version_) ? channels_ : 1;
+
+	for (int chan = 0; chan < outputs; ++chan) {
+		std::string filename;
+		streams_.push_back(openFile(chan, filename));
+
+		if (FileExporter::VERSION_1 == version_) {
+			output_stream << "Writing channel " << std::to_string(chan) 
+			              << " to output file: " << filename << std::endl;
+		} else {
+			output_stream << "Writing channel data to output file: " << filename << std::endl;
 		}
-		throwErrorEx("TxtFileExporter::writeHeader", ss.str());
 	}
-	std::string filename;
-	FILE_VERSION version = static_cast<FILE_VERSION>(options_.getFileVersion());
-	WaveformBuffer::size_type size = buffer_.getSize();
-	switch (version) {
+
+	// Writers are kept for the whole export, so their buffers are reused
+	// for each block of points.
+	for (auto& stream : streams_) {
+		writers_.emplace_back(new ChunkedTextWriter(*stream, MAX_LINE_LENGTH));
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void TxtFileExporter::writeOutput()
+{
+	checkChannelSizes("TxtFileExporter::writeOutput");
+
+	WaveformBuffer::size_type size = static_cast<WaveformBuffer::size_type>(buffer_.getSize());
+	switch (version_) {
 		case FileExporter::VERSION_1: {
-			for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
-				if (openFile(stream, chan, filename)) {
-					output_stream << "Writing channel " << std::to_string(chan) 
-				                  << " to output file: " << filename << std::endl;
-					for (WaveformBuffer::size_type len = 0; len < size; ++len) {
-						writeData(stream, chan, len, version);
-					}
-					closeFile(stream);
-				}
+			for (int chan = 0; chan < channels_; ++chan) {
+				writers_[chan]->write(size, [&](size_t len, char* output) {
+					return writeData(output, chan, len, version_);
+				});
 			}
 		} break;
 		case FileExporter::VERSION_2: {
-			if (openFile(stream, 0, filename)) {
-				output_stream << "Writing channel data to output file: " << filename << std::endl;
-				for (WaveformBuffer::size_type len = 0; len < size; ++len) {
-					for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
-						writeData(stream, chan, len, version);
-					}
-				}
-				closeFile(stream);
-			}
+			// One line per channel per point, with channels interleaved.
+			const size_t channels = static_cast<size_t>(channels_);
+			writers_[0]->write(size * channels, [&](size_t line, char* output) {
+				return writeData(output, static_cast<int>(line % channels),
+				                 line / channels, version_);
+			});
 		} break;
 		default:
-			throwErrorEx("TxtFileExporter::writeFile",
-			             "unknown file version " + std::to_string(version),
-			             filename);
+			throwErrorEx("TxtFileExporter::writeOutput",
+			             "unknown file version " + std::to_string(version_),
+			             output_filename_.string());
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void TxtFileExporter::finishOutput()
+{
+	writers_.clear();
+	for (auto& stream : streams_) {
+		closeFile(stream);
 	}
+	streams_.clear();
 }
 
 //------------------------------------------------------------------------------
 
-void TxtFileExporter::writeData(std::ofstream& stream, int chan, size_t len, FILE_VERSION version)
+char* TxtFileExporter::writeData(char* output, int chan, size_t len,
+                                 FILE_VERSION version) const
 {
 	short min = buffer_.getMinSample(len, chan);
 	short max = buffer_.getMaxSample(len, chan);
@@ -91,9 +128,13 @@ void TxtFileExporter::writeData(std::ofstream& stream, int chan, size_t len, FIL
 		min /= 256;
 		max /= 256;
 	}
-	stream << min << ',' << max;
+	output = TextFormat::formatInt(output, min);
+	*output++ = ',';
+	output = TextFormat::formatInt(output, max);
 	if (VERSION_2 == version) {
-		stream << ',' << chan;
+		*output++ = ',';
+		output = TextFormat::formatInt(output, chan);
 	}
-	stream << std::endl;
+	*output++ = '\n';
+	return output;
 }
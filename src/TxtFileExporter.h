@@ -23,6 +23,10 @@
 #define INC_TXT_FILE_EXPORTER_H
 
 #include "FileExporter.h"
+#include "TextFormat.h"
+
+#include <memory>
+#include <vector>
 
 class TxtFileExporter: public FileExporter
 {
@@ -38,10 +42,18 @@ class TxtFileExporter: public FileExporter
 		TxtFileExporter& operator=(const TxtFileExporter &) = delete;
 
 	private:
-	    void writeFile(std::ofstream& stream);
+		void beginOutput(int channels);
+		void writeOutput();
+		void finishOutput();
+
+		// Formats one line ("min,max" or "min,max,chan") into output and
+		// returns a pointer past the end of the line.
+		char* writeData(char* output, int chan, size_t len,
+		                FILE_VERSION version) const;
 
-		void writeData(std::ofstream& stream, int chan, size_t len, FILE_VERSION version);
-		int bits_;
+		// One stream per channel for version 1, otherwise a single stream
+		std::vector<std::unique_ptr<std::ostream>> streams_;
+		std::vector<std::unique_ptr<ChunkedTextWriter>> writers_;
 };
 
 #endif
\ No newline at end of file
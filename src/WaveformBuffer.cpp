@@ -56,7 +56,8 @@ static void reportWriteError(const char* filename, const char* message)
 WaveformBuffer::WaveformBuffer() :
     sample_rate_(0),
     samples_per_pixel_(0),
-    bits_(16)
+    bits_(16),
+    offset_(0)
 {
 	// Must always have at least one channel.
 	channels_.push_back(vector_type());
@@ -72,6 +73,7 @@ std::vector<WaveformBuffer> WaveformBuffer::SplitChannels()
 		b.sample_rate_       = sample_rate_;
 		b.samples_per_pixel_ = samples_per_pixel_;
 		b.bits_              = bits_;
+		b.offset_            = offset_;
 		b.channels_[0]       = channels_[i];
 		ret.push_back(b);
 	}
@@ -131,6 +133,18 @@ int WaveformBuffer::getBits() const
 
 //------------------------------------------------------------------------------
 
+void WaveformBuffer::setOffset(int32_t offset)
+{
+	offset_ = offset;
+}
+
+int32_t WaveformBuffer::getOffset() const
+{
+	return offset_;
+}
+
+//------------------------------------------------------------------------------
+
 void WaveformBuffer::setSize(int32_t size)
 {
 	for (auto &d : channels_) {
@@ -178,6 +192,14 @@ void WaveformBuffer::appendSamples(short min, short max, int chan)
 	channels_[chan].push_back(max);
 }
 
+short* WaveformBuffer::appendPoints(size_type count, int chan)
+{
+	appendChannels(chan);
+	vector_type& samples = channels_[chan];
+	const size_type size = samples.size();
+	samples.resize(size + 2 * count);
+	return samples.data() + size;
+}
 
 void WaveformBuffer::setSamples(size_type index, short min, short max, int chan)
 {
@@ -212,6 +234,7 @@ WaveformBuffer::WaveformBuffer(const WaveformBuffer& buffer)
 	sample_rate_       = buffer.sample_rate_;
 	samples_per_pixel_ = buffer.samples_per_pixel_;
 	bits_              = buffer.bits_;
+	offset_            = buffer.offset_;
 	channels_          = buffer.channels_;
 }
 
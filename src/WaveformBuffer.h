@@ -35,6 +35,7 @@ class WaveformBuffer
 {
     public:
 		static const uint32_t FLAG_8_BIT = 0x00000001U;
+		static const uint32_t FLAG_BLOCK_INDEX = 0x00000002U;
 	
 		typedef std::vector<short> vector_type;
         typedef vector_type::size_type size_type;
@@ -58,9 +59,18 @@ class WaveformBuffer
         int32_t getSize(int chan = 0) const;
         void setSize(int32_t size);
 
+		// Index of the first point held, if the buffer holds only part of
+		// the waveform. Sample indexes are relative to this.
+		void setOffset(int32_t offset);
+		int32_t getOffset() const;
+
         short getMinSample(size_type index, int chan = 0) const;
         short getMaxSample(size_type index, int chan = 0) const;
         void appendSamples(short min, short max, int chan = 0);
+
+		// Appends count points, and returns their interleaved min and max
+		// values for the caller to fill in.
+		short* appendPoints(size_type count, int chan = 0);
         void setSamples(size_type index, short min, short max, int chan = 0);
 
 		int getNumChannels() const;
@@ -70,6 +80,7 @@ class WaveformBuffer
         int sample_rate_;
         int samples_per_pixel_;
         int bits_;
+		int32_t offset_;
 
 		std::vector<vector_type> channels_;
 		
@@ -22,8 +22,14 @@
 //------------------------------------------------------------------------------
 
 #include "WaveformColors.h"
+#include "Options.h"
 #include "Rgba.h"
 
+#include <boost/format.hpp>
+
+#include <stdexcept>
+#include <string>
+
 //------------------------------------------------------------------------------
 
 WaveformColors::WaveformColors()
@@ -73,3 +79,44 @@ const WaveformColors audition_waveform_colors(
 );
 
 //------------------------------------------------------------------------------
+
+WaveformColors createWaveformColors(const Options& options)
+{
+    WaveformColors colors;
+
+    const std::string& color_scheme = options.getColorScheme();
+
+    if (color_scheme == "audacity") {
+        colors = audacity_waveform_colors;
+    }
+    else if (color_scheme == "audition") {
+        colors = audition_waveform_colors;
+    }
+    else {
+        std::string message = boost::str(
+            boost::format("Unknown color scheme: %1%") % color_scheme
+        );
+
+        throw std::runtime_error(message);
+    }
+
+    if (options.hasBorderColor()) {
+        colors.border_color = options.getBorderColor();
+    }
+
+    if (options.hasBackgroundColor()) {
+        colors.background_color = options.getBackgroundColor();
+    }
+
+    if (options.hasWaveformColor()) {
+        colors.waveform_color = options.getWaveformColor();
+    }
+
+    if (options.hasAxisLabelColor()) {
+        colors.axis_label_color = options.getAxisLabelColor();
+    }
+
+    return colors;
+}
+
+//------------------------------------------------------------------------------
@@ -30,6 +30,10 @@
 
 //------------------------------------------------------------------------------
 
+class Options;
+
+//------------------------------------------------------------------------------
+
 class WaveformColors
 {
     public:
@@ -57,6 +61,13 @@ extern const WaveformColors audition_waveform_colors;
 
 //------------------------------------------------------------------------------
 
+// Returns the color scheme given by the command line options, with any
+// individual colors given.
+
+WaveformColors createWaveformColors(const Options& options);
+
+//------------------------------------------------------------------------------
+
 #endif // #if !defined(INC_WAVEFORM_COLORS_H)
 
 //------------------------------------------------------------------------------
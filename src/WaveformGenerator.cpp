@@ -23,10 +23,12 @@
 
 #include "WaveformGenerator.h"
 #include "WaveformBuffer.h"
+#include "FileExporter.h"
 #include "Streams.h"
 
 #include <boost/format.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
@@ -123,12 +125,19 @@ const int RESET_COUNT = 0;
 WaveformGenerator::WaveformGenerator(
     WaveformBuffer &buffer,
 	const ScaleFactor& scale_factor,
-	bool isMono) :
+	bool isMono,
+	FileExporter* exporter) :
     buffer_(buffer),
     scale_factor_(scale_factor),
     channels_(0),
     samples_per_pixel_(0),
-	mono_(isMono)
+    has_point_range_(false),
+    start_time_(0.0),
+    point_count_(0),
+    start_frame_(0),
+    end_frame_(std::numeric_limits<long long>::max()),
+	mono_(isMono),
+	exporter_(exporter)
 {
 }
 
@@ -152,18 +161,43 @@ bool WaveformGenerator::init(
         error_stream << "Invalid zoom: minimum 2\n";
         return false;
     }
+
 	for (int i = 0; i < (mono_ ? (MONO_CHANNEL+1) : channels_); ++i) {
 		counts_.push_back(RESET_COUNT);
 		mins_.push_back(MAX_SAMPLE);
 		maxs_.push_back(MIN_SAMPLE);
+		sizes_.push_back(0);
 		buffer_.setSamplesPerPixel(samples_per_pixel_);
 		buffer_.setSampleRate(sample_rate);
 	}
 
+    if (has_point_range_) {
+        // See GdImageRenderer::secondsToPixels()
+        const long long start_point = std::min(
+            static_cast<long long>(start_time_ * sample_rate / samples_per_pixel_),
+            static_cast<long long>(std::numeric_limits<int32_t>::max())
+        );
+
+        start_frame_ = start_point * samples_per_pixel_;
+        end_frame_   = start_frame_ + static_cast<long long>(point_count_) * samples_per_pixel_;
+
+        buffer_.setOffset(static_cast<int32_t>(start_point));
+
+        // Allocate each channel, as the range may be past the end of the
+        // input and hold no points
+        for (int chan = 0; chan < static_cast<int>(counts_.size()); ++chan) {
+            buffer_.appendPoints(0, chan);
+        }
+    }
+
     output_stream << "Generating waveform data..." << std::endl
                   << "Samples per pixel: " << samples_per_pixel_ << std::endl
                   << "Input channels: " << channels_ << std::endl;
 
+	if (exporter_ != nullptr) {
+		exporter_->begin(static_cast<int>(counts_.size()));
+	}
+
     return true;
 }
 
@@ -176,6 +210,29 @@ int WaveformGenerator::getSamplesPerPixel() const
 
 //------------------------------------------------------------------------------
 
+void WaveformGenerator::setPointRange(double start_time, int count)
+{
+    has_point_range_ = true;
+    start_time_      = start_time;
+    point_count_     = count;
+}
+
+//------------------------------------------------------------------------------
+
+long long WaveformGenerator::getRangeStartFrame() const
+{
+    return start_frame_;
+}
+
+//------------------------------------------------------------------------------
+
+long long WaveformGenerator::getRangeEndFrame() const
+{
+    return end_frame_;
+}
+
+//------------------------------------------------------------------------------
+
 void WaveformGenerator::reset(int chan_num)
 {
 	mins_[chan_num] = MAX_SAMPLE;
@@ -187,15 +244,21 @@ void WaveformGenerator::reset(int chan_num)
 
 void WaveformGenerator::done()
 {
-	for (int chan = 0; chan < buffer_.getNumChannels(); ++chan) {
+	for (int chan = 0; chan < static_cast<int>(counts_.size()); ++chan) {
 		if (counts_[chan] > RESET_COUNT) {
 			buffer_.appendSamples(static_cast<short>(mins_[chan]), 
 			                      static_cast<short>(maxs_[chan]), chan);
+			++sizes_[chan];
 			output_stream << "(channel " << chan << ") Generated " 
-			              << buffer_.getSize(chan) << " points" << std::endl;
+			              << sizes_[chan] << " points" << std::endl;
 			reset(static_cast<int>(chan));
 		}
 	}
+
+	if (exporter_ != nullptr) {
+		exporter_->writePoints();
+		exporter_->finish();
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -222,6 +285,11 @@ bool WaveformGenerator::process(
 			process_channel(sample, MONO_CHANNEL);
 		}
     }
+
+	if (exporter_ != nullptr) {
+		exporter_->writePoints();
+	}
+
     return true;
 }
 
@@ -247,6 +315,7 @@ void WaveformGenerator::process_channel(int sample, int chan_num)
 		buffer_.appendSamples(static_cast<short>(mins_[chan_num]), 
 		                      static_cast<short>(maxs_[chan_num]),
 		                      chan_num);
+		++sizes_[chan_num];
 		reset(chan_num);
 	}
 }
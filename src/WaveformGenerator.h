@@ -26,12 +26,14 @@
 
 //------------------------------------------------------------------------------
 
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include "AudioProcessor.h"
 
 //------------------------------------------------------------------------------
 
+class FileExporter;
 class WaveformBuffer;
 
 //------------------------------------------------------------------------------
@@ -101,7 +103,8 @@ class WaveformGenerator : public AudioProcessor
         WaveformGenerator(
 			WaveformBuffer &buffer,
             const ScaleFactor& scale_factor,
-			bool isMono = true
+			bool isMono = true,
+			FileExporter* exporter = nullptr
         );
 
         WaveformGenerator(const WaveformGenerator&) = delete;
@@ -117,6 +120,10 @@ class WaveformGenerator : public AudioProcessor
 
         int getSamplesPerPixel() const;
 
+        // Limits generation to the given number of points from the point at
+        // the start time, which becomes the buffer's offset.
+        void setPointRange(double start_time, int count);
+
         virtual bool process(
             const short* input_buffer,
             int input_frame_count
@@ -124,6 +131,9 @@ class WaveformGenerator : public AudioProcessor
 
         virtual void done();
 
+        virtual long long getRangeStartFrame() const;
+        virtual long long getRangeEndFrame() const;
+
     private:
         void reset(int chan_num);
 
@@ -135,10 +145,22 @@ class WaveformGenerator : public AudioProcessor
         int channels_;
         int samples_per_pixel_;
 
+        bool has_point_range_;
+        double start_time_;
+        int point_count_;
+
+        long long start_frame_;
+        long long end_frame_;
+
         std::vector<int> counts_;
         std::vector<int> mins_;
         std::vector<int> maxs_;
 		bool mono_;
+
+        // If set, points are passed to the exporter after each block of
+        // input, instead of accumulating in the buffer.
+        FileExporter* exporter_;
+        std::vector<int32_t> sizes_;
 };
 
 //------------------------------------------------------------------------------
@@ -58,9 +58,22 @@ bool WaveformRescaler::rescale(
     assert(input_samples_per_pixel > 0);
     assert(output_samples_per_pixel_ > input_samples_per_pixel);
 
+	// The input buffer may hold only part of the waveform, so start from the
+	// first output pixel that begins within it. Input indexes below are
+	// relative to the start of the whole waveform.
+	const int input_offset = input_buffer.getOffset();
+
+	const int first_output_index = static_cast<int>(
+		(static_cast<int64_t>(input_offset) * input_samples_per_pixel +
+		 output_samples_per_pixel_ - 1) / output_samples_per_pixel_
+	);
+
+	output_buffer.setOffset(first_output_index);
+
 	for(int chan = 0; chan < input_buffer.getNumChannels(); ++chan) {
 		
 		const int input_buffer_size = input_buffer.getSize();
+		const int input_end = input_offset + input_buffer_size;
 
 		output_buffer.setSampleRate(sample_rate_);
 		output_buffer.setSamplesPerPixel(samples_per_pixel);
@@ -70,22 +83,22 @@ bool WaveformRescaler::rescale(
 		              << "\nOutput scale: " << samples_per_pixel << " samples/pixel"
 		              << "\nInput buffer size: " << input_buffer_size << std::endl;
 
+		int output_index = first_output_index;
+		int input_index  = static_cast<int>(sampleAtPixel(output_index) / input_samples_per_pixel);
+
+		int last_input_index = input_index;
+
 		short min = 0;
 		short max = 0;
 
-		if (input_buffer_size > 0) {
-			min = input_buffer.getMinSample(0, chan);
-			max = input_buffer.getMaxSample(0, chan);
+		if (input_index < input_end) {
+			min = input_buffer.getMinSample(input_index - input_offset, chan);
+			max = input_buffer.getMaxSample(input_index - input_offset, chan);
 		}
 
-		int input_index  = 0;
-		int output_index = 0;
-
-		int last_input_index = 0;
-
-		while (input_index < input_buffer_size) {
+		while (input_index < input_end) {
 			while (sampleAtPixel(output_index) / input_samples_per_pixel == input_index) {
-				if (output_index > 0) {
+				if (output_index > first_output_index) {
 					output_buffer.appendSamples(min, max, chan);
 				}
 
@@ -93,8 +106,8 @@ bool WaveformRescaler::rescale(
 
 				output_index++;
 
-				const int where      = sampleAtPixel(output_index);
-				const int prev_where = sampleAtPixel(output_index - 1);
+				const int64_t where      = sampleAtPixel(output_index);
+				const int64_t prev_where = sampleAtPixel(output_index - 1);
 
 				if (where != prev_where) {
 					min = std::numeric_limits<short>::max();
@@ -102,22 +115,22 @@ bool WaveformRescaler::rescale(
 				}
 			}
 
-			const int where = sampleAtPixel(output_index);
+			const int64_t where = sampleAtPixel(output_index);
 
-			int stop = where / input_samples_per_pixel;
+			int64_t stop = where / input_samples_per_pixel;
 
-			if (stop > input_buffer_size) {
-				stop = input_buffer_size;
+			if (stop > input_end) {
+				stop = input_end;
 			}
 
 			while (input_index < stop) {
-				short value = input_buffer.getMinSample(input_index, chan);
+				short value = input_buffer.getMinSample(input_index - input_offset, chan);
 
 				if (value < min) {
 					min = value;
 				}
 
-				value = input_buffer.getMaxSample(input_index, chan);
+				value = input_buffer.getMaxSample(input_index - input_offset, chan);
 
 				if (value > max) {
 					max = value;
@@ -140,9 +153,9 @@ bool WaveformRescaler::rescale(
 
 //------------------------------------------------------------------------------
 
-int WaveformRescaler::sampleAtPixel(const int x) const
+int64_t WaveformRescaler::sampleAtPixel(const int x) const
 {
-    return x * output_samples_per_pixel_;
+    return static_cast<int64_t>(x) * output_samples_per_pixel_;
 }
 
 //------------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 #if !defined(INC_WAVEFORM_RESCALER_H)
 #define INC_WAVEFORM_RESCALER_H
 
+#include <cstdint>
+
 //------------------------------------------------------------------------------
 
 class WaveformBuffer;
@@ -46,7 +48,7 @@ class WaveformRescaler
         );
 
     private:
-        int sampleAtPixel(int x) const;
+        int64_t sampleAtPixel(int x) const;
 
     private:
         int sample_rate_;
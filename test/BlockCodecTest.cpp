@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "BlockCodec.h"
+
+#include "gmock/gmock.h"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+using testing::ElementsAreArray;
+using testing::Eq;
+using testing::Le;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+static std::vector<short> roundTrip(
+    const std::vector<short>& values,
+    const short* reference = nullptr)
+{
+    std::vector<uint8_t> encoded;
+    BlockCodec::encode(values.data(), reference, values.size(), 1, encoded);
+
+    std::vector<short> decoded(values.size());
+
+    const uint8_t* end = BlockCodec::decode(
+        encoded.data(),
+        encoded.data() + encoded.size(),
+        reference,
+        decoded.size(),
+        decoded.data(),
+        1
+    );
+
+    EXPECT_THAT(end, Eq(encoded.data() + encoded.size()));
+
+    return decoded;
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldRoundTripValues)
+{
+    std::vector<short> values;
+
+    srand(1);
+
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(static_cast<short>(rand() % 65536 - 32768));
+    }
+
+    ASSERT_THAT(roundTrip(values), ElementsAreArray(values));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldRoundTripExtremeValues)
+{
+    const std::vector<short> values = { -32768, 32767, -32768, 32767, 0, -1, 1 };
+
+    ASSERT_THAT(roundTrip(values), ElementsAreArray(values));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldRoundTripValuesWithReference)
+{
+    const std::vector<short> reference = { 100, -200, 300, -32768, 32767 };
+    const std::vector<short> values    = { 101, -199, 300, 32767, -32768 };
+
+    ASSERT_THAT(roundTrip(values, reference.data()), ElementsAreArray(values));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldEncodeConstantValuesCompactly)
+{
+    const std::vector<short> values(BlockCodec::GROUP_SIZE * 4, 0);
+
+    std::vector<uint8_t> encoded;
+    BlockCodec::encode(values.data(), nullptr, values.size(), 1, encoded);
+
+    // One bit width byte per group, and no data
+    ASSERT_THAT(encoded.size(), Eq(4U));
+    ASSERT_THAT(roundTrip(values), ElementsAreArray(values));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldEncodeInterleavedValues)
+{
+    // min, max pairs
+    const std::vector<short> points = { -10, 10, -12, 14, -8, 9 };
+
+    std::vector<uint8_t> encoded;
+    BlockCodec::encode(&points[0], nullptr, 3, 2, encoded);
+    BlockCodec::encode(&points[1], nullptr, 3, 2, encoded);
+
+    std::vector<short> decoded(points.size());
+
+    const uint8_t* input = encoded.data();
+    const uint8_t* end = encoded.data() + encoded.size();
+
+    input = BlockCodec::decode(input, end, nullptr, 3, &decoded[0], 2);
+    input = BlockCodec::decode(input, end, nullptr, 3, &decoded[1], 2);
+
+    ASSERT_THAT(input, Eq(end));
+    ASSERT_THAT(decoded, ElementsAreArray(points));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldNotEncodeMoreThanMaxEncodedSize)
+{
+    for (size_t count : { 1, 31, 32, 33, 100 }) {
+        std::vector<short> values(count);
+        std::vector<short> reference(count);
+
+        // Alternating extreme values, each the furthest possible from the
+        // reference, need the greatest bit width
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = (i % 2 == 0) ? 32767 : -32768;
+            reference[i] = static_cast<short>(-1 - values[i]);
+        }
+
+        std::vector<uint8_t> encoded;
+        BlockCodec::encode(values.data(), reference.data(), values.size(), 1, encoded);
+
+        ASSERT_THAT(encoded.size(), Eq(BlockCodec::getMaxEncodedSize(count)));
+
+        encoded.clear();
+        BlockCodec::encode(values.data(), nullptr, values.size(), 1, encoded);
+
+        ASSERT_THAT(encoded.size(), Le(BlockCodec::getMaxEncodedSize(count)));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldThrowIfDataTruncated)
+{
+    const std::vector<short> values = { 1000, -1000, 2000, -2000 };
+
+    std::vector<uint8_t> encoded;
+    BlockCodec::encode(values.data(), nullptr, values.size(), 1, encoded);
+
+    std::vector<short> decoded(values.size());
+
+    ASSERT_THROW(
+        BlockCodec::decode(
+            encoded.data(),
+            encoded.data() + encoded.size() - 1,
+            nullptr,
+            decoded.size(),
+            decoded.data(),
+            1
+        ),
+        std::runtime_error
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST(BlockCodecTest, shouldThrowIfBitWidthInvalid)
+{
+    const std::vector<uint8_t> encoded(16, 18);
+
+    short value = 0;
+
+    ASSERT_THROW(
+        BlockCodec::decode(
+            encoded.data(),
+            encoded.data() + encoded.size(),
+            nullptr,
+            1,
+            &value,
+            1
+        ),
+        std::runtime_error
+    );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,260 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "DatFileImporter.h"
+#include "DatFileExporter.h"
+#include "JsonFileExporter.h"
+#include "Array.h"
+#include "Options.h"
+#include "WaveformBuffer.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+#include "util/Streams.h"
+
+#include "gmock/gmock.h"
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+using testing::Eq;
+using testing::HasSubstr;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+// A version 2 file with 2 channels of 16-bit data, and a length of 1000
+// points, of which only PRESENT_POINTS and part of the next are in the file.
+
+static const int32_t LENGTH = 1000;
+static const int32_t PRESENT_POINTS = 600;
+
+//------------------------------------------------------------------------------
+
+static void writeInt32(std::vector<uint8_t>& data, int32_t value)
+{
+    const uint32_t bits = static_cast<uint32_t>(value);
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        data.push_back(static_cast<uint8_t>(bits >> shift));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void writeInt16(std::vector<uint8_t>& data, int value)
+{
+    const uint16_t bits = static_cast<uint16_t>(value);
+
+    data.push_back(static_cast<uint8_t>(bits));
+    data.push_back(static_cast<uint8_t>(bits >> 8));
+}
+
+//------------------------------------------------------------------------------
+
+// Gives each point distinct values in each channel
+
+static short getMinValue(int32_t point, int chan)
+{
+    return static_cast<short>(-point - chan * 1000);
+}
+
+static short getMaxValue(int32_t point, int chan)
+{
+    return static_cast<short>(point + chan * 1000);
+}
+
+//------------------------------------------------------------------------------
+
+static void writeTruncatedFile(const boost::filesystem::path& filename)
+{
+    std::vector<uint8_t> data;
+
+    writeInt32(data, 2);      // Version
+    writeInt32(data, 0);      // Flags: 16-bit
+    writeInt32(data, 16000);  // Sample rate
+    writeInt32(data, 64);     // Samples per pixel
+    writeInt32(data, LENGTH);
+    writeInt32(data, 2);      // Channels
+
+    for (int32_t point = 0; point < PRESENT_POINTS; ++point) {
+        for (int chan = 0; chan < 2; ++chan) {
+            writeInt16(data, getMinValue(point, chan));
+            writeInt16(data, getMaxValue(point, chan));
+        }
+    }
+
+    // Part of the next point
+    writeInt16(data, getMinValue(PRESENT_POINTS, 0));
+    writeInt16(data, getMaxValue(PRESENT_POINTS, 0));
+
+    std::ofstream file(filename.string(), std::ios::out | std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+//------------------------------------------------------------------------------
+
+class DatFileImporterTest : public Test
+{
+    protected:
+        virtual void SetUp()
+        {
+            output.str(std::string());
+            error.str(std::string());
+
+            input_filename_ = FileUtil::getTempFilename(".dat");
+            writeTruncatedFile(input_filename_);
+        }
+
+        virtual void TearDown()
+        {
+            boost::filesystem::remove(input_filename_);
+        }
+
+        void parseOptions(const char* output_filename)
+        {
+            const char* const argv[] = {
+                "appname", "-i", "test.dat", "-o", output_filename, "--mono", "0"
+            };
+
+            ASSERT_TRUE(options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+        }
+
+        // Checks that the buffer holds count points of both channels from
+        // the given point.
+
+        void checkPoints(int32_t first, int32_t count)
+        {
+            ASSERT_THAT(buffer_.getNumChannels(), Eq(2));
+            ASSERT_THAT(buffer_.getOffset(), Eq(first));
+
+            for (int chan = 0; chan < 2; ++chan) {
+                ASSERT_THAT(buffer_.getSize(chan), Eq(count));
+
+                for (int32_t i = 0; i < count; ++i) {
+                    const auto index = static_cast<WaveformBuffer::size_type>(i);
+
+                    ASSERT_THAT(buffer_.getMinSample(index, chan), Eq(getMinValue(first + i, chan)));
+                    ASSERT_THAT(buffer_.getMaxSample(index, chan), Eq(getMaxValue(first + i, chan)));
+                }
+            }
+        }
+
+        boost::filesystem::path input_filename_;
+        Options options_;
+        WaveformBuffer buffer_;
+};
+
+//------------------------------------------------------------------------------
+
+TEST_F(DatFileImporterTest, shouldImportPointsPresentInTruncatedFile)
+{
+    // As when rendering, the points before the end of the file are kept
+    parseOptions("test.png");
+
+    DatFileImporter importer(buffer_, options_, input_filename_);
+    ASSERT_TRUE(importer.ImportFromFile());
+
+    checkPoints(0, PRESENT_POINTS);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(DatFileImporterTest, shouldImportRangeOfPointsFromTruncatedFile)
+{
+    parseOptions("test.png");
+
+    DatFileImporter importer(buffer_, options_, input_filename_);
+    importer.setPointRange(100, 200);
+    ASSERT_TRUE(importer.ImportFromFile());
+
+    checkPoints(100, 200);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(DatFileImporterTest, shouldImportRangeOfPointsPastEndOfTruncatedFile)
+{
+    parseOptions("test.png");
+
+    DatFileImporter importer(buffer_, options_, input_filename_);
+    importer.setPointRange(500, 300);
+    ASSERT_TRUE(importer.ImportFromFile());
+
+    checkPoints(500, PRESENT_POINTS - 500);
+}
+
+//------------------------------------------------------------------------------
+
+// Points already written can't be taken back, so converting a truncated file
+// should fail rather than give partial output.
+
+template<typename Exporter>
+static void testConvertTruncatedFile(
+    const boost::filesystem::path& input_filename,
+    const char* output_file_ext)
+{
+    const boost::filesystem::path output_filename = FileUtil::getTempFilename(output_file_ext);
+    FileDeleter deleter(output_filename);
+
+    const std::string output_arg = output_filename.string();
+
+    const char* const argv[] = {
+        "appname", "-i", "test.dat", "-o", output_arg.c_str(), "--mono", "0", "-f", "2"
+    };
+
+    Options options;
+    ASSERT_TRUE(options.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+    WaveformBuffer buffer;
+    Exporter exporter(buffer, options, output_filename);
+    DatFileImporter importer(buffer, options, input_filename, &exporter);
+
+    try {
+        importer.ImportFromFile();
+        FAIL() << "Expected an error";
+    }
+    catch (const std::runtime_error& e) {
+        ASSERT_THAT(e.what(), HasSubstr("unexpected end of file"));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(DatFileImporterTest, shouldReportErrorIfTruncatedFileConvertedToBinary)
+{
+    testConvertTruncatedFile<DatFileExporter>(input_filename_, ".dat");
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(DatFileImporterTest, shouldReportErrorIfTruncatedFileConvertedToJson)
+{
+    testConvertTruncatedFile<JsonFileExporter>(input_filename_, ".json");
+}
+
+//------------------------------------------------------------------------------
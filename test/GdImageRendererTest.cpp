@@ -22,6 +22,9 @@
 //------------------------------------------------------------------------------
 
 #include "GdImageRenderer.h"
+#include "Array.h"
+#include "DatFileImporter.h"
+#include "Options.h"
 #include "WaveformBuffer.h"
 #include "WaveformColors.h"
 #include "util/FileDeleter.h"
@@ -30,12 +33,17 @@
 
 #include "gmock/gmock.h"
 
+#include <gdfonts.h>
+
+#include <vector>
+
 //------------------------------------------------------------------------------
 
 using testing::EndsWith;
 using testing::Eq;
 using testing::Gt;
 using testing::MatchesRegex;
+using testing::NotNull;
 using testing::StartsWith;
 using testing::StrEq;
 using testing::Test;
@@ -60,6 +68,27 @@ class GdImageRendererTest : public Test
 
 //------------------------------------------------------------------------------
 
+static void load(WaveformBuffer& buffer, const char* filename)
+{
+    const char* const argv[] = {
+        "appname", "-i", filename, "-o", "test.png"
+    };
+
+    Options options;
+    ASSERT_TRUE(options.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+    // The importer keeps a reference to the path
+    const boost::filesystem::path path(filename);
+
+    DatFileImporter importer(buffer, options, path);
+    ASSERT_TRUE(importer.ImportFromFile());
+
+    // Only the renderer's messages are checked
+    output.str(std::string());
+}
+
+//------------------------------------------------------------------------------
+
 static void testImageRendering(bool axis_labels, const std::string& expected_output)
 {
     const fs::path filename = FileUtil::getTempFilename(".png");
@@ -68,13 +97,12 @@ static void testImageRendering(bool axis_labels, const std::string& expected_out
     FileDeleter deleter(filename);
 
     WaveformBuffer buffer;
-    bool result = buffer.load("../test/data/test_file_stereo_8bit_64spp_wav.dat");
-    ASSERT_TRUE(result);
+    load(buffer, "../test/data/test_file_stereo_8bit_64spp_wav.dat");
 
     const WaveformColors& colors = audacity_waveform_colors;
 
     GdImageRenderer renderer;
-    result = renderer.create(buffer, 5.0, 1000, 300, colors, axis_labels, false, 1.0); // zoom: 128
+    bool result = renderer.create(buffer, 5.0, 1000, 300, colors, axis_labels, false, 1.0); // zoom: 128
     ASSERT_TRUE(result);
 
     result = renderer.saveAsPng(filename.c_str());
@@ -89,6 +117,15 @@ static void testImageRendering(bool axis_labels, const std::string& expected_out
 
     ASSERT_THAT(output.str(), MatchesRegex(expected_output));
     ASSERT_TRUE(error.str().empty());
+
+    // Encoding into memory should give the same bytes as the file
+    std::vector<uint8_t> data;
+
+    result = renderer.saveAsPng(data);
+    ASSERT_TRUE(result);
+
+    ASSERT_TRUE(data == FileUtil::readFile(filename));
+    ASSERT_TRUE(error.str().empty());
 }
 
 //------------------------------------------------------------------------------
@@ -96,11 +133,6 @@ static void testImageRendering(bool axis_labels, const std::string& expected_out
 TEST_F(GdImageRendererTest, shouldRenderImageWithAxisLabels)
 {
     std::string expected_output(
-        "Reading waveform data file: \\.\\./test/data/test_file_stereo_8bit_64spp_wav\\.dat\n"
-        "Sample rate: 16000 Hz\n"
-        "Bits: 8\n"
-        "Samples per pixel: 64\n"
-        "Length: 1774 points\n"
         "Image dimensions: 1000x300 pixels\n"
         "Sample rate: 16000 Hz\n"
         "Samples per pixel: 64\n"
@@ -120,11 +152,6 @@ TEST_F(GdImageRendererTest, shouldRenderImageWithAxisLabels)
 TEST_F(GdImageRendererTest, shouldRenderImageWithoutAxisLabels)
 {
     std::string expected_output(
-        "Reading waveform data file: \\.\\./test/data/test_file_stereo_8bit_64spp_wav\\.dat\n"
-        "Sample rate: 16000 Hz\n"
-        "Bits: 8\n"
-        "Samples per pixel: 64\n"
-        "Length: 1774 points\n"
         "Image dimensions: 1000x300 pixels\n"
         "Sample rate: 16000 Hz\n"
         "Samples per pixel: 64\n"
@@ -224,3 +251,173 @@ TEST_F(GdImageRendererTest, shouldReportErrorIfScaleIsTooHigh)
 }
 
 //------------------------------------------------------------------------------
+//
+// Wide image tests
+//
+//------------------------------------------------------------------------------
+
+// Fills the buffer with a single channel of varying amplitude.
+
+static void createWaveform(WaveformBuffer& buffer, int size)
+{
+    buffer.setSampleRate(16000);
+    buffer.setSamplesPerPixel(64);
+
+    for (int i = 0; i < size; ++i) {
+        const short min = static_cast<short>(-((i * 37) % 32768));
+        const short max = static_cast<short>((i * 53) % 32768);
+
+        buffer.appendSamples(min, max);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static gdImagePtr renderImage(
+    const WaveformBuffer& buffer,
+    int image_width,
+    int image_height,
+    const WaveformColors& colors,
+    int threads)
+{
+    GdImageRenderer renderer;
+    renderer.setThreads(threads);
+
+    bool result = renderer.create(
+        buffer, 0.0, image_width, image_height, colors, true, false, 1.0
+    );
+
+    EXPECT_TRUE(result);
+
+    std::vector<uint8_t> data;
+    result = renderer.saveAsPng(data);
+
+    EXPECT_TRUE(result);
+
+    return gdImageCreateFromPngPtr(static_cast<int>(data.size()), &data[0]);
+}
+
+//------------------------------------------------------------------------------
+
+static int getColor(const RGBA& color)
+{
+    const int alpha = color.hasAlpha() ? 127 - (color.alpha / 2) : gdAlphaOpaque;
+
+    return gdTrueColorAlpha(color.red, color.green, color.blue, alpha);
+}
+
+//------------------------------------------------------------------------------
+
+// Draws the waveform with a gdImageLine() per column over a filled background,
+// as the renderer did before it wrote each pixel directly.
+
+static gdImagePtr drawReferenceImage(
+    const WaveformBuffer& buffer,
+    int image_width,
+    int image_height,
+    const WaveformColors& colors)
+{
+    gdImagePtr image = gdImageCreateTrueColor(image_width, image_height);
+
+    if (colors.hasAlpha()) {
+        gdImageSaveAlpha(image, 1);
+        gdImageAlphaBlending(image, 0);
+    }
+
+    const int background_color = getColor(colors.background_color);
+    const int waveform_color   = getColor(colors.waveform_color);
+
+    gdImageFilledRectangle(image, 0, 0, image_width - 1, image_height - 1, background_color);
+
+    // Inside the border
+    const int wave_bottom_y   = image_height - 2;
+    const int max_wave_height = image_height - 2;
+
+    for (int x = 1; x < image_width - 1 && x < buffer.getSize(); ++x) {
+        const int low  = buffer.getMinSample(x) + 32768;
+        const int high = buffer.getMaxSample(x) + 32768;
+
+        const int low_y  = wave_bottom_y - low  * max_wave_height / 65536;
+        const int high_y = wave_bottom_y - high * max_wave_height / 65536;
+
+        gdImageLine(image, x, low_y, x, high_y, waveform_color);
+    }
+
+    return image;
+}
+
+//------------------------------------------------------------------------------
+
+// Renders an image wide enough to be drawn in several bands of columns, and
+// checks it's the same as when drawn in one band, and, away from the border
+// and axis labels, the same as drawn with gdImageLine().
+
+static void testWideImageRendering(const WaveformColors& colors)
+{
+    const int image_width  = 20480;
+    const int image_height = 120;
+
+    WaveformBuffer buffer;
+    createWaveform(buffer, image_width + 100);
+
+    gdImagePtr image = renderImage(buffer, image_width, image_height, colors, 4);
+    ASSERT_THAT(image, NotNull());
+
+    gdImagePtr single_band_image = renderImage(buffer, image_width, image_height, colors, 1);
+    ASSERT_THAT(single_band_image, NotNull());
+
+    gdImagePtr reference_image = drawReferenceImage(buffer, image_width, image_height, colors);
+
+    ASSERT_THAT(gdImageSX(image), Eq(image_width));
+    ASSERT_THAT(gdImageSY(image), Eq(image_height));
+
+    for (int y = 0; y < image_height; ++y) {
+        for (int x = 0; x < image_width; ++x) {
+            ASSERT_THAT(
+                gdImageGetPixel(image, x, y),
+                Eq(gdImageGetPixel(single_band_image, x, y))
+            ) << "x: " << x << ", y: " << y;
+        }
+    }
+
+    // Below the time axis markers, and above the labels
+    const int marker_height = 10;
+    const int start_y = marker_height + 1;
+    const int end_y   = image_height - 1 - marker_height - 1 - gdFontGetSmall()->h;
+
+    for (int y = start_y; y < end_y; ++y) {
+        for (int x = 1; x < image_width - 1; ++x) {
+            ASSERT_THAT(
+                gdImageGetPixel(image, x, y),
+                Eq(gdImageGetPixel(reference_image, x, y))
+            ) << "x: " << x << ", y: " << y;
+        }
+    }
+
+    gdImageDestroy(image);
+    gdImageDestroy(single_band_image);
+    gdImageDestroy(reference_image);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(GdImageRendererTest, shouldRenderWideImageInBands)
+{
+    testWideImageRendering(audacity_waveform_colors);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(GdImageRendererTest, shouldRenderWideImageWithAlphaInBands)
+{
+    const WaveformColors colors(
+        RGBA(0, 0, 0),
+        RGBA(255, 255, 255, 128),
+        RGBA(0, 0, 255, 200),
+        RGBA(0, 0, 0)
+    );
+
+    testWideImageRendering(colors);
+}
+
+//------------------------------------------------------------------------------
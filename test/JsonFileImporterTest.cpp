@@ -0,0 +1,302 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "JsonFileImporter.h"
+#include "JsonFileExporter.h"
+#include "Array.h"
+#include "Options.h"
+#include "WaveformBuffer.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+#include "util/Streams.h"
+
+#include "gmock/gmock.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+//------------------------------------------------------------------------------
+
+using testing::Eq;
+using testing::HasSubstr;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+class JsonFileImporterTest : public Test
+{
+    protected:
+        virtual void SetUp()
+        {
+            output.str(std::string());
+            error.str(std::string());
+        }
+
+        void parseOptions(const char* mono)
+        {
+            const char* const argv[] = {
+                "appname", "-i", "test.json", "-o", "test.dat", "-m", mono
+            };
+
+            ASSERT_TRUE(options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+        }
+
+        void importFromString(const std::string& contents)
+        {
+            const boost::filesystem::path filename = FileUtil::getTempFilename(".json");
+            FileDeleter deleter(filename);
+
+            std::ofstream file(filename.string());
+            file << contents;
+            file.close();
+
+            JsonFileImporter importer(buffer_, options_, filename);
+            importer.ImportFromFile();
+        }
+
+        // Returns the error message from importing the given contents
+
+        std::string getImportError(const std::string& contents)
+        {
+            try {
+                importFromString(contents);
+            }
+            catch (const std::runtime_error& e) {
+                return e.what();
+            }
+
+            return std::string();
+        }
+
+        Options options_;
+        WaveformBuffer buffer_;
+};
+
+//------------------------------------------------------------------------------
+
+// As written by JsonFileExporter, with file version 2
+static const char* const TWO_CHANNELS =
+    "{\n"
+    "\t\"sample_rate\":48000,\n"
+    "\t\"samples_per_pixel\":512,\n"
+    "\t\"channels\":2,\n"
+    "\t\"bits\":16,\n"
+    "\t\"length\":3,\n"
+    "\t\"version\":2,\n"
+    "\t\"chan0\":[\n"
+    "\t\t-100,200,-32768,32767,0,0\n"
+    "\t],\n"
+    "\t\"chan1\":[\n"
+    "\t\t-300,400,-32768,32767,-1,1\n"
+    "\t]\n"
+    "}\n";
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldImportJsonWaveformData)
+{
+    parseOptions("1");
+
+    const boost::filesystem::path filename("../test/data/test_file_stereo_8bit_64spp_wav.json");
+    JsonFileImporter importer(buffer_, options_, filename);
+
+    ASSERT_TRUE(importer.ImportFromFile());
+
+    ASSERT_THAT(buffer_.getSampleRate(), Eq(16000));
+    ASSERT_THAT(buffer_.getSamplesPerPixel(), Eq(64));
+    ASSERT_THAT(buffer_.getBits(), Eq(8));
+    ASSERT_THAT(buffer_.getNumChannels(), Eq(1));
+    ASSERT_THAT(buffer_.getSize(), Eq(1774));
+
+    // 8-bit values are scaled to 16 bits
+    ASSERT_THAT(buffer_.getMinSample(0), Eq(-53 * 256));
+    ASSERT_THAT(buffer_.getMaxSample(0), Eq(64 * 256));
+    ASSERT_THAT(buffer_.getMinSample(1), Eq(-58 * 256));
+    ASSERT_THAT(buffer_.getMaxSample(1), Eq(38 * 256));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldImportEachChannel)
+{
+    parseOptions("0");
+    importFromString(TWO_CHANNELS);
+
+    ASSERT_THAT(buffer_.getSampleRate(), Eq(48000));
+    ASSERT_THAT(buffer_.getSamplesPerPixel(), Eq(512));
+    ASSERT_THAT(buffer_.getBits(), Eq(16));
+    ASSERT_THAT(buffer_.getNumChannels(), Eq(2));
+    ASSERT_THAT(buffer_.getSize(0), Eq(3));
+    ASSERT_THAT(buffer_.getSize(1), Eq(3));
+
+    ASSERT_THAT(buffer_.getMinSample(0, 0), Eq(-100));
+    ASSERT_THAT(buffer_.getMaxSample(0, 0), Eq(200));
+    ASSERT_THAT(buffer_.getMinSample(1, 0), Eq(-32768));
+    ASSERT_THAT(buffer_.getMaxSample(1, 0), Eq(32767));
+    ASSERT_THAT(buffer_.getMinSample(0, 1), Eq(-300));
+    ASSERT_THAT(buffer_.getMaxSample(0, 1), Eq(400));
+    ASSERT_THAT(buffer_.getMinSample(2, 1), Eq(-1));
+    ASSERT_THAT(buffer_.getMaxSample(2, 1), Eq(1));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldDownmixChannelsToMono)
+{
+    parseOptions("1");
+    importFromString(TWO_CHANNELS);
+
+    ASSERT_THAT(buffer_.getNumChannels(), Eq(1));
+    ASSERT_THAT(buffer_.getSize(), Eq(3));
+
+    ASSERT_THAT(buffer_.getMaxSample(0), Eq(300));
+    ASSERT_THAT(buffer_.getMaxSample(1), Eq(32767));
+    ASSERT_THAT(buffer_.getMaxSample(2), Eq(0));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldReportErrorIfLengthMismatch)
+{
+    parseOptions("1");
+
+    ASSERT_THROW(
+        importFromString(
+            "{\"sample_rate\":48000,\"samples_per_pixel\":512,\"bits\":16,"
+            "\"length\":2,\"data\":[1,2,3,4,5,6]}"
+        ),
+        std::runtime_error
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldReportErrorIfValueOutOfRange)
+{
+    parseOptions("1");
+
+    ASSERT_THROW(
+        importFromString(
+            "{\"sample_rate\":48000,\"samples_per_pixel\":512,\"bits\":8,"
+            "\"length\":1,\"data\":[-1,200]}"
+        ),
+        std::runtime_error
+    );
+}
+
+//------------------------------------------------------------------------------
+
+// Should fail before allocating space for the points
+
+static const char* const LONG_LENGTH =
+    "{\"sample_rate\":48000,\"samples_per_pixel\":512,\"bits\":16,"
+    "\"length\":2000000000,\"chan0\":[1,2,3,4,5,6]}";
+
+TEST_F(JsonFileImporterTest, shouldReportErrorIfLengthLongerThanData)
+{
+    parseOptions("0");
+
+    ASSERT_THAT(getImportError(LONG_LENGTH), HasSubstr("expected 2000000000 points"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldReportErrorIfLengthLongerThanDataWhenDownmixing)
+{
+    parseOptions("1");
+
+    ASSERT_THAT(getImportError(LONG_LENGTH), HasSubstr("expected 2000000000 points"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldReportErrorIfChannelNumberOutOfRange)
+{
+    parseOptions("0");
+
+    ASSERT_THAT(
+        getImportError(
+            "{\"sample_rate\":48000,\"samples_per_pixel\":512,\"bits\":16,"
+            "\"length\":1,\"chan99999999999\":[1,2]}"
+        ),
+        HasSubstr("unexpected field: chan99999999999")
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(JsonFileImporterTest, shouldReportErrorIfInvalidJson)
+{
+    parseOptions("1");
+
+    ASSERT_THROW(importFromString("{\"sample_rate\":"), std::runtime_error);
+    ASSERT_THROW(importFromString(""), std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+TEST_F(JsonFileImporterTest, shouldConvertToJsonWithoutTemporaryFiles)
+{
+    const boost::filesystem::path input_filename = FileUtil::getTempFilename(".json");
+    FileDeleter input_deleter(input_filename);
+
+    const boost::filesystem::path output_filename = FileUtil::getTempFilename(".json");
+    FileDeleter output_deleter(output_filename);
+
+    std::ofstream file(input_filename.string());
+    file << TWO_CHANNELS;
+    file.close();
+
+    const std::string output_arg = output_filename.string();
+
+    const char* const argv[] = {
+        "appname", "-i", "test.json", "-o", output_arg.c_str(), "-m", "0", "-f", "2"
+    };
+
+    ASSERT_TRUE(options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+    // All points are in memory, so the exporter doesn't need to spool the
+    // second channel to a temporary file
+    const char* const tmpdir = std::getenv("TMPDIR");
+    const std::string saved_tmpdir = tmpdir != nullptr ? tmpdir : "";
+
+    setenv("TMPDIR", "/nonexistent/audiowaveform", 1);
+
+    JsonFileExporter exporter(buffer_, options_, output_filename);
+    JsonFileImporter importer(buffer_, options_, input_filename, &exporter);
+
+    EXPECT_NO_THROW(importer.ImportFromFile());
+
+    if (tmpdir != nullptr) {
+        setenv("TMPDIR", saved_tmpdir.c_str(), 1);
+    }
+    else {
+        unsetenv("TMPDIR");
+    }
+
+    ASSERT_TRUE(boost::filesystem::exists(output_filename));
+    ASSERT_THAT(FileUtil::readTextFile(output_filename), Eq(TWO_CHANNELS));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,451 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "MappedWavAudioFileReader.h"
+#include "mocks/MockAudioProcessor.h"
+#include "mocks/MockRangeAudioProcessor.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+#include "util/SampleRecorder.h"
+#include "util/Streams.h"
+
+#include "gmock/gmock.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+using testing::_;
+using testing::EndsWith;
+using testing::Eq;
+using testing::HasSubstr;
+using testing::InSequence;
+using testing::Return;
+using testing::StrEq;
+using testing::StrictMock;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+class MappedWavAudioFileReaderTest : public Test
+{
+    public:
+        MappedWavAudioFileReaderTest()
+        {
+        }
+
+    protected:
+        virtual void SetUp()
+        {
+            output.str(std::string());
+            error.str(std::string());
+        }
+
+        virtual void TearDown()
+        {
+        }
+
+        MappedWavAudioFileReader reader_;
+};
+
+//------------------------------------------------------------------------------
+
+static std::vector<char> readFile(const boost::filesystem::path& filename)
+{
+    std::ifstream file(filename.string(), std::ios::in | std::ios::binary);
+
+    return std::vector<char>(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>()
+    );
+}
+
+//------------------------------------------------------------------------------
+
+template<typename T>
+static void append(std::string& data, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        data += static_cast<char>((value >> (i * 8)) & 0xff);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static bool canRead(const char* filename)
+{
+    MappedWavAudioFileReader reader;
+    return reader.canRead(filename);
+}
+
+//------------------------------------------------------------------------------
+
+static void replace16(std::string& data, size_t offset, uint16_t value)
+{
+    data[offset]     = static_cast<char>(value & 0xff);
+    data[offset + 1] = static_cast<char>(value >> 8);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldOpenWavFile)
+{
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+
+    ASSERT_TRUE(result);
+    ASSERT_FALSE(output.str().empty());
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldOpenWavFileAfterCheckingItCanBeRead)
+{
+    const char* filename = "../test/data/test_file_stereo.wav";
+
+    ASSERT_TRUE(reader_.canRead(filename));
+    ASSERT_TRUE(output.str().empty());
+
+    bool result = reader_.open(filename);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("Channels: 2\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldReportErrorIfFileNotFound)
+{
+    const char* filename = "../test/data/unknown.wav";
+
+    bool result = reader_.open(filename);
+
+    ASSERT_FALSE(result);
+
+    std::string str = error.str();
+    ASSERT_THAT(str, HasSubstr(filename));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldReportErrorIfNot16BitPcm)
+{
+    const char* filename = "../test/data/test_file_mono_float32.wav";
+
+    bool result = reader_.open(filename);
+
+    ASSERT_FALSE(result);
+
+    std::string str = error.str();
+    ASSERT_THAT(str, HasSubstr(filename));
+    ASSERT_THAT(str, EndsWith("Not a 16-bit PCM WAV file\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldOnlyReadPcmWavFiles)
+{
+    ASSERT_TRUE(canRead("../test/data/test_file_stereo.wav"));
+    ASSERT_TRUE(canRead("../test/data/test_file_mono.wav"));
+
+    ASSERT_FALSE(canRead("../test/data/test_file_mono_float32.wav"));
+    ASSERT_FALSE(canRead("../test/data/test_file_stereo.flac"));
+    ASSERT_FALSE(canRead("../test/data/unknown.wav"));
+    ASSERT_FALSE(canRead("-"));
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldNotReadFileWithTooManyChannels)
+{
+    const std::vector<char> wav_data = readFile("../test/data/test_file_stereo.wav");
+    ASSERT_THAT(wav_data.size(), Eq(454120U));
+
+    // Same file, but with 20000 channels, more than libsndfile accepts
+    const uint16_t channels = 20000;
+
+    std::string data(wav_data.begin(), wav_data.end());
+    replace16(data, 22, channels);
+    replace16(data, 32, static_cast<uint16_t>(channels * 2)); // block align
+
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".wav");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    std::ofstream file(filename.string(), std::ios::out | std::ios::binary);
+    file << data;
+    file.close();
+
+    ASSERT_FALSE(canRead(filename.c_str()));
+
+    bool result = reader_.open(filename.c_str());
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), EndsWith("Not a 16-bit PCM WAV file\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldFailToProcessIfFileNotOpen)
+{
+    StrictMock<MockAudioProcessor> processor;
+
+    EXPECT_CALL(processor, init(_, _, _, _)).Times(0);
+    EXPECT_CALL(processor, process(_, _)).Times(0);
+    EXPECT_CALL(processor, done()).Times(0);
+
+    bool result = reader_.run(processor);
+    ASSERT_FALSE(result);
+
+    // No error message expected.
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldProcessStereoWavFile)
+{
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+    ASSERT_TRUE(result);
+
+    StrictMock<MockAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // Total number of frames: 113519, 13 x 8192 frames then 1 x 7023
+    EXPECT_CALL(processor, process(_, 8192)).Times(13).WillRepeatedly(Return(true));
+    EXPECT_CALL(processor, process(_, 7023)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+
+    std::string expected_output(
+        "Input file: ../test/data/test_file_stereo.wav\n"
+        "Frames: 113519\n"
+        "Sample rate: 16000 Hz\n"
+        "Channels: 2\n"
+        "Format: 0x10002\n"
+        "Sections: 1\n"
+        "Seekable: yes\n"
+        "\rDone: 0%"
+        "\rDone: 7%"
+        "\rDone: 14%"
+        "\rDone: 21%"
+        "\rDone: 28%"
+        "\rDone: 36%"
+        "\rDone: 43%"
+        "\rDone: 50%"
+        "\rDone: 57%"
+        "\rDone: 64%"
+        "\rDone: 72%"
+        "\rDone: 79%"
+        "\rDone: 86%"
+        "\rDone: 93%"
+        "\rDone: 100%\n"
+        "Read 113519 frames\n"
+    );
+
+    ASSERT_THAT(output.str(), StrEq(expected_output));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldProcessMonoWavFile)
+{
+    bool result = reader_.open("../test/data/test_file_mono.wav");
+    ASSERT_TRUE(result);
+
+    StrictMock<MockAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 1, 113519, 16384)).WillOnce(Return(true));
+
+    // Total number of frames: 113519, 6 x 16384 frames then 1 x 15215
+    EXPECT_CALL(processor, process(_, 16384)).Times(6).WillRepeatedly(Return(true));
+    EXPECT_CALL(processor, process(_, 15215)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 113519 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldProcessFrameRange)
+{
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+    ASSERT_TRUE(result);
+
+    StrictMock<MockRangeAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // Frames 16384 to 26384: 1 x 8192 frames then 1 x 1808
+    EXPECT_CALL(processor, process(_, 8192)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, process(_, 1808)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 10000 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldPassSamplesFromFile)
+{
+    const std::vector<char> data = readFile("../test/data/test_file_stereo.wav");
+
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+    ASSERT_TRUE(result);
+
+    SampleRecorder recorder;
+
+    result = reader_.run(recorder);
+    ASSERT_TRUE(result);
+
+    // The data chunk follows the 44 byte header.
+    ASSERT_THAT(recorder.samples.size(), Eq(113519U * 2));
+    ASSERT_THAT(data.size(), Eq(44 + recorder.samples.size() * 2));
+
+    for (size_t i = 0; i < recorder.samples.size(); ++i) {
+        const short sample = static_cast<short>(
+            static_cast<unsigned char>(data[44 + i * 2]) |
+            static_cast<unsigned char>(data[44 + i * 2 + 1]) << 8
+        );
+
+        ASSERT_THAT(recorder.samples[i], Eq(sample)) << "Index " << i;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldProcessRf64File)
+{
+    const std::vector<char> wav_data = readFile("../test/data/test_file_stereo.wav");
+    ASSERT_THAT(wav_data.size(), Eq(454120U));
+
+    const uint64_t data_size = wav_data.size() - 44;
+
+    // RF64 header, with the RIFF and data chunk sizes in the ds64 chunk
+    std::string data("RF64");
+    append<uint32_t>(data, 0xffffffff);
+    data += "WAVE";
+
+    data += "ds64";
+    append<uint32_t>(data, 28);
+    append<uint64_t>(data, 4 + 36 + 24 + 8 + data_size);
+    append<uint64_t>(data, data_size);
+    append<uint64_t>(data, data_size / 4);
+    append<uint32_t>(data, 0);
+
+    data.append(&wav_data[12], 24); // fmt chunk
+
+    data += "data";
+    append<uint32_t>(data, 0xffffffff);
+    data.append(&wav_data[44], data_size);
+
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".wav");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    std::ofstream file(filename.string(), std::ios::out | std::ios::binary);
+    file << data;
+    file.close();
+
+    bool result = reader_.open(filename.c_str());
+    ASSERT_TRUE(result);
+
+    ASSERT_THAT(output.str(), HasSubstr("Frames: 113519\n"));
+    ASSERT_THAT(output.str(), HasSubstr("Format: 0x220002\n"));
+
+    SampleRecorder recorder;
+
+    result = reader_.run(recorder);
+    ASSERT_TRUE(result);
+
+    MappedWavAudioFileReader wav_reader;
+    result = wav_reader.open("../test/data/test_file_stereo.wav");
+    ASSERT_TRUE(result);
+
+    SampleRecorder wav_recorder;
+
+    result = wav_reader.run(wav_recorder);
+    ASSERT_TRUE(result);
+
+    ASSERT_TRUE(recorder.samples == wav_recorder.samples);
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(MappedWavAudioFileReaderTest, shouldNotProcessFileMoreThanOnce)
+{
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+    ASSERT_TRUE(result);
+
+    SampleRecorder recorder;
+
+    result = reader_.run(recorder);
+    ASSERT_TRUE(result);
+
+    output.str(std::string());
+
+    StrictMock<MockAudioProcessor> processor;
+
+    EXPECT_CALL(processor, init(_, _, _, _)).Times(0);
+    EXPECT_CALL(processor, process(_, _)).Times(0);
+    EXPECT_CALL(processor, done()).Times(0);
+
+    result = reader_.run(processor);
+    ASSERT_FALSE(result);
+
+    ASSERT_TRUE(output.str().empty());
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
@@ -23,15 +23,31 @@
 
 #include "Mp3AudioFileReader.h"
 #include "mocks/MockAudioProcessor.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+#include "util/SampleRecorder.h"
+#include "util/StdinPipe.h"
 #include "util/Streams.h"
 
 #include "gmock/gmock.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
 //------------------------------------------------------------------------------
 
 using testing::_;
 using testing::Eq;
+using testing::Gt;
+using testing::HasSubstr;
 using testing::InSequence;
+using testing::Le;
 using testing::Return;
 using testing::StrEq;
 using testing::StrictMock;
@@ -299,6 +315,453 @@ TEST_F(Mp3AudioFileReaderTest, shouldAccountForDecodingDelay)
 
 //------------------------------------------------------------------------------
 
+TEST_F(Mp3AudioFileReaderTest, shouldProcessFrameRangeAsFullDecode)
+{
+    const char* filename = "../test/data/test_file_stereo.mp3";
+
+    bool result = reader_.open(filename);
+    ASSERT_TRUE(result);
+
+    SampleRecorder all_frames(0, std::numeric_limits<long long>::max());
+
+    result = reader_.run(all_frames);
+    ASSERT_TRUE(result);
+
+    // Far enough from the start that the frames before it are skipped
+    // rather than decoded
+    const long long start_frame = 60000;
+    const long long end_frame   = 70000;
+
+    Mp3AudioFileReader reader;
+
+    result = reader.open(filename);
+    ASSERT_TRUE(result);
+
+    SampleRecorder range_frames(start_frame, end_frame);
+
+    result = reader.run(range_frames);
+    ASSERT_TRUE(result);
+
+    ASSERT_THAT(range_frames.samples.size(), Eq(static_cast<size_t>(2 * (end_frame - start_frame))));
+
+    const std::vector<short> expected(
+        all_frames.samples.begin() + 2 * start_frame,
+        all_frames.samples.begin() + 2 * end_frame
+    );
+
+    ASSERT_TRUE(range_frames.samples == expected);
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(Mp3AudioFileReaderTest, shouldProcessFileWithReadAhead)
+{
+    const char* filename = "../test/data/test_file_stereo.mp3";
+
+    const long long all = std::numeric_limits<long long>::max();
+
+    bool result = reader_.open(filename);
+    ASSERT_TRUE(result);
+
+    SampleRecorder expected(0, all);
+
+    result = reader_.run(expected);
+    ASSERT_TRUE(result);
+
+    // A small read-ahead size, so that the input buffer is refilled from
+    // several blocks
+    Mp3AudioFileReader reader;
+    reader.setReadAheadSize(8192);
+
+    output.str(std::string());
+
+    result = reader.open(filename);
+    ASSERT_TRUE(result);
+
+    SampleRecorder actual(0, all);
+
+    result = reader.run(actual);
+    ASSERT_TRUE(result);
+
+    ASSERT_TRUE(actual.samples == expected.samples);
+    ASSERT_THAT(output.str(), HasSubstr("Read-ahead wait: "));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(Mp3AudioFileReaderTest, shouldWriteAndUseSeekIndex)
+{
+    const char* filename = "../test/data/test_file_stereo.mp3";
+
+    const boost::filesystem::path index_filename = FileUtil::getTempFilename(".idx");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(index_filename);
+
+    // The first read writes the index
+    reader_.setSeekIndexFilename(index_filename.string());
+
+    bool result = reader_.open(filename);
+    ASSERT_TRUE(result);
+
+    SampleRecorder all_frames(0, std::numeric_limits<long long>::max());
+
+    result = reader_.run(all_frames);
+    ASSERT_TRUE(result);
+
+    ASSERT_TRUE(boost::filesystem::exists(index_filename));
+    ASSERT_THAT(output.str(), HasSubstr("Wrote seek index: "));
+
+    // Later reads seek using the index, and give the same samples
+    const long long start_frame = 60000;
+    const long long end_frame   = 70000;
+
+    {
+        Mp3AudioFileReader reader;
+        reader.setSeekIndexFilename(index_filename.string());
+
+        output.str(std::string());
+
+        result = reader.open(filename);
+        ASSERT_TRUE(result);
+        ASSERT_THAT(output.str(), HasSubstr("Seek index: "));
+
+        SampleRecorder range_frames(start_frame, end_frame);
+
+        result = reader.run(range_frames);
+        ASSERT_TRUE(result);
+
+        const std::vector<short> expected(
+            all_frames.samples.begin() + 2 * start_frame,
+            all_frames.samples.begin() + 2 * end_frame
+        );
+
+        ASSERT_TRUE(range_frames.samples == expected);
+    }
+
+    // The index also gives the length
+    {
+        Mp3AudioFileReader reader;
+        reader.setSeekIndexFilename(index_filename.string());
+
+        result = reader.open(filename);
+        ASSERT_TRUE(result);
+
+        StrictMock<MockAudioProcessor> processor;
+
+        const long frame_count = static_cast<long>(all_frames.samples.size() / 2);
+
+        EXPECT_CALL(processor, init(16000, 2, frame_count, 8192)).WillOnce(Return(false));
+        EXPECT_CALL(processor, done());
+
+        reader.run(processor);
+    }
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+static void decodeFile(
+    const char* filename,
+    bool downmix,
+    bool half_sample_rate,
+    SampleRecorder& recorder,
+    bool approximate_peaks = false)
+{
+    Mp3AudioFileReader reader;
+    reader.setDownmix(downmix);
+    reader.setHalfSampleRate(half_sample_rate);
+    reader.setApproximatePeaks(approximate_peaks);
+
+    ASSERT_TRUE(reader.open(filename, false));
+    ASSERT_TRUE(reader.run(recorder));
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the minimum and maximum of the average of the channels in each block
+// of frames, as WaveformGenerator computes them in mono.
+
+static std::vector<int> getPeaks(const SampleRecorder& recorder, int block_size)
+{
+    const int channels = recorder.getChannels();
+    const size_t stride = static_cast<size_t>(channels);
+    const size_t frames = recorder.samples.size() / stride;
+
+    std::vector<int> peaks;
+
+    for (size_t start = 0; start < frames; start += static_cast<size_t>(block_size)) {
+        const size_t end = std::min(frames, start + static_cast<size_t>(block_size));
+
+        int min = SHRT_MAX;
+        int max = SHRT_MIN;
+
+        for (size_t i = start; i < end; i++) {
+            int sum = 0;
+
+            for (size_t channel = 0; channel < stride; channel++) {
+                sum += recorder.samples[i * stride + channel];
+            }
+
+            const int value = sum / channels;
+
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+
+        peaks.push_back(min);
+        peaks.push_back(max);
+    }
+
+    return peaks;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns whether any sample in each block of frames was clipped when
+// converted to 16 bits.
+
+static std::vector<bool> getClippedBlocks(const SampleRecorder& recorder, int block_size)
+{
+    const size_t block_samples = static_cast<size_t>(block_size * recorder.getChannels());
+
+    std::vector<bool> clipped;
+
+    for (size_t start = 0; start < recorder.samples.size(); start += block_samples) {
+        const size_t end = std::min(recorder.samples.size(), start + block_samples);
+
+        const auto first = recorder.samples.begin() + static_cast<std::ptrdiff_t>(start);
+        const auto last  = recorder.samples.begin() + static_cast<std::ptrdiff_t>(end);
+
+        clipped.push_back(
+            std::any_of(first, last, [](short sample) {
+                return sample == SHRT_MAX || sample == -SHRT_MAX;
+            })
+        );
+    }
+
+    return clipped;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the largest difference between two sets of peaks, ignoring the
+// min and max of any excluded blocks.
+
+static int getMaxDifference(
+    const std::vector<int>& a,
+    const std::vector<int>& b,
+    const std::vector<bool>& excluded = std::vector<bool>())
+{
+    int max_difference = 0;
+
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        if (i / 2 < excluded.size() && excluded[i / 2]) {
+            continue;
+        }
+
+        max_difference = std::max(max_difference, std::abs(a[i] - b[i]));
+    }
+
+    return max_difference;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the largest difference between each sample output at half sample
+// rate and the even sample of a full rate decode that it holds. The parity
+// gives whether the number of samples skipped at the start of the stream is
+// odd, in which case each output pair starts on an odd sample.
+
+static int getHalfRateDifference(
+    const SampleRecorder& full,
+    const SampleRecorder& half_rate,
+    int parity)
+{
+    int max_difference = 0;
+
+    for (size_t i = 0; i < full.samples.size() && i < half_rate.samples.size(); i++) {
+        const size_t offset = (i + static_cast<size_t>(parity)) & 1;
+
+        // The even sample was skipped with the encoder delay
+        if (offset > i) {
+            continue;
+        }
+
+        const int difference = std::abs(half_rate.samples[i] - full.samples[i - offset]);
+
+        max_difference = std::max(max_difference, difference);
+    }
+
+    return max_difference;
+}
+
+//------------------------------------------------------------------------------
+
+// Compares the output of the reduced decode modes with a full decode. Mixing
+// down is compared by waveform peaks at 256 samples per pixel, and half sample
+// rate by each sample. The largest differences are recorded as test
+// properties.
+
+TEST_F(Mp3AudioFileReaderTest, shouldMatchFullDecodeInFastDecodeModes)
+{
+    const char* filenames[] = {
+        "../test/data/test_file_stereo.mp3",
+        "../test/data/test_file_mono.mp3",
+        "../test/data/cl_T_01.mp3"
+    };
+
+    const long long all = std::numeric_limits<long long>::max();
+
+    const int SAMPLES_PER_PIXEL = 256;
+
+    for (const char* filename : filenames) {
+        SCOPED_TRACE(filename);
+
+        SampleRecorder full(0, all);
+        decodeFile(filename, false, false, full);
+
+        SampleRecorder downmixed(0, all);
+        decodeFile(filename, true, false, downmixed);
+
+        SampleRecorder half_rate(0, all);
+        decodeFile(filename, true, true, half_rate);
+
+        ASSERT_THAT(downmixed.getChannels(), Eq(1));
+        ASSERT_THAT(half_rate.getChannels(), Eq(1));
+
+        const std::vector<int> full_peaks = getPeaks(full, SAMPLES_PER_PIXEL);
+        const std::vector<int> downmixed_peaks = getPeaks(downmixed, SAMPLES_PER_PIXEL);
+        const std::vector<int> half_rate_peaks = getPeaks(half_rate, SAMPLES_PER_PIXEL);
+
+        // The length is the same in each mode
+        ASSERT_THAT(downmixed_peaks.size(), Eq(full_peaks.size()));
+        ASSERT_THAT(half_rate_peaks.size(), Eq(full_peaks.size()));
+
+        // Clipping each channel separately isn't the same as clipping their
+        // average, so blocks where the full decode clips aren't compared.
+        const std::vector<bool> clipped = getClippedBlocks(full, SAMPLES_PER_PIXEL);
+
+        const int downmix_difference = getMaxDifference(full_peaks, downmixed_peaks, clipped);
+        const int half_rate_difference = getMaxDifference(full_peaks, half_rate_peaks);
+
+        RecordProperty(
+            std::string("downmix_") + boost::filesystem::path(filename).stem().string(),
+            downmix_difference
+        );
+
+        RecordProperty(
+            std::string("half_rate_") + boost::filesystem::path(filename).stem().string(),
+            half_rate_difference
+        );
+
+        // Mixing down before synthesis differs only by rounding. Each
+        // synthesized sample is rounded down to 16 bits, and the full
+        // decode's channels are then averaged, so the two differ by at most
+        // 3.
+        ASSERT_THAT(downmix_difference, Le(4));
+
+        // Only every other sample is synthesized, from the same subband
+        // samples, so each pair of output samples holds the even sample of
+        // the full rate decode, whichever way the encoder delay aligns them.
+        // Short peaks between these samples are missed, so the peaks
+        // themselves aren't compared.
+        ASSERT_THAT(half_rate.samples.size(), Eq(downmixed.samples.size()));
+
+        const int sample_difference = std::min(
+            getHalfRateDifference(downmixed, half_rate, 0),
+            getHalfRateDifference(downmixed, half_rate, 1)
+        );
+
+        RecordProperty(
+            std::string("half_rate_samples_") + boost::filesystem::path(filename).stem().string(),
+            sample_difference
+        );
+
+        ASSERT_THAT(sample_difference, Le(2));
+    }
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+// Compares waveform peaks at 4096 samples per pixel estimated from the subband
+// samples with those from a full decode. The mean and largest differences, in
+// octaves, are recorded as test properties.
+
+TEST_F(Mp3AudioFileReaderTest, shouldApproximatePeaksWithoutSynthesis)
+{
+    const char* filenames[] = {
+        "../test/data/test_file_stereo.mp3",
+        "../test/data/test_file_mono.mp3",
+        "../test/data/cl_T_01.mp3"
+    };
+
+    const long long all = std::numeric_limits<long long>::max();
+
+    const int SAMPLES_PER_PIXEL = 4096;
+
+    // Quieter pixels are left out, as their ratios are dominated by noise
+    const int MIN_PEAK = 1024;
+
+    for (const char* filename : filenames) {
+        SCOPED_TRACE(filename);
+
+        SampleRecorder full(0, all);
+        decodeFile(filename, false, false, full);
+
+        SampleRecorder approximate(0, all);
+        decodeFile(filename, true, false, approximate, true);
+
+        const std::vector<int> full_peaks = getPeaks(full, SAMPLES_PER_PIXEL);
+        const std::vector<int> approximate_peaks = getPeaks(approximate, SAMPLES_PER_PIXEL);
+
+        ASSERT_THAT(approximate_peaks.size(), Eq(full_peaks.size()));
+
+        double total_difference = 0.0;
+        double max_difference = 0.0;
+        int count = 0;
+
+        // Compare the maximum of each pixel
+        for (size_t i = 1; i < full_peaks.size(); i += 2) {
+            if (full_peaks[i] >= MIN_PEAK) {
+                const double difference = std::fabs(std::log2(
+                    static_cast<double>(std::max(approximate_peaks[i], 1)) / full_peaks[i]
+                ));
+
+                total_difference += difference;
+                max_difference = std::max(max_difference, difference);
+                count++;
+            }
+        }
+
+        const std::string name = boost::filesystem::path(filename).stem().string();
+
+        if (count > 0) {
+            RecordProperty(
+                "approximate_mean_octaves_" + name,
+                std::to_string(total_difference / count)
+            );
+        }
+
+        RecordProperty(
+            "approximate_max_octaves_" + name,
+            std::to_string(max_difference)
+        );
+
+        // Within a factor of four of the exact peaks
+        ASSERT_THAT(max_difference, Le(2.0));
+    }
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
 TEST_F(Mp3AudioFileReaderTest, shouldNotProcessFileMoreThanOnce)
 {
     bool result = reader_.open("../test/data/test_file_mono.mp3");
@@ -327,6 +790,69 @@ TEST_F(Mp3AudioFileReaderTest, shouldNotProcessFileMoreThanOnce)
     ASSERT_TRUE(error.str().empty());
 }
 
+//------------------------------------------------------------------------------
+
+// Reading from a pipe, which can't seek, should give the same samples as
+// decoding the whole file, from the given start frame to the end. Any ID3 tag
+// is read and discarded, as are the frames before the start frame.
+
+static void testProcessFromPipe(const char* filename, long long start_frame)
+{
+    SampleRecorder file_recorder;
+    decodeFile(filename, false, false, file_recorder);
+
+    SampleRecorder pipe_recorder(start_frame);
+
+    {
+        StdinPipe pipe(filename);
+        ASSERT_TRUE(pipe.isOpen());
+
+        decodeFile("-", false, false, pipe_recorder);
+    }
+
+    ASSERT_THAT(pipe_recorder.getChannels(), Eq(file_recorder.getChannels()));
+
+    const size_t offset = static_cast<size_t>(start_frame * file_recorder.getChannels());
+
+    ASSERT_THAT(file_recorder.samples.size(), Gt(offset));
+
+    const std::vector<short> expected(
+        file_recorder.samples.begin() + static_cast<std::ptrdiff_t>(offset),
+        file_recorder.samples.end()
+    );
+
+    ASSERT_TRUE(pipe_recorder.samples == expected);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(Mp3AudioFileReaderTest, shouldProcessMp3FileFromPipe)
+{
+    testProcessFromPipe("../test/data/test_file_stereo.mp3", 0);
+
+    ASSERT_THAT(output.str(), HasSubstr("Input file: -\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(Mp3AudioFileReaderTest, shouldProcessMp3FileWithId3TagsFromPipe)
+{
+    testProcessFromPipe("../test/data/cl_T_01.mp3", 0);
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(Mp3AudioFileReaderTest, shouldProcessFrameRangeFromPipe)
+{
+    testProcessFromPipe("../test/data/test_file_stereo.mp3", 60000);
+    testProcessFromPipe("../test/data/cl_T_01.mp3", 60000);
+
+    ASSERT_TRUE(error.str().empty());
+}
+
 //------------------------------------------------------------------------------
 /*
 TEST_F(Mp3AudioFileReaderTest, shouldReportErrorIfNotAnMp3File)
@@ -0,0 +1,163 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "Mp3SeekIndex.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+
+#include "gmock/gmock.h"
+
+#include <fstream>
+
+//------------------------------------------------------------------------------
+
+using testing::Eq;
+using testing::IsNull;
+using testing::NotNull;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+static void writeFile(const boost::filesystem::path& filename, const char* data)
+{
+    std::ofstream file(filename.string(), std::ios::out | std::ios::binary);
+    file << data;
+}
+
+//------------------------------------------------------------------------------
+
+static void addEntries(Mp3SeekIndex& index)
+{
+    for (uint32_t i = 0; i < 4; i++) {
+        const Mp3SeekIndex::Entry entry = {
+            1000 + i * 32 * 417,                      // offset
+            static_cast<uint64_t>(i) * 32 * 1152,     // frame_index
+            i * 32,                                   // frame_number
+            0                                         // samples_to_skip
+        };
+
+        index.addEntry(entry);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(Mp3SeekIndexTest, shouldFindLastEntryAtOrBeforeFrame)
+{
+    Mp3SeekIndex index;
+    addEntries(index);
+
+    ASSERT_THAT(index.findEntry(-1), IsNull());
+
+    const Mp3SeekIndex::Entry* entry = index.findEntry(0);
+    ASSERT_THAT(entry, NotNull());
+    ASSERT_THAT(entry->frame_number, Eq(0U));
+
+    entry = index.findEntry(32 * 1152 - 1);
+    ASSERT_THAT(entry, NotNull());
+    ASSERT_THAT(entry->frame_number, Eq(0U));
+
+    entry = index.findEntry(32 * 1152);
+    ASSERT_THAT(entry, NotNull());
+    ASSERT_THAT(entry->frame_number, Eq(32U));
+
+    entry = index.findEntry(1000000);
+    ASSERT_THAT(entry, NotNull());
+    ASSERT_THAT(entry->frame_number, Eq(96U));
+    ASSERT_THAT(entry->offset, Eq(1000U + 96 * 417));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(Mp3SeekIndexTest, shouldSaveAndLoadIndex)
+{
+    const boost::filesystem::path mp3_filename = FileUtil::getTempFilename(".mp3");
+    const boost::filesystem::path index_filename = FileUtil::getTempFilename(".idx");
+
+    // Ensure temporary files are deleted at end of test.
+    FileDeleter mp3_deleter(mp3_filename);
+    FileDeleter index_deleter(index_filename);
+
+    writeFile(mp3_filename, "not really an mp3 file");
+
+    Mp3SeekIndex index;
+    ASSERT_TRUE(index.setSourceFile(mp3_filename.c_str()));
+
+    addEntries(index);
+    index.setFrameCount(123456);
+
+    ASSERT_TRUE(index.save(index_filename.c_str()));
+
+    Mp3SeekIndex loaded;
+    ASSERT_TRUE(loaded.setSourceFile(mp3_filename.c_str()));
+    ASSERT_TRUE(loaded.load(index_filename.c_str()));
+
+    ASSERT_THAT(loaded.getFrameCount(), Eq(123456U));
+
+    const Mp3SeekIndex::Entry* entry = loaded.findEntry(2 * 32 * 1152 + 10);
+    ASSERT_THAT(entry, NotNull());
+    ASSERT_THAT(entry->frame_number, Eq(64U));
+    ASSERT_THAT(entry->offset, Eq(1000U + 64 * 417));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(Mp3SeekIndexTest, shouldNotLoadIndexIfSourceFileHasChanged)
+{
+    const boost::filesystem::path mp3_filename = FileUtil::getTempFilename(".mp3");
+    const boost::filesystem::path index_filename = FileUtil::getTempFilename(".idx");
+
+    // Ensure temporary files are deleted at end of test.
+    FileDeleter mp3_deleter(mp3_filename);
+    FileDeleter index_deleter(index_filename);
+
+    writeFile(mp3_filename, "not really an mp3 file");
+
+    Mp3SeekIndex index;
+    ASSERT_TRUE(index.setSourceFile(mp3_filename.c_str()));
+
+    addEntries(index);
+
+    ASSERT_TRUE(index.save(index_filename.c_str()));
+
+    // Same size, different content
+    writeFile(mp3_filename, "not really an MP3 file");
+
+    Mp3SeekIndex loaded;
+    ASSERT_TRUE(loaded.setSourceFile(mp3_filename.c_str()));
+    ASSERT_FALSE(loaded.load(index_filename.c_str()));
+
+    ASSERT_THAT(loaded.findEntry(0), IsNull());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(Mp3SeekIndexTest, shouldNotLoadMissingIndex)
+{
+    const boost::filesystem::path index_filename = FileUtil::getTempFilename(".idx");
+
+    Mp3SeekIndex index;
+    ASSERT_FALSE(index.load(index_filename.c_str()));
+}
+
+//------------------------------------------------------------------------------
@@ -26,18 +26,24 @@
 #include "Array.h"
 #include "util/FileDeleter.h"
 #include "util/FileUtil.h"
+#include "util/StdoutCapture.h"
 #include "util/Streams.h"
 
 #include "gmock/gmock.h"
 
 #include <gd.h>
 #include <string.h>
+#include <fstream>
+#include <memory>
 
 //------------------------------------------------------------------------------
 
 using testing::StartsWith;
 using testing::EndsWith;
 using testing::Eq;
+using testing::HasSubstr;
+using testing::Lt;
+using testing::Not;
 using testing::NotNull;
 using testing::StrEq;
 using testing::Test;
@@ -130,12 +136,17 @@ static void compareImageFiles(
     ASSERT_THAT(test_width,  Eq(ref_width));
     ASSERT_THAT(test_height, Eq(ref_height));
 
+    // Compare colors rather than pixel values, which are palette indexes in
+    // palette images
     for (int y = 0; y < ref_height; ++y) {
         for (int x = 0; x < ref_width; ++x) {
             const int test_pixel = gdImageGetPixel(test_image, x, y);
             const int ref_pixel  = gdImageGetPixel(ref_image,  x, y);
 
-            ASSERT_THAT(test_pixel, Eq(ref_pixel));
+            ASSERT_THAT(gdImageRed(test_image, test_pixel),   Eq(gdImageRed(ref_image, ref_pixel)));
+            ASSERT_THAT(gdImageGreen(test_image, test_pixel), Eq(gdImageGreen(ref_image, ref_pixel)));
+            ASSERT_THAT(gdImageBlue(test_image, test_pixel),  Eq(gdImageBlue(ref_image, ref_pixel)));
+            ASSERT_THAT(gdImageAlpha(test_image, test_pixel), Eq(gdImageAlpha(ref_image, ref_pixel)));
         }
     }
 
@@ -341,16 +352,36 @@ TEST_F(OptionHandlerTest, shouldConvertBinaryWaveformDataToText)
 
 //------------------------------------------------------------------------------
 
-TEST_F(OptionHandlerTest, shouldNotConvertJsonWaveformDataToBinary)
+TEST_F(OptionHandlerTest, shouldConvertBinaryWaveformDataToGivenOutputFormat)
 {
-    runTest("test_file_stereo_8bit_64spp_mp3.json", ".dat", nullptr, false);
+    std::vector<const char*> args{ "--output-format", "json" };
+
+    runTest("test_file_stereo_8bit_64spp_wav.dat", ".out", &args, true, "test_file_stereo_8bit_64spp_wav_v2.json");
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvert16BitBinaryWaveformDataTo8BitJson)
+{
+    // The same as 8-bit JSON data generated from test_file_stereo.wav
+    std::vector<const char*> args{ "-b", "8" };
+    runTest("test_file_stereo_16bit_64spp_wav.dat", ".json", &args, true, "test_file_stereo_8bit_64spp_wav_v2.json");
 }
 
 //------------------------------------------------------------------------------
 
-TEST_F(OptionHandlerTest, shouldNotConvertJsonWaveformDataToText)
+TEST_F(OptionHandlerTest, shouldConvertJsonWaveformDataToBinary)
 {
-    runTest("test_file_stereo_8bit_64spp_mp3.json", ".txt", nullptr, false);
+    std::vector<const char*> args{ "-f", "1" };
+    runTest("test_file_stereo_8bit_64spp_wav.json", ".dat", &args, true, "test_file_stereo_8bit_64spp_wav.dat");
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvertJsonWaveformDataToText)
+{
+    std::vector<const char*> args{ "-f", "1" };
+    runTest("test_file_stereo_8bit_64spp_wav.json", ".txt", &args, true, "test_file_stereo_8bit_64spp_wav.txt");
 }
 
 //------------------------------------------------------------------------------
@@ -454,6 +485,174 @@ TEST_F(OptionHandlerTest, shouldRenderWaveformWithNoAxisLabels)
 
 //------------------------------------------------------------------------------
 
+TEST_F(OptionHandlerTest, shouldRenderWaveformWithPalette)
+{
+    std::vector<const char*> args{ "-z", "128", "--palette" };
+
+    runTest("test_file_stereo_8bit_64spp_wav.dat", ".png", &args, true, "test_file_stereo_dat_128spp.png");
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformWithPaletteAndNoAxisLabels)
+{
+    std::vector<const char*> args{ "-z", "128", "--no-axis-labels", "--palette" };
+
+    runTest("test_file_stereo_8bit_64spp_wav.dat", ".png", &args, true, "test_file_stereo_dat_128spp_no_axis_labels.png");
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderSingleChannelWaveformWithStackedChannels)
+{
+    std::vector<const char*> args{ "-z", "128", "--stack-channels" };
+
+    runTest("test_file_stereo_8bit_64spp_wav.dat", ".png", &args, true, "test_file_stereo_dat_128spp.png");
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderStereoWaveformWithStackedChannels)
+{
+    const boost::filesystem::path stacked_filename = FileUtil::getTempFilename(".png");
+    const boost::filesystem::path image_filename = FileUtil::getTempFilename(".png");
+
+    const boost::filesystem::path channel_filenames[] = {
+        image_filename.parent_path() / (image_filename.stem().string() + "-chan0.png"),
+        image_filename.parent_path() / (image_filename.stem().string() + "-chan1.png")
+    };
+
+    // Ensure temporary files are deleted at end of test.
+    FileDeleter stacked_deleter(stacked_filename);
+    FileDeleter deleter0(channel_filenames[0]);
+    FileDeleter deleter1(channel_filenames[1]);
+
+    std::vector<const char*> argv{
+        "appname",
+        "-i", "../test/data/test_file_stereo.wav",
+        "-o", stacked_filename.c_str(),
+        "-z", "128", "-h", "250", "--mono", "0", "--no-axis-labels",
+        "--stack-channels"
+    };
+
+    Options options;
+
+    bool success = options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    OptionHandler option_handler;
+
+    success = option_handler.run(options);
+    ASSERT_TRUE(success);
+    ASSERT_THAT(error.str(), StrEq(""));
+
+    // Each channel's lane should match that channel rendered alone, at half
+    // the height
+    argv = {
+        "appname",
+        "-i", "../test/data/test_file_stereo.wav",
+        "-o", image_filename.c_str(),
+        "-z", "128", "-h", "125", "--mono", "0", "--no-axis-labels"
+    };
+
+    Options channel_options;
+
+    success = channel_options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    success = option_handler.run(channel_options);
+    ASSERT_TRUE(success);
+
+    gdImagePtr stacked_image = openImageFile(stacked_filename);
+    ASSERT_THAT(stacked_image, NotNull());
+    ASSERT_THAT(gdImageSY(stacked_image), Eq(250));
+
+    for (int channel = 0; channel < 2; ++channel) {
+        gdImagePtr channel_image = openImageFile(channel_filenames[channel]);
+        ASSERT_THAT(channel_image, NotNull());
+
+        const int width  = gdImageSX(channel_image);
+        const int height = gdImageSY(channel_image);
+
+        ASSERT_THAT(gdImageSX(stacked_image), Eq(width));
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                ASSERT_THAT(
+                    gdImageGetPixel(stacked_image, x, channel * height + y),
+                    Eq(gdImageGetPixel(channel_image, x, y))
+                );
+            }
+        }
+
+        gdImageDestroy(channel_image);
+    }
+
+    gdImageDestroy(stacked_image);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageOfEachSize)
+{
+    const boost::filesystem::path output_filename = FileUtil::getTempFilename(".png");
+    const boost::filesystem::path directory = output_filename.parent_path();
+    const std::string name = output_filename.stem().string();
+
+    const boost::filesystem::path image_filenames[] = {
+        directory / (name + "-800x250.png"),
+        directory / (name + "-400x100@auto.png")
+    };
+
+    const boost::filesystem::path image_filename = FileUtil::getTempFilename(".png");
+
+    // Ensure temporary files are deleted at end of test.
+    FileDeleter deleter0(image_filenames[0]);
+    FileDeleter deleter1(image_filenames[1]);
+    FileDeleter deleter(image_filename);
+
+    std::vector<const char*> argv{
+        "appname",
+        "-i", "../test/data/test_file_stereo_8bit_64spp_wav.dat",
+        "-o", output_filename.c_str(),
+        "-z", "128", "--png-sizes", "800x250,400x100@auto"
+    };
+
+    Options options;
+
+    bool success = options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    OptionHandler option_handler;
+
+    success = option_handler.run(options);
+    ASSERT_TRUE(success);
+    ASSERT_THAT(error.str(), StrEq(""));
+    ASSERT_FALSE(boost::filesystem::exists(output_filename));
+
+    compareImageFiles(image_filenames[0], "../test/data/test_file_stereo_dat_128spp.png");
+
+    // Each image should match the same size rendered alone
+    argv = {
+        "appname",
+        "-i", "../test/data/test_file_stereo_8bit_64spp_wav.dat",
+        "-o", image_filename.c_str(),
+        "-z", "auto", "-w", "400", "-h", "100"
+    };
+
+    Options image_options;
+
+    success = image_options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    success = option_handler.run(image_options);
+    ASSERT_TRUE(success);
+
+    compareImageFiles(image_filenames[1], image_filename);
+}
+
+//------------------------------------------------------------------------------
+
 TEST_F(OptionHandlerTest, shouldRenderWaveformWithFixedAmplitudeScale)
 {
     std::vector<const char*> args{ "-z", "128", "--amplitude-scale", "1.5" };
@@ -481,9 +680,10 @@ TEST_F(OptionHandlerTest, shouldRenderWaveformFitToImageWidth)
 
 //------------------------------------------------------------------------------
 
-TEST_F(OptionHandlerTest, shouldNotRenderWaveformImageFromJsonWaveformData)
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromJsonWaveformData)
 {
-    runTest("test_file_stereo.json", ".png", nullptr, false);
+    std::vector<const char*> args{ "-z", "128" };
+    runTest("test_file_stereo_8bit_64spp_wav.json", ".png", &args, true, "test_file_stereo_dat_128spp.png");
 }
 
 //------------------------------------------------------------------------------
@@ -518,3 +718,677 @@ TEST_F(OptionHandlerTest, shouldFailIfPixelsPerSecondIsNegative)
 }
 
 //------------------------------------------------------------------------------
+//
+// Waveform image tile tests
+//
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformTiles)
+{
+    const boost::filesystem::path output_directory = FileUtil::getTempFilename();
+
+    std::vector<const char*> argv{
+        "appname",
+        "-i", "../test/data/test_file_stereo_8bit_64spp_wav.dat",
+        "-o", output_directory.c_str(),
+        "--tiles", "-w", "256", "--no-axis-labels"
+    };
+
+    Options options;
+
+    bool success = options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    OptionHandler option_handler;
+
+    success = option_handler.run(options);
+    ASSERT_TRUE(success);
+    ASSERT_THAT(error.str(), StrEq(""));
+
+    // 1774 points at 64 samples per pixel, then 887, 444, and 222, which fit
+    // in one tile
+    const int tile_counts[] = { 1, 2, 4, 7 };
+
+    for (size_t zoom = 0; zoom < ARRAY_LENGTH(tile_counts); ++zoom) {
+        const boost::filesystem::path level_directory =
+            output_directory / std::to_string(zoom);
+
+        for (int x = 0; x < tile_counts[zoom]; ++x) {
+            const boost::filesystem::path filename =
+                level_directory / (std::to_string(x) + ".png");
+
+            ASSERT_TRUE(boost::filesystem::is_regular_file(filename));
+        }
+
+        const boost::filesystem::path filename =
+            level_directory / (std::to_string(tile_counts[zoom]) + ".png");
+
+        ASSERT_FALSE(boost::filesystem::exists(filename));
+    }
+
+    ASSERT_FALSE(boost::filesystem::exists(output_directory / "4"));
+
+    // Each tile should match the same part of the waveform rendered alone
+    const boost::filesystem::path tile_filename = output_directory / "2" / "1.png";
+    const boost::filesystem::path image_filename = FileUtil::getTempFilename(".png");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(image_filename);
+
+    argv = {
+        "appname",
+        "-i", "../test/data/test_file_stereo_8bit_64spp_wav.dat",
+        "-o", image_filename.c_str(),
+        "-z", "128", "-s", "2.048", "-w", "256", "--no-axis-labels"
+    };
+
+    Options image_options;
+
+    success = image_options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    success = option_handler.run(image_options);
+    ASSERT_TRUE(success);
+
+    compareImageFiles(tile_filename, image_filename);
+
+    boost::filesystem::remove_all(output_directory);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldNotRenderWaveformTilesFromTextWaveformData)
+{
+    const boost::filesystem::path output_directory = FileUtil::getTempFilename();
+
+    std::vector<const char*> argv{
+        "appname",
+        "-i", "../test/data/test_file_stereo.txt",
+        "-o", output_directory.c_str(),
+        "--tiles"
+    };
+
+    Options options;
+
+    bool success = options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    OptionHandler option_handler;
+
+    success = option_handler.run(options);
+    ASSERT_FALSE(success);
+    ASSERT_THAT(error.str(), StartsWith("Can't generate tiles"));
+    ASSERT_FALSE(boost::filesystem::exists(output_directory));
+}
+
+//------------------------------------------------------------------------------
+//
+// Block index tests
+//
+//------------------------------------------------------------------------------
+
+static void runOptionHandler(const std::vector<const char*>& args)
+{
+    std::vector<const char*> argv{ "appname" };
+    argv.insert(argv.end(), args.begin(), args.end());
+
+    Options options;
+
+    bool success = options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    OptionHandler option_handler;
+
+    success = option_handler.run(options);
+    ASSERT_TRUE(success);
+    ASSERT_THAT(error.str(), StrEq(""));
+}
+
+//------------------------------------------------------------------------------
+
+// Generates .dat files at 64 samples per pixel from test_file_stereo.wav, with
+// and without a block index, then renders an image from each at the given
+// zoom level. The images should be the same, whether or not the block index
+// is used.
+
+static void testBlockIndexRendering(
+    const char* block_size,
+    const char* zoom,
+    const std::vector<const char*>& dat_args,
+    const std::vector<const char*>& render_args,
+    bool should_use_index)
+{
+    const boost::filesystem::path dat_filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path index_dat_filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path image_filename = FileUtil::getTempFilename(".png");
+    const boost::filesystem::path index_image_filename = FileUtil::getTempFilename(".png");
+
+    // Ensure temporary files are deleted at end of test.
+    FileDeleter dat_deleter(dat_filename);
+    FileDeleter index_dat_deleter(index_dat_filename);
+    FileDeleter image_deleter(image_filename);
+    FileDeleter index_image_deleter(index_image_filename);
+
+    std::vector<const char*> args{
+        "-i", "../test/data/test_file_stereo.wav",
+        "-o", dat_filename.c_str(),
+        "-z", "64"
+    };
+
+    args.insert(args.end(), dat_args.begin(), dat_args.end());
+
+    runOptionHandler(args);
+
+    args[3] = index_dat_filename.c_str();
+    args.insert(args.end(), { "--block-index", "--block-size", block_size });
+
+    runOptionHandler(args);
+
+    args = { "-i", dat_filename.c_str(), "-o", image_filename.c_str(), "-z", zoom };
+    args.insert(args.end(), render_args.begin(), render_args.end());
+
+    output.str(std::string());
+    runOptionHandler(args);
+
+    ASSERT_THAT(output.str(), Not(HasSubstr("Rendering from block index")));
+
+    args[1] = index_dat_filename.c_str();
+    args[3] = index_image_filename.c_str();
+
+    output.str(std::string());
+    runOptionHandler(args);
+
+    if (should_use_index) {
+        ASSERT_THAT(output.str(), HasSubstr("Rendering from block index"));
+    }
+    else {
+        ASSERT_THAT(output.str(), Not(HasSubstr("Rendering from block index")));
+    }
+
+    compareImageFiles(index_image_filename, image_filename);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromBlockIndex)
+{
+    // 1774 points in 887 whole blocks
+    testBlockIndexRendering("2", "128", {}, {}, true);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromBlockIndexAtMultipleOfBlockSize)
+{
+    testBlockIndexRendering("2", "512", {}, {}, true);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromBlockIndexWithPartialLastBlock)
+{
+    // 1774 points in 443 blocks of 4 then a block of 2
+    testBlockIndexRendering("4", "256", {}, {}, true);
+
+    // 591 blocks of 3 then a block of 1
+    testBlockIndexRendering("3", "192", {}, {}, true);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromBlockIndexOf8BitData)
+{
+    testBlockIndexRendering("4", "256", { "-b", "8" }, {}, true);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromBlockIndexWithStartTime)
+{
+    testBlockIndexRendering("4", "256", {}, { "-s", "2.048", "-w", "256" }, true);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderStereoWaveformImageFromBlockIndex)
+{
+    testBlockIndexRendering(
+        "4", "256", { "--mono", "0" }, { "--mono", "0", "--stack-channels" }, true
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldNotRenderMonoWaveformImageFromStereoBlockIndex)
+{
+    // The index holds each channel's peaks, which can't be mixed down
+    testBlockIndexRendering("4", "256", { "--mono", "0" }, {}, false);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldNotRenderWaveformImageFromBlockIndexAtOtherZoom)
+{
+    // Not a multiple of 64 * 4 samples per pixel
+    testBlockIndexRendering("4", "384", {}, {}, false);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderWaveformImageFromPartOfBinaryWaveformData)
+{
+    // Only the points shown in the image are read from the .dat file, while
+    // the .json file, with the same points, is read in full
+
+    const boost::filesystem::path dat_image_filename = FileUtil::getTempFilename(".png");
+    const boost::filesystem::path json_image_filename = FileUtil::getTempFilename(".png");
+
+    FileDeleter dat_image_deleter(dat_image_filename);
+    FileDeleter json_image_deleter(json_image_filename);
+
+    std::vector<const char*> args{
+        "-i", "../test/data/test_file_stereo_8bit_64spp_wav.dat",
+        "-o", dat_image_filename.c_str(),
+        "-s", "5.01", "-z", "128", "-w", "200"
+    };
+
+    runOptionHandler(args);
+
+    // The header is read, and reported, only once. Only the importer reports
+    // the length.
+    const std::string str = output.str();
+    const size_t pos = str.find("Length: 1774 points\n");
+
+    ASSERT_THAT(pos, Not(Eq(std::string::npos)));
+    ASSERT_THAT(str.find("Length: ", pos + 1), Eq(std::string::npos));
+
+    args[1] = "../test/data/test_file_stereo_8bit_64spp_wav.json";
+    args[3] = json_image_filename.c_str();
+
+    runOptionHandler(args);
+
+    compareImageFiles(dat_image_filename, json_image_filename);
+}
+
+//------------------------------------------------------------------------------
+//
+// Multi-channel version 1 waveform data tests
+//
+//------------------------------------------------------------------------------
+
+// Version 1 files hold a single channel, so multi-channel output is written
+// to a separate file for each channel, with "-chan<n>" appended to the output
+// filename. Checks that each of these is the same as its reference file.
+
+static void testVersion1ChannelFiles(
+    const char* input_filename,
+    const char* output_file_ext,
+    const std::vector<const char*>& args,
+    const std::vector<const char*>& reference_filenames)
+{
+    boost::filesystem::path input_pathname = "../test/data";
+    input_pathname /= input_filename;
+
+    const boost::filesystem::path output_pathname =
+        FileUtil::getTempFilename(output_file_ext);
+
+    std::vector<boost::filesystem::path> channel_pathnames;
+    std::vector<std::unique_ptr<FileDeleter>> deleters;
+
+    for (std::size_t chan = 0; chan != reference_filenames.size(); ++chan) {
+        boost::filesystem::path channel_pathname = output_pathname.parent_path();
+        channel_pathname /= output_pathname.stem().string() + "-chan" +
+            std::to_string(chan) + output_file_ext;
+
+        channel_pathnames.push_back(channel_pathname);
+
+        // Ensure temporary files are deleted at end of test.
+        deleters.emplace_back(new FileDeleter(channel_pathname));
+    }
+
+    std::vector<const char*> argv{
+        "-i", input_pathname.c_str(),
+        "-o", output_pathname.c_str(),
+        "-f", "1", "--mono", "0"
+    };
+
+    argv.insert(argv.end(), args.begin(), args.end());
+
+    runOptionHandler(argv);
+
+    ASSERT_FALSE(boost::filesystem::exists(output_pathname));
+
+    for (std::size_t chan = 0; chan != reference_filenames.size(); ++chan) {
+        SCOPED_TRACE(chan);
+
+        ASSERT_TRUE(boost::filesystem::is_regular_file(channel_pathnames[chan]));
+
+        boost::filesystem::path reference_pathname = "../test/data";
+        reference_pathname /= reference_filenames[chan];
+
+        compareFiles(channel_pathnames[chan], reference_pathname);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldGenerateVersion1BinaryWaveformDataForEachChannel)
+{
+    testVersion1ChannelFiles(
+        "test_file_stereo.wav",
+        ".dat",
+        { "-b", "8", "-z", "64" },
+        {
+            "test_file_stereo_8bit_64spp_wav_stereo-chan0.dat",
+            "test_file_stereo_8bit_64spp_wav_stereo-chan1.dat"
+        }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldGenerateVersion1JsonWaveformDataForEachChannel)
+{
+    // Each file holds one "data" array, with no trailing comma
+    testVersion1ChannelFiles(
+        "test_file_stereo.wav",
+        ".json",
+        { "-b", "8", "-z", "64" },
+        {
+            "test_file_stereo_8bit_64spp_wav_stereo-chan0.json",
+            "test_file_stereo_8bit_64spp_wav_stereo-chan1.json"
+        }
+    );
+}
+
+//------------------------------------------------------------------------------
+//
+// Binary waveform data version 3 tests
+//
+//------------------------------------------------------------------------------
+
+// Generates version 2 and version 3 .dat files at 64 samples per pixel from
+// the given audio file, then converts each to JSON, text and a waveform image.
+// The block coding is lossless, so the results should be the same.
+
+static void testVersion3RoundTrip(
+    const char* input_filename,
+    const std::vector<const char*>& dat_args,
+    const std::vector<const char*>& convert_args,
+    const std::vector<const char*>& render_args)
+{
+    boost::filesystem::path input_pathname = "../test/data";
+    input_pathname /= input_filename;
+
+    const boost::filesystem::path v2_dat_filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path v3_dat_filename = FileUtil::getTempFilename(".dat");
+
+    // Ensure temporary files are deleted at end of test.
+    FileDeleter v2_dat_deleter(v2_dat_filename);
+    FileDeleter v3_dat_deleter(v3_dat_filename);
+
+    std::vector<const char*> args{
+        "-i", input_pathname.c_str(),
+        "-o", v2_dat_filename.c_str(),
+        "-z", "64", "-f", "2"
+    };
+
+    args.insert(args.end(), dat_args.begin(), dat_args.end());
+
+    runOptionHandler(args);
+
+    args[3] = v3_dat_filename.c_str();
+    args[7] = "3";
+
+    runOptionHandler(args);
+
+    ASSERT_THAT(
+        boost::filesystem::file_size(v3_dat_filename),
+        Lt(boost::filesystem::file_size(v2_dat_filename))
+    );
+
+    const char* output_file_exts[] = { ".json", ".txt", ".png" };
+
+    for (const char* output_file_ext : output_file_exts) {
+        SCOPED_TRACE(output_file_ext);
+
+        const boost::filesystem::path v2_filename = FileUtil::getTempFilename(output_file_ext);
+        const boost::filesystem::path v3_filename = FileUtil::getTempFilename(output_file_ext);
+
+        FileDeleter v2_deleter(v2_filename);
+        FileDeleter v3_deleter(v3_filename);
+
+        args = { "-i", v2_dat_filename.c_str(), "-o", v2_filename.c_str() };
+        args.insert(args.end(), convert_args.begin(), convert_args.end());
+
+        if (strcmp(output_file_ext, ".png") == 0) {
+            args.insert(args.end(), render_args.begin(), render_args.end());
+        }
+
+        runOptionHandler(args);
+
+        args[1] = v3_dat_filename.c_str();
+        args[3] = v3_filename.c_str();
+
+        runOptionHandler(args);
+
+        if (strcmp(output_file_ext, ".png") == 0) {
+            compareImageFiles(v3_filename, v2_filename);
+        }
+        else {
+            compareFiles(v3_filename, v2_filename);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvertMonoVersion3WaveformData)
+{
+    // 1774 points, in one partial block of the default size
+    testVersion3RoundTrip("test_file_stereo.wav", {}, {}, { "-z", "128" });
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvertMonoVersion3WaveformDataFromMonoAudio)
+{
+    testVersion3RoundTrip(
+        "test_file_mono.wav", { "--block-size", "256" }, {}, { "-z", "128" }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvertStereoVersion3WaveformData)
+{
+    testVersion3RoundTrip(
+        "test_file_stereo.wav",
+        { "--mono", "0", "--block-size", "256" },
+        { "--mono", "0" },
+        { "-z", "128", "--stack-channels" }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvert8BitVersion3WaveformData)
+{
+    testVersion3RoundTrip(
+        "test_file_stereo.wav",
+        { "-b", "8", "--mono", "0", "--block-size", "256" },
+        { "--mono", "0" },
+        { "-z", "128", "--stack-channels" }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldConvertVersion3WaveformDataWithPartialLastBlock)
+{
+    // 1774 points in 6 blocks of 300 then a block of 274
+    testVersion3RoundTrip(
+        "test_file_stereo.wav", { "--block-size", "300" }, {}, { "-z", "128" }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldRenderPartOfVersion3WaveformData)
+{
+    // Only the blocks containing the image's points are read
+    testVersion3RoundTrip(
+        "test_file_stereo.wav",
+        { "--block-size", "32" },
+        {},
+        { "-z", "128", "-s", "2.048", "-w", "256" }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldNotConvertVersion3WaveformDataWithInvalidBlockSize)
+{
+    const boost::filesystem::path dat_filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path json_filename = FileUtil::getTempFilename(".json");
+
+    FileDeleter dat_deleter(dat_filename);
+    FileDeleter json_deleter(json_filename);
+
+    runOptionHandler({
+        "-i", "../test/data/test_file_stereo.wav",
+        "-o", dat_filename.c_str(),
+        "-z", "128", "-f", "3", "--block-size", "256"
+    });
+
+    // Overwrite the encoded size of the first block, which follows the 28
+    // byte header, with a size no block of 256 points can have
+    {
+        std::fstream stream(dat_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        ASSERT_TRUE(stream.is_open());
+
+        const char encoded_size[] = { '\x00', '\x00', '\x00', '\x80' };
+
+        stream.seekp(28);
+        stream.write(encoded_size, sizeof(encoded_size));
+    }
+
+    std::vector<const char*> argv{
+        "appname",
+        "-i", dat_filename.c_str(),
+        "-o", json_filename.c_str()
+    };
+
+    Options options;
+
+    bool success = options.parseCommandLine(static_cast<int>(argv.size()), &argv[0]);
+    ASSERT_TRUE(success);
+
+    OptionHandler option_handler;
+
+    success = option_handler.run(options);
+    ASSERT_FALSE(success);
+    ASSERT_THAT(error.str(), HasSubstr("Corrupted input file. Invalid block size: 2147483648 bytes"));
+}
+
+//------------------------------------------------------------------------------
+//
+// Standard output tests
+//
+//------------------------------------------------------------------------------
+
+// Writes the output file to standard output, and checks that it is the same as
+// when written to a file.
+
+static void testOutputToStdout(
+    const char* input_filename,
+    const char* output_format,
+    const std::vector<const char*>& args)
+{
+    boost::filesystem::path input_pathname = "../test/data";
+    input_pathname /= input_filename;
+
+    const std::string output_file_ext = std::string(".") + output_format;
+
+    const boost::filesystem::path output_filename =
+        FileUtil::getTempFilename(output_file_ext.c_str());
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(output_filename);
+
+    std::vector<const char*> file_args{
+        "-i", input_pathname.c_str(),
+        "-o", output_filename.c_str()
+    };
+
+    file_args.insert(file_args.end(), args.begin(), args.end());
+
+    runOptionHandler(file_args);
+
+    std::vector<const char*> stdout_args{
+        "-i", input_pathname.c_str(),
+        "-o", "-",
+        "--output-format", output_format
+    };
+
+    stdout_args.insert(stdout_args.end(), args.begin(), args.end());
+
+    std::vector<uint8_t> stdout_data;
+
+    {
+        StdoutCapture capture;
+        ASSERT_TRUE(capture.isOpen());
+
+        runOptionHandler(stdout_args);
+
+        stdout_data = capture.getOutput();
+    }
+
+    ASSERT_FALSE(stdout_data.empty());
+
+    compare(stdout_data, FileUtil::readFile(output_filename));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldWriteBinaryWaveformDataToStdout)
+{
+    testOutputToStdout("test_file_stereo.wav", "dat", { "-z", "64" });
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldWriteVersion3BinaryWaveformDataToStdout)
+{
+    testOutputToStdout(
+        "test_file_stereo.wav",
+        "dat",
+        { "-z", "64", "-f", "3", "--block-size", "256", "--block-index" }
+    );
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldWriteJsonWaveformDataToStdout)
+{
+    testOutputToStdout("test_file_stereo.wav", "json", { "-z", "64" });
+    testOutputToStdout("test_file_stereo_8bit_64spp_wav.dat", "json", {});
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldWriteTextWaveformDataToStdout)
+{
+    testOutputToStdout("test_file_stereo.wav", "txt", { "-z", "64" });
+    testOutputToStdout("test_file_stereo_8bit_64spp_wav.dat", "txt", {});
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionHandlerTest, shouldWriteWaveformImageToStdout)
+{
+    testOutputToStdout("test_file_stereo.wav", "png", { "-z", "128" });
+    testOutputToStdout("test_file_stereo_8bit_64spp_wav.dat", "png", { "-z", "128" });
+}
+
+//------------------------------------------------------------------------------
@@ -807,6 +807,59 @@ TEST_F(OptionsTest, shouldReturnDefaultBitsOption)
 
 //------------------------------------------------------------------------------
 
+TEST_F(OptionsTest, shouldReturnDefaultBlockOptions)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+    ASSERT_TRUE(result);
+
+    ASSERT_FALSE(options_.getBlockIndex());
+    ASSERT_THAT(options_.getBlockSize(), Eq(4096));
+
+    ASSERT_TRUE(output.str().empty());
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnBlockIndexAndSize)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--block-index",
+        "--block-size", "1024"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+    ASSERT_TRUE(result);
+
+    ASSERT_TRUE(options_.getBlockIndex());
+    ASSERT_THAT(options_.getBlockSize(), Eq(1024));
+
+    ASSERT_TRUE(output.str().empty());
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfBlockSizeInvalid)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--block-size", "0"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+
+    ASSERT_TRUE(output.str().empty());
+    ASSERT_FALSE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
 TEST_F(OptionsTest, shouldDisableAxisLabelRendering)
 {
     const char* const argv[] = {
@@ -899,6 +952,452 @@ TEST_F(OptionsTest, shouldDisplayErrorIfInvalidPngCompressionLevel)
 
 //------------------------------------------------------------------------------
 
+TEST_F(OptionsTest, shouldNotReturnPngPaletteByDefault)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_FALSE(options_.getPngPalette());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnPngPalette)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png", "--palette"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_TRUE(options_.getPngPalette());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldNotReturnMp3FastDecodeByDefault)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_FALSE(options_.getMp3FastDecode());
+    ASSERT_FALSE(options_.getMp3ApproximatePeaks());
+    ASSERT_THAT(options_.getReadAheadSize(), Eq(0));
+    ASSERT_FALSE(options_.getPipeline());
+    ASSERT_THAT(options_.getThreads(), Eq(1));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnMp3FastDecode)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--mp3-fast-decode"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_TRUE(options_.getMp3FastDecode());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnMp3ApproximatePeaks)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--mp3-approximate-peaks"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_TRUE(options_.getMp3ApproximatePeaks());
+    ASSERT_FALSE(options_.getMp3FastDecode());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnReadAheadSize)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--read-ahead", "4096"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_THAT(options_.getReadAheadSize(), Eq(4096));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReportErrorIfReadAheadSizeIsNegative)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--read-ahead", "-1"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Invalid read-ahead size: must be zero or more\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnPipeline)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.dat", "--pipeline"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_TRUE(options_.getPipeline());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnThreads)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.flac", "-o", "test.dat", "--threads", "4"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_THAT(options_.getThreads(), Eq(4));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReportErrorIfThreadsIsZero)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.flac", "-o", "test.dat", "--threads", "0"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Invalid number of threads: minimum 1\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldNotReturnStackChannelsByDefault)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_FALSE(options_.getStackChannels());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnStackChannels)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png", "--mono", "0", "--stack-channels"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_TRUE(options_.getStackChannels());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnOutputFormat)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "-", "--output-format", "png"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_THAT(options_.getOutputFilename(), StrEq("-"));
+    ASSERT_THAT(options_.getOutputFormat(), StrEq("png"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfInvalidOutputFormat)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test", "--output-format", "wav"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Invalid output format: must be dat, json, txt, or png\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfNoOutputFormatForStandardOutput)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "-"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), HasSubstr("--output-format"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnInputFormat)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "--input-format", "mp3", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_THAT(options_.getInputFilename(), StrEq("-"));
+    ASSERT_THAT(options_.getInputFormat(), StrEq("mp3"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfInvalidInputFormat)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "--input-format", "dat", "-o", "test.png"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Invalid input format: must be mp3, wav, flac, ogg, or raw\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnRawInputFormat)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "--input-format", "raw", "--sample-rate", "44100",
+        "--channels", "2", "--sample-type", "f32le", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_THAT(options_.getInputFormat(), StrEq("raw"));
+    ASSERT_THAT(options_.getRawSampleRate(), Eq(44100));
+    ASSERT_THAT(options_.getRawChannels(), Eq(2));
+    ASSERT_THAT(options_.getRawSampleType(), StrEq("f32le"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnDefaultRawSampleType)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.raw", "--sample-rate", "44100", "--channels", "1",
+        "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_THAT(options_.getRawSampleType(), StrEq("s16le"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfNoRawAudioFormat)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "--input-format", "raw", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq(
+        "Sample rate must be given with --sample-rate for raw input\n"
+        "Number of channels must be given with --channels for raw input\n"
+    ));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfNoRawAudioFormatForRawFile)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.raw", "--channels", "2", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Sample rate must be given with --sample-rate for raw input\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfTooManyRawAudioChannels)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.raw", "--sample-rate", "44100",
+        "--channels", "1025", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Invalid number of channels: maximum 1024\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfInvalidSampleType)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "--input-format", "raw", "--sample-rate", "44100",
+        "--channels", "2", "--sample-type", "u8", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Invalid sample type: must be s16le or f32le\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfNoInputFormatForStandardInput)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "-o", "test.dat"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), HasSubstr("--input-format"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfAutoZoomForStandardInput)
+{
+    const char* const argv[] = {
+        "appname", "-i", "-", "--input-format", "wav", "-o", "test.png", "-z", "auto"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), StrEq("Can't use --zoom auto when reading from standard input\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldNotReturnPngSizesByDefault)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+    ASSERT_TRUE(options_.getPngSizes().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldReturnPngSizes)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png", "-z", "128",
+        "--png-sizes", "200x40@auto,800x80,4000x300@64"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+
+    const std::vector<PngSize>& sizes = options_.getPngSizes();
+    ASSERT_THAT(sizes.size(), Eq(3U));
+
+    ASSERT_THAT(sizes[0].width, Eq(200));
+    ASSERT_THAT(sizes[0].height, Eq(40));
+    ASSERT_TRUE(sizes[0].has_samples_per_pixel);
+    ASSERT_TRUE(sizes[0].auto_samples_per_pixel);
+
+    // Zoom level from the --zoom option
+    ASSERT_THAT(sizes[1].width, Eq(800));
+    ASSERT_THAT(sizes[1].height, Eq(80));
+    ASSERT_FALSE(sizes[1].has_samples_per_pixel);
+    ASSERT_FALSE(sizes[1].auto_samples_per_pixel);
+    ASSERT_THAT(sizes[1].samples_per_pixel, Eq(128));
+
+    ASSERT_THAT(sizes[2].width, Eq(4000));
+    ASSERT_THAT(sizes[2].height, Eq(300));
+    ASSERT_TRUE(sizes[2].has_samples_per_pixel);
+    ASSERT_FALSE(sizes[2].auto_samples_per_pixel);
+    ASSERT_THAT(sizes[2].samples_per_pixel, Eq(64));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(OptionsTest, shouldDisplayErrorIfInvalidPngSizes)
+{
+    const char* const argv[] = {
+        "appname", "-i", "test.mp3", "-o", "test.png", "--png-sizes", "200x40,800"
+    };
+
+    bool result = options_.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv);
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), HasSubstr("Invalid PNG size: 800"));
+}
+
+//------------------------------------------------------------------------------
+
 TEST_F(OptionsTest, shouldReturnHelpFlag)
 {
     const char* const argv[] = { "appname", "--help" };
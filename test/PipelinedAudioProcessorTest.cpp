@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "PipelinedAudioProcessor.h"
+#include "mocks/MockAudioProcessor.h"
+#include "util/SampleRecorder.h"
+
+#include "gmock/gmock.h"
+
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+using testing::_;
+using testing::Eq;
+using testing::InSequence;
+using testing::Lt;
+using testing::Return;
+using testing::StrictMock;
+
+//------------------------------------------------------------------------------
+
+// Records the audio it is given, and the thread it is called on
+
+class RecordingAudioProcessor : public SampleRecorder
+{
+    public:
+        explicit RecordingAudioProcessor(int fail_after = -1) :
+            SampleRecorder(1000, 2000),
+            fail_after_(fail_after),
+            process_count_(0),
+            done_count_(0)
+        {
+        }
+
+        virtual bool process(const short* input_buffer, int input_frame_count)
+        {
+            process_thread_id_ = std::this_thread::get_id();
+
+            SampleRecorder::process(input_buffer, input_frame_count);
+
+            return ++process_count_ != fail_after_;
+        }
+
+        virtual void done()
+        {
+            done_count_++;
+        }
+
+    public:
+        int fail_after_;
+        int process_count_;
+        int done_count_;
+        std::thread::id process_thread_id_;
+};
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldPassAllAudioToProcessor)
+{
+    RecordingAudioProcessor processor;
+    PipelinedAudioProcessor pipeline(processor);
+
+    const int BUFFER_SIZE = 1024;
+
+    ASSERT_TRUE(pipeline.init(44100, 2, 0, BUFFER_SIZE));
+
+    std::vector<short> input;
+
+    for (int i = 0; i < 100; i++) {
+        std::vector<short> buffer;
+
+        // Vary the size of each block, up to the buffer size
+        const int frames = (i * 37) % (BUFFER_SIZE / 2) + 1;
+
+        for (int j = 0; j < frames * 2; j++) {
+            buffer.push_back(static_cast<short>(input.size() + static_cast<size_t>(j)));
+        }
+
+        ASSERT_TRUE(pipeline.process(buffer.data(), frames));
+
+        input.insert(input.end(), buffer.begin(), buffer.end());
+    }
+
+    pipeline.done();
+
+    ASSERT_THAT(processor.done_count_, Eq(1));
+    ASSERT_TRUE(processor.samples == input);
+    ASSERT_TRUE(processor.process_thread_id_ != std::this_thread::get_id());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldSplitBlocksLargerThanBufferSize)
+{
+    RecordingAudioProcessor processor;
+    PipelinedAudioProcessor pipeline(processor);
+
+    ASSERT_TRUE(pipeline.init(44100, 1, 0, 100));
+
+    std::vector<short> input(250);
+
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<short>(i);
+    }
+
+    ASSERT_TRUE(pipeline.process(input.data(), 250));
+
+    pipeline.done();
+
+    ASSERT_THAT(processor.process_count_, Eq(3));
+    ASSERT_TRUE(processor.samples == input);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldNotProcessIfInitFails)
+{
+    StrictMock<MockAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(44100, 2, 1000, 1024)).WillOnce(Return(false));
+    EXPECT_CALL(processor, process(_, _)).Times(0);
+    EXPECT_CALL(processor, done());
+
+    PipelinedAudioProcessor pipeline(processor);
+
+    ASSERT_FALSE(pipeline.init(44100, 2, 1000, 1024));
+
+    pipeline.done();
+}
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldStopIfProcessorFails)
+{
+    RecordingAudioProcessor processor(3);
+    PipelinedAudioProcessor pipeline(processor);
+
+    ASSERT_TRUE(pipeline.init(44100, 1, 0, 16));
+
+    const short buffer[16] = { 0 };
+
+    bool result = true;
+
+    for (int i = 0; i < 100000 && result; i++) {
+        result = pipeline.process(buffer, 16);
+    }
+
+    pipeline.done();
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(processor.process_count_, Eq(3));
+    ASSERT_THAT(processor.done_count_, Eq(1));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldReportProcessorFailureOnLastBuffer)
+{
+    RecordingAudioProcessor processor(3);
+    PipelinedAudioProcessor pipeline(processor);
+
+    ASSERT_TRUE(pipeline.init(44100, 1, 0, 16));
+
+    const short buffer[16] = { 0 };
+
+    // The ring has space for all the buffers, so process() doesn't wait for
+    // the processor.
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(pipeline.process(buffer, 16));
+    }
+
+    pipeline.done();
+
+    ASSERT_TRUE(pipeline.failed());
+    ASSERT_THAT(processor.process_count_, Eq(3));
+    ASSERT_THAT(processor.done_count_, Eq(1));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldBlockWhileWaitingForSlowProcessor)
+{
+    RecordingAudioProcessor processor;
+    PipelinedAudioProcessor pipeline(processor);
+
+    ASSERT_TRUE(pipeline.init(44100, 1, 0, 16));
+
+    const short buffer[16] = { 0 };
+
+    ASSERT_TRUE(pipeline.process(buffer, 16));
+
+    // The processing thread has nothing to do while the decoding thread is
+    // slow, and blocks rather than spins.
+
+    const std::clock_t start = std::clock();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const double cpu_seconds =
+        static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+
+    pipeline.done();
+
+    ASSERT_FALSE(pipeline.failed());
+    ASSERT_THAT(cpu_seconds, Lt(0.1));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(PipelinedAudioProcessorTest, shouldReturnProcessorFrameRange)
+{
+    RecordingAudioProcessor processor;
+    PipelinedAudioProcessor pipeline(processor);
+
+    ASSERT_THAT(pipeline.getRangeStartFrame(), Eq(1000));
+    ASSERT_THAT(pipeline.getRangeEndFrame(), Eq(2000));
+}
+
+//------------------------------------------------------------------------------
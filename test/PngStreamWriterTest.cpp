@@ -0,0 +1,244 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "PngStreamWriter.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+
+#include "gmock/gmock.h"
+
+#include <gd.h>
+
+//------------------------------------------------------------------------------
+
+using testing::Eq;
+using testing::NotNull;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+class PngStreamWriterTest : public Test
+{
+};
+
+//------------------------------------------------------------------------------
+
+static uint8_t getComponent(int x, int y, int channel)
+{
+    return static_cast<uint8_t>((x * 7 + y * 13 + channel * 31) & 0xff);
+}
+
+//------------------------------------------------------------------------------
+
+static void testWriteImage(int width, int height, bool has_alpha, int compression_level)
+{
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".png");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    const int channels = has_alpha ? 4 : 3;
+
+    auto generate_row = [&](int y, uint8_t* row) {
+        for (int x = 0; x < width; ++x) {
+            for (int channel = 0; channel < channels; ++channel) {
+                *row++ = getComponent(x, y, channel);
+            }
+        }
+    };
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    ASSERT_THAT(file, NotNull());
+
+    PngStreamWriter writer(width, height, has_alpha);
+    bool result = writer.write(file, generate_row, compression_level);
+
+    fclose(file);
+
+    ASSERT_TRUE(result);
+
+    file = fopen(filename.c_str(), "rb");
+    ASSERT_THAT(file, NotNull());
+
+    gdImagePtr image = gdImageCreateFromPng(file);
+
+    fclose(file);
+
+    ASSERT_THAT(image, NotNull());
+    ASSERT_THAT(gdImageSX(image), Eq(width));
+    ASSERT_THAT(gdImageSY(image), Eq(height));
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int pixel = gdImageGetPixel(image, x, y);
+
+            ASSERT_THAT(gdTrueColorGetRed(pixel),   Eq(getComponent(x, y, 0)));
+            ASSERT_THAT(gdTrueColorGetGreen(pixel), Eq(getComponent(x, y, 1)));
+            ASSERT_THAT(gdTrueColorGetBlue(pixel),  Eq(getComponent(x, y, 2)));
+
+            // gd reduces alpha to 7 bits, with 0 meaning opaque
+            const int alpha = has_alpha ? gdAlphaMax - (getComponent(x, y, 3) >> 1) : gdAlphaOpaque;
+            ASSERT_THAT(gdTrueColorGetAlpha(pixel), Eq(alpha));
+        }
+    }
+
+    gdImageDestroy(image);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(PngStreamWriterTest, shouldWriteRgbImage)
+{
+    testWriteImage(200, 100, false, -1);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(PngStreamWriterTest, shouldWriteRgbaImage)
+{
+    testWriteImage(200, 100, true, 9);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(PngStreamWriterTest, shouldWriteImageCompressedInSeveralGroups)
+{
+    // Wide enough for only a few rows in each group
+    testWriteImage(100000, 10, false, 1);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(PngStreamWriterTest, shouldWriteUncompressedImage)
+{
+    testWriteImage(300, 20, true, 0);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(PngStreamWriterTest, shouldWritePaletteImage)
+{
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".png");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    // Three colors, so two bits per pixel, with odd width so the last byte
+    // of each row is partly filled
+    const std::vector<RGBA> palette{
+        RGBA(255, 0, 0),
+        RGBA(0, 255, 0, 128),
+        RGBA(0, 0, 255)
+    };
+
+    const int width  = 101;
+    const int height = 50;
+
+    auto generate_row = [&](int y, uint8_t* row) {
+        for (int x = 0; x < width; ++x) {
+            row[x] = static_cast<uint8_t>((x + y) % 3);
+        }
+    };
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    ASSERT_THAT(file, NotNull());
+
+    PngStreamWriter writer(width, height, palette);
+    bool result = writer.write(file, generate_row, -1);
+
+    fclose(file);
+
+    ASSERT_TRUE(result);
+
+    file = fopen(filename.c_str(), "rb");
+    ASSERT_THAT(file, NotNull());
+
+    gdImagePtr image = gdImageCreateFromPng(file);
+
+    fclose(file);
+
+    ASSERT_THAT(image, NotNull());
+    ASSERT_THAT(gdImageSX(image), Eq(width));
+    ASSERT_THAT(gdImageSY(image), Eq(height));
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int pixel = gdImageGetPixel(image, x, y);
+            const RGBA& color = palette[static_cast<size_t>((x + y) % 3)];
+
+            ASSERT_THAT(gdImageRed(image, pixel),   Eq(color.red));
+            ASSERT_THAT(gdImageGreen(image, pixel), Eq(color.green));
+            ASSERT_THAT(gdImageBlue(image, pixel),  Eq(color.blue));
+            ASSERT_THAT(gdImageAlpha(image, pixel), Eq(gdAlphaMax - (color.alpha >> 1)));
+        }
+    }
+
+    gdImageDestroy(image);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(PngStreamWriterTest, shouldWriteImageToMemory)
+{
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".png");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    const int width  = 300;
+    const int height = 20;
+
+    auto generate_row = [&](int y, uint8_t* row) {
+        for (int x = 0; x < width; ++x) {
+            for (int channel = 0; channel < 3; ++channel) {
+                *row++ = getComponent(x, y, channel);
+            }
+        }
+    };
+
+    PngStreamWriter writer(width, height, false);
+
+    std::vector<uint8_t> data;
+
+    auto output = [&](const uint8_t* bytes, size_t size) {
+        data.insert(data.end(), bytes, bytes + size);
+        return true;
+    };
+
+    bool result = writer.write(output, generate_row, -1);
+    ASSERT_TRUE(result);
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    ASSERT_THAT(file, NotNull());
+
+    result = writer.write(file, generate_row, -1);
+
+    fclose(file);
+
+    ASSERT_TRUE(result);
+
+    // Should be the same as the image written to a file
+    ASSERT_THAT(data, Eq(FileUtil::readFile(filename)));
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,280 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "RawAudioFileReader.h"
+#include "mocks/MockAudioProcessor.h"
+#include "mocks/MockRangeAudioProcessor.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+#include "util/SampleRecorder.h"
+#include "util/Streams.h"
+
+#include "gmock/gmock.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+using testing::_;
+using testing::ElementsAre;
+using testing::EndsWith;
+using testing::Eq;
+using testing::HasSubstr;
+using testing::InSequence;
+using testing::Return;
+using testing::StrictMock;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+class RawAudioFileReaderTest : public Test
+{
+    public:
+        RawAudioFileReaderTest()
+        {
+        }
+
+    protected:
+        virtual void SetUp()
+        {
+            output.str(std::string());
+            error.str(std::string());
+        }
+
+        virtual void TearDown()
+        {
+        }
+
+        RawAudioFileReader reader_;
+};
+
+//------------------------------------------------------------------------------
+
+// Writes the audio from the stereo test WAV file, without its 44 byte header.
+
+static void writeRawFile(const boost::filesystem::path& filename)
+{
+    std::ifstream input_file(
+        "../test/data/test_file_stereo.wav",
+        std::ios::in | std::ios::binary
+    );
+
+    const std::vector<char> data(
+        (std::istreambuf_iterator<char>(input_file)),
+        std::istreambuf_iterator<char>()
+    );
+
+    ASSERT_THAT(data.size(), Eq(454120U));
+
+    std::ofstream output_file(filename.string(), std::ios::out | std::ios::binary);
+    output_file.write(&data[44], static_cast<std::streamsize>(data.size() - 44));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldReportErrorIfFileNotFound)
+{
+    const char* filename = "../test/data/unknown.raw";
+
+    reader_.setFormat(16000, 2, RawAudioFileReader::SampleType::S16LE);
+
+    bool result = reader_.open(filename);
+
+    ASSERT_FALSE(result);
+
+    std::string str = error.str();
+    ASSERT_THAT(str, HasSubstr(filename));
+    ASSERT_THAT(str, EndsWith("\n"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldReportErrorIfFormatNotGiven)
+{
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), HasSubstr("sample rate and channels not given"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldReportErrorIfTooManyChannels)
+{
+    reader_.setFormat(16000, 1025, RawAudioFileReader::SampleType::S16LE);
+
+    bool result = reader_.open("../test/data/test_file_stereo.wav");
+
+    ASSERT_FALSE(result);
+    ASSERT_THAT(error.str(), HasSubstr("Invalid number of channels: 1025"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldFailToProcessIfFileNotOpen)
+{
+    StrictMock<MockAudioProcessor> processor;
+
+    EXPECT_CALL(processor, init(_, _, _, _)).Times(0);
+    EXPECT_CALL(processor, process(_, _)).Times(0);
+    EXPECT_CALL(processor, done()).Times(0);
+
+    bool result = reader_.run(processor);
+    ASSERT_FALSE(result);
+
+    // No error message expected.
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldProcessS16leFile)
+{
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".raw");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    writeRawFile(filename);
+
+    reader_.setFormat(16000, 2, RawAudioFileReader::SampleType::S16LE);
+
+    bool result = reader_.open(filename.c_str());
+    ASSERT_TRUE(result);
+
+    StrictMock<MockAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // Total number of frames: 113519, 13 x 8192 frames then 1 x 7023
+    EXPECT_CALL(processor, process(_, 8192)).Times(13).WillRepeatedly(Return(true));
+    EXPECT_CALL(processor, process(_, 7023)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+
+    ASSERT_THAT(output.str(), HasSubstr(
+        "Frames: 113519\n"
+        "Sample rate: 16000 Hz\n"
+        "Channels: 2\n"
+        "Format: raw s16le\n"
+        "\rDone: 0%"
+    ));
+
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 113519 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldProcessFrameRange)
+{
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".raw");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    writeRawFile(filename);
+
+    reader_.setFormat(16000, 2, RawAudioFileReader::SampleType::S16LE);
+
+    bool result = reader_.open(filename.c_str());
+    ASSERT_TRUE(result);
+
+    StrictMock<MockRangeAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // Frames 16384 to 26384: 1 x 8192 frames then 1 x 1808
+    EXPECT_CALL(processor, process(_, 8192)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, process(_, 1808)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 10000 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(RawAudioFileReaderTest, shouldProcessF32leFile)
+{
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".raw");
+
+    // Ensure temporary file is deleted at end of test.
+    FileDeleter deleter(filename);
+
+    // Values outside [-1.0, 1.0] are clipped, and the partial frame at the
+    // end is ignored.
+    const float samples[] = { 0.0f, 0.5f, -0.5f, 1.0f, -1.0f, 2.0f, -2.0f };
+
+    std::string data;
+
+    for (float sample : samples) {
+        uint32_t bits;
+        memcpy(&bits, &sample, sizeof(bits));
+
+        for (int i = 0; i < 4; ++i) {
+            data += static_cast<char>((bits >> (i * 8)) & 0xff);
+        }
+    }
+
+    std::ofstream file(filename.string(), std::ios::out | std::ios::binary);
+    file << data;
+    file.close();
+
+    reader_.setFormat(8000, 2, RawAudioFileReader::SampleType::F32LE);
+
+    bool result = reader_.open(filename.c_str());
+    ASSERT_TRUE(result);
+
+    SampleRecorder recorder;
+
+    result = reader_.run(recorder);
+    ASSERT_TRUE(result);
+
+    ASSERT_THAT(recorder.samples, ElementsAre(
+        0, 16383, -16383, 32767, -32767, 32767
+    ));
+
+    ASSERT_THAT(output.str(), HasSubstr("Format: raw f32le\n"));
+    ASSERT_THAT(output.str(), HasSubstr("Read 3 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,155 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "ReadAheadFile.h"
+#include "util/FileDeleter.h"
+#include "util/FileUtil.h"
+
+#include "gmock/gmock.h"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+using testing::Eq;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+class ReadAheadFileTest : public Test
+{
+    protected:
+        ReadAheadFileTest() :
+            filename_(FileUtil::getTempFilename(".bin")),
+            deleter_(filename_),
+            file_(nullptr)
+        {
+        }
+
+        virtual void SetUp()
+        {
+            // Bytes 0, 1, ... 255, 0, 1, ...
+            for (size_t i = 0; i < 100000; i++) {
+                data_.push_back(static_cast<unsigned char>(i & 0xff));
+            }
+
+            std::ofstream stream(filename_.string(), std::ios::out | std::ios::binary);
+            stream.write(reinterpret_cast<const char*>(data_.data()), static_cast<std::streamsize>(data_.size()));
+            stream.close();
+
+            file_ = fopen(filename_.c_str(), "rb");
+            ASSERT_NE(nullptr, file_);
+        }
+
+        virtual void TearDown()
+        {
+            if (file_ != nullptr) {
+                fclose(file_);
+            }
+        }
+
+        boost::filesystem::path filename_;
+        FileDeleter deleter_;
+        FILE* file_;
+        std::vector<unsigned char> data_;
+};
+
+//------------------------------------------------------------------------------
+
+TEST_F(ReadAheadFileTest, shouldReadWholeFile)
+{
+    ReadAheadFile file(file_, 16384);
+
+    ASSERT_THAT(file.getSize(), Eq(100000));
+
+    std::vector<unsigned char> result;
+    unsigned char buffer[3000];
+
+    while (!file.eof()) {
+        const size_t bytes = file.read(buffer, sizeof(buffer));
+
+        result.insert(result.end(), buffer, buffer + bytes);
+    }
+
+    ASSERT_TRUE(result == data_);
+    ASSERT_THAT(file.tell(), Eq(100000));
+    ASSERT_FALSE(file.error());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(ReadAheadFileTest, shouldReportEndOfFileWithLastBytes)
+{
+    ReadAheadFile file(file_, 16384);
+
+    std::vector<unsigned char> buffer(100000);
+
+    ASSERT_FALSE(file.eof());
+    ASSERT_THAT(file.read(buffer.data(), 99999), Eq(99999U));
+    ASSERT_FALSE(file.eof());
+    ASSERT_THAT(file.read(buffer.data(), 1), Eq(1U));
+    ASSERT_TRUE(file.eof());
+    ASSERT_THAT(file.read(buffer.data(), 1), Eq(0U));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(ReadAheadFileTest, shouldSeekWithinFile)
+{
+    ReadAheadFile file(file_, 16384);
+
+    unsigned char buffer[10];
+
+    ASSERT_THAT(file.read(buffer, sizeof(buffer)), Eq(sizeof(buffer)));
+
+    ASSERT_TRUE(file.seek(50001));
+    ASSERT_THAT(file.tell(), Eq(50001));
+
+    ASSERT_THAT(file.read(buffer, sizeof(buffer)), Eq(sizeof(buffer)));
+    ASSERT_THAT(buffer[0], Eq(data_[50001]));
+    ASSERT_THAT(buffer[9], Eq(data_[50010]));
+
+    ASSERT_TRUE(file.seek(0));
+
+    ASSERT_THAT(file.read(buffer, sizeof(buffer)), Eq(sizeof(buffer)));
+    ASSERT_THAT(buffer[0], Eq(data_[0]));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(ReadAheadFileTest, shouldReadFromCurrentPosition)
+{
+    ASSERT_THAT(fseek(file_, 1000, SEEK_SET), Eq(0));
+
+    ReadAheadFile file(file_, 0);
+
+    unsigned char buffer[1];
+
+    ASSERT_THAT(file.tell(), Eq(1000));
+    ASSERT_THAT(file.read(buffer, sizeof(buffer)), Eq(1U));
+    ASSERT_THAT(buffer[0], Eq(data_[1000]));
+}
+
+//------------------------------------------------------------------------------
@@ -23,12 +23,16 @@
 
 #include "SndFileAudioFileReader.h"
 #include "mocks/MockAudioProcessor.h"
+#include "mocks/MockRangeAudioProcessor.h"
+#include "util/SampleRecorder.h"
+#include "util/StdinPipe.h"
 #include "util/Streams.h"
 
 #include "gmock/gmock.h"
 
 #include <boost/filesystem.hpp>
 
+#include <limits>
 #include <sstream>
 
 //------------------------------------------------------------------------------
@@ -253,6 +257,86 @@ TEST_F(SndFileAudioFileReaderTest, shouldProcessMonoFlacFile)
 
 //------------------------------------------------------------------------------
 
+TEST_F(SndFileAudioFileReaderTest, shouldProcessFrameRange)
+{
+    bool result = reader_.open("../test/data/test_file_stereo.flac");
+    ASSERT_TRUE(result);
+
+    StrictMock<MockRangeAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // Frames 16384 to 26384: 1 x 8192 frames then 1 x 1808
+    EXPECT_CALL(processor, process(_, 8192)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, process(_, 1808)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 10000 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(SndFileAudioFileReaderTest, shouldProcessFrameRangeWithReadAhead)
+{
+    reader_.setReadAheadSize(16384);
+
+    bool result = reader_.open("../test/data/test_file_stereo.flac");
+    ASSERT_TRUE(result);
+
+    StrictMock<MockRangeAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // Frames 16384 to 26384: 1 x 8192 frames then 1 x 1808
+    EXPECT_CALL(processor, process(_, 8192)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, process(_, 1808)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 10000 frames\nRead-ahead wait: "));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(SndFileAudioFileReaderTest, shouldProcessFileOnSeveralThreadsInSameBuffers)
+{
+    reader_.setThreads(3);
+
+    bool result = reader_.open("../test/data/test_file_stereo.flac");
+    ASSERT_TRUE(result);
+
+    StrictMock<MockAudioProcessor> processor;
+
+    InSequence sequence; // Calls expected in the order listed below.
+
+    EXPECT_CALL(processor, init(16000, 2, 113519, 16384)).WillOnce(Return(true));
+
+    // The same buffers as when reading on one thread: 13 x 8192 frames then
+    // 1 x 7023
+    EXPECT_CALL(processor, process(_, 8192)).Times(13).WillRepeatedly(Return(true));
+    EXPECT_CALL(processor, process(_, 7023)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(processor, done());
+
+    result = reader_.run(processor);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(output.str(), HasSubstr("\rDone: 100%\nRead 113519 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
 TEST_F(SndFileAudioFileReaderTest, shouldNotProcessFileMoreThanOnce)
 {
     bool result = reader_.open("../test/data/test_file_stereo.wav");
@@ -297,3 +381,118 @@ TEST_F(SndFileAudioFileReaderTest, shouldReportErrorIfNotAWavFile)
 }
 
 //------------------------------------------------------------------------------
+
+// Reads the given frames of the file, or of standard input if the filename is
+// "-", on the given number of threads.
+
+static void readSamples(
+    const char* filename,
+    SampleRecorder& recorder,
+    int threads = 1)
+{
+    SndFileAudioFileReader reader;
+    reader.setThreads(threads);
+
+    ASSERT_TRUE(reader.open(filename, false));
+    ASSERT_TRUE(reader.run(recorder));
+}
+
+//------------------------------------------------------------------------------
+
+// Reading from a pipe should give the same samples as reading the file, for a
+// range starting at the given frame, where the frames before it are read and
+// discarded as the pipe can't seek.
+
+static void testProcessFromPipe(
+    const char* filename,
+    long long start_frame,
+    long long end_frame,
+    size_t expected_frames)
+{
+    SampleRecorder file_recorder(start_frame, end_frame);
+    readSamples(filename, file_recorder);
+
+    SampleRecorder pipe_recorder(start_frame, end_frame);
+
+    {
+        StdinPipe pipe(filename);
+        ASSERT_TRUE(pipe.isOpen());
+
+        readSamples("-", pipe_recorder);
+    }
+
+    ASSERT_THAT(pipe_recorder.getChannels(), Eq(file_recorder.getChannels()));
+    ASSERT_THAT(pipe_recorder.samples.size(), Eq(expected_frames * 2));
+    ASSERT_TRUE(pipe_recorder.samples == file_recorder.samples);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(SndFileAudioFileReaderTest, shouldProcessWavFileFromPipe)
+{
+    testProcessFromPipe(
+        "../test/data/test_file_stereo.wav",
+        0,
+        std::numeric_limits<long long>::max(),
+        113519
+    );
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(SndFileAudioFileReaderTest, shouldProcessFrameRangeFromPipe)
+{
+    testProcessFromPipe("../test/data/test_file_stereo.wav", 16384, 26384, 10000);
+
+    ASSERT_THAT(output.str(), HasSubstr("Input file: -\n"));
+    ASSERT_THAT(output.str(), HasSubstr("Read 10000 frames\n"));
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+// Decoding on several threads should give the same samples as on one thread,
+// for a range starting at the given frame.
+
+static void testProcessOnSeveralThreads(
+    const char* filename,
+    long long start_frame,
+    size_t expected_frames)
+{
+    const long long end_frame = std::numeric_limits<long long>::max();
+
+    SampleRecorder recorder(start_frame, end_frame);
+    readSamples(filename, recorder, 1);
+
+    SampleRecorder threads_recorder(start_frame, end_frame);
+    readSamples(filename, threads_recorder, 3);
+
+    ASSERT_THAT(threads_recorder.getChannels(), Eq(2));
+    ASSERT_THAT(recorder.samples.size(), Eq(expected_frames * 2));
+    ASSERT_TRUE(threads_recorder.samples == recorder.samples);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(SndFileAudioFileReaderTest, shouldProcessFileOnSeveralThreads)
+{
+    testProcessOnSeveralThreads("../test/data/test_file_stereo.flac", 0, 113519);
+    testProcessOnSeveralThreads("../test/data/test_file_stereo.oga", 0, 113519);
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(SndFileAudioFileReaderTest, shouldProcessFrameRangeOnSeveralThreads)
+{
+    // Not a multiple of the 4 x 8192 frame chunks each thread decodes
+    testProcessOnSeveralThreads("../test/data/test_file_stereo.flac", 10001, 103518);
+    testProcessOnSeveralThreads("../test/data/test_file_stereo.oga", 10001, 103518);
+
+    ASSERT_TRUE(error.str().empty());
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2018 BBC Research and Development
+//
+// Author: Chris Chaffey
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "TextFormat.h"
+
+#include "gmock/gmock.h"
+
+#include <climits>
+#include <sstream>
+#include <string>
+
+//------------------------------------------------------------------------------
+
+using testing::Eq;
+using testing::StrEq;
+using testing::Test;
+
+//------------------------------------------------------------------------------
+
+static std::string formatInt(int value)
+{
+    char buffer[TextFormat::MAX_INT_LENGTH];
+    char* end = TextFormat::formatInt(buffer, value);
+
+    return std::string(buffer, end);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(TextFormatTest, shouldFormatIntegers)
+{
+    ASSERT_THAT(formatInt(0), StrEq("0"));
+    ASSERT_THAT(formatInt(7), StrEq("7"));
+    ASSERT_THAT(formatInt(10), StrEq("10"));
+    ASSERT_THAT(formatInt(99), StrEq("99"));
+    ASSERT_THAT(formatInt(100), StrEq("100"));
+    ASSERT_THAT(formatInt(32767), StrEq("32767"));
+    ASSERT_THAT(formatInt(-1), StrEq("-1"));
+    ASSERT_THAT(formatInt(-128), StrEq("-128"));
+    ASSERT_THAT(formatInt(-32768), StrEq("-32768"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(TextFormatTest, shouldFormatIntegerLimits)
+{
+    ASSERT_THAT(formatInt(INT_MAX), StrEq("2147483647"));
+    ASSERT_THAT(formatInt(INT_MIN), StrEq("-2147483648"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(ChunkedTextWriterTest, shouldWriteItemsInOrder)
+{
+    const size_t count = 200000;
+
+    std::ostringstream expected;
+
+    for (size_t i = 0; i < count; ++i) {
+        expected << i << '\n';
+    }
+
+    std::ostringstream stream;
+
+    ChunkedTextWriter writer(stream, TextFormat::MAX_INT_LENGTH + 1, 4);
+
+    writer.write(count, [](size_t i, char* output) {
+        output = TextFormat::formatInt(output, static_cast<int>(i));
+        *output++ = '\n';
+        return output;
+    });
+
+    ASSERT_THAT(stream.str(), StrEq(expected.str()));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(ChunkedTextWriterTest, shouldWriteNothingIfEmpty)
+{
+    std::ostringstream stream;
+
+    ChunkedTextWriter writer(stream, TextFormat::MAX_INT_LENGTH);
+
+    writer.write(0, [](size_t, char* output) {
+        *output++ = 'x';
+        return output;
+    });
+
+    ASSERT_THAT(stream.str().size(), Eq(0U));
+}
+
+//------------------------------------------------------------------------------
@@ -22,6 +22,12 @@
 //------------------------------------------------------------------------------
 
 #include "WaveformBuffer.h"
+#include "Array.h"
+#include "DatFileExporter.h"
+#include "DatFileImporter.h"
+#include "JsonFileExporter.h"
+#include "Options.h"
+#include "TxtFileExporter.h"
 #include "util/FileDeleter.h"
 #include "util/FileUtil.h"
 #include "util/Streams.h"
@@ -29,14 +35,14 @@
 #include "gmock/gmock.h"
 
 #include <fstream>
+#include <stdexcept>
+#include <string>
 
 //------------------------------------------------------------------------------
 
 using testing::EndsWith;
 using testing::Eq;
-using testing::Gt;
 using testing::HasSubstr;
-using testing::Ne;
 using testing::StrEq;
 using testing::Test;
 
@@ -55,6 +61,38 @@ class WaveformBufferTest : public Test
         {
         }
 
+        // Reads the given data file into the buffer. Throws on error.
+
+        void load(const char* filename)
+        {
+            const char* const argv[] = {
+                "appname", "-i", filename, "-o", "test.png"
+            };
+
+            Options options;
+            ASSERT_TRUE(options.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+            // The importer keeps a reference to the path
+            const boost::filesystem::path path(filename);
+
+            DatFileImporter importer(buffer_, options, path);
+            importer.ImportFromFile();
+        }
+
+        // Returns the error message from loading the given data file
+
+        std::string getLoadError(const char* filename)
+        {
+            try {
+                load(filename);
+            }
+            catch (const std::runtime_error& e) {
+                return e.what();
+            }
+
+            return std::string();
+        }
+
         WaveformBuffer buffer_;
 };
 
@@ -71,6 +109,25 @@ class WaveformBufferSaveTest : public WaveformBufferTest
         {
         }
 
+        // Writes the buffer as a version 1 file with the given bits
+
+        template<typename Exporter>
+        void save(const boost::filesystem::path& filename, const char* bits = "16")
+        {
+            const std::string output_filename = filename.string();
+
+            const char* const argv[] = {
+                "appname", "-i", "test.wav", "-o", output_filename.c_str(),
+                "-b", bits, "-f", "1"
+            };
+
+            Options options;
+            ASSERT_TRUE(options.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+            Exporter exporter(buffer_, options, filename);
+            ASSERT_TRUE(exporter.ExportToFile());
+        }
+
         WaveformBuffer buffer_;
 };
 
@@ -87,19 +144,19 @@ TEST_F(WaveformBufferTest, shouldConstructWithDefaultState)
 
 TEST_F(WaveformBufferTest, shouldLoadValid16BitDataFile)
 {
-    bool result = buffer_.load("../test/data/test_file_stereo_16bit_64spp_wav.dat");
-    ASSERT_TRUE(result);
+    load("../test/data/test_file_stereo_16bit_64spp_wav.dat");
 
     ASSERT_THAT(buffer_.getSampleRate(), Eq(16000));
     ASSERT_THAT(buffer_.getSamplesPerPixel(), Eq(64));
     ASSERT_THAT(buffer_.getSize(), Eq(1774));
 
     std::string expected_output(
-        "Reading waveform data file: ../test/data/test_file_stereo_16bit_64spp_wav.dat\n"
+        "File version: 1\n"
         "Sample rate: 16000 Hz\n"
         "Bits: 16\n"
         "Samples per pixel: 64\n"
         "Length: 1774 points\n"
+        "Completed import of \"../test/data/test_file_stereo_16bit_64spp_wav.dat\".  Total points: 1774\n"
     );
 
     ASSERT_THAT(output.str(), StrEq(expected_output));
@@ -110,19 +167,19 @@ TEST_F(WaveformBufferTest, shouldLoadValid16BitDataFile)
 
 TEST_F(WaveformBufferTest, shouldLoadValid8BitDataFile)
 {
-    bool result = buffer_.load("../test/data/test_file_stereo_8bit_64spp_wav.dat");
-    ASSERT_TRUE(result);
+    load("../test/data/test_file_stereo_8bit_64spp_wav.dat");
 
     ASSERT_THAT(buffer_.getSampleRate(), Eq(16000));
     ASSERT_THAT(buffer_.getSamplesPerPixel(), Eq(64));
     ASSERT_THAT(buffer_.getSize(), Eq(1774));
 
     std::string expected_output(
-        "Reading waveform data file: ../test/data/test_file_stereo_8bit_64spp_wav.dat\n"
+        "File version: 1\n"
         "Sample rate: 16000 Hz\n"
         "Bits: 8\n"
         "Samples per pixel: 64\n"
         "Length: 1774 points\n"
+        "Completed import of \"../test/data/test_file_stereo_8bit_64spp_wav.dat\".  Total points: 1774\n"
     );
 
     ASSERT_THAT(output.str(), StrEq(expected_output));
@@ -131,37 +188,12 @@ TEST_F(WaveformBufferTest, shouldLoadValid8BitDataFile)
 
 //------------------------------------------------------------------------------
 
-TEST_F(WaveformBufferTest, shouldNotLoadDataFileIfNotVersion1)
-{
-    const char* filename = "../test/data/version2.dat";
-
-    bool result = buffer_.load(filename);
-    ASSERT_FALSE(result);
-
-    std::string str = output.str();
-    ASSERT_THAT(str, HasSubstr(filename));
-
-    str = error.str();
-    ASSERT_THAT(str, HasSubstr(filename));
-    ASSERT_THAT(str, HasSubstr("Cannot load data file version: 2"));
-    ASSERT_THAT(str, EndsWith("\n"));
-}
-
-//------------------------------------------------------------------------------
-
-TEST_F(WaveformBufferTest, shouldReportErrorIfSizeMismatch)
+TEST_F(WaveformBufferTest, shouldLoadPointsPresentIfSizeMismatch)
 {
-    const char* filename = "../test/data/size_mismatch.dat";
-
-    bool result = buffer_.load(filename);
-    ASSERT_TRUE(result);
-
-    std::string str = output.str();
-    ASSERT_THAT(str, HasSubstr(filename));
-
-    str = error.str();
-    ASSERT_THAT(str, StrEq("Expected 2056 points, read 1800 min and max points\n"));
+    // The header gives 2056 points, but the file holds 1800
+    load("../test/data/size_mismatch.dat");
 
+    ASSERT_THAT(output.str(), HasSubstr("Length: 2056 points\n"));
     ASSERT_THAT(buffer_.getSize(), Eq(1800)); // Actual size loaded
 }
 
@@ -171,53 +203,38 @@ TEST_F(WaveformBufferTest, shouldReportErrorIfFileNotFound)
 {
     const char* filename = "../test/data/unknown.dat";
 
-    bool result = buffer_.load(filename);
-    ASSERT_FALSE(result);
-
-    ASSERT_TRUE(output.str().empty());
+    const std::string str = getLoadError(filename);
 
-    std::string str = error.str();
     ASSERT_THAT(str, HasSubstr("No such file or directory"));
     ASSERT_THAT(str, HasSubstr(filename));
     ASSERT_THAT(str, EndsWith("\n"));
+
+    ASSERT_TRUE(output.str().empty());
 }
 
 //------------------------------------------------------------------------------
 
 TEST_F(WaveformBufferTest, shouldNotLoadDataFileWithSampleRateBelowMinimum)
 {
-    const char* filename = "../test/data/sample_rate_too_low.dat";
+    const std::string str = getLoadError("../test/data/sample_rate_too_low.dat");
 
-    bool result = buffer_.load(filename);
-    ASSERT_FALSE(result);
-
-    std::string str = error.str();
-    ASSERT_THAT(str, HasSubstr(filename));
     ASSERT_THAT(str, HasSubstr("Invalid sample rate"));
-    ASSERT_THAT(str, EndsWith("\n"));
 }
 
 //------------------------------------------------------------------------------
 
 TEST_F(WaveformBufferTest, shouldNotLoadDataFileWithSamplesPerPixelBelowMinimum)
 {
-    const char* filename = "../test/data/samples_per_pixel_too_low.dat";
+    const std::string str = getLoadError("../test/data/samples_per_pixel_too_low.dat");
 
-    bool result = buffer_.load(filename);
-    ASSERT_FALSE(result);
-
-    std::string str = error.str();
-    ASSERT_THAT(str, HasSubstr(filename));
     ASSERT_THAT(str, HasSubstr("Invalid samples per pixel"));
-    ASSERT_THAT(str, EndsWith("\n"));
 }
 
 //------------------------------------------------------------------------------
 
 TEST_F(WaveformBufferTest, shouldLoadDataFileIfSizeIsZero)
 {
-    bool result = buffer_.load("../test/data/zero_length.dat");
-    ASSERT_TRUE(result);
+    load("../test/data/zero_length.dat");
 
     ASSERT_THAT(buffer_.getSampleRate(), Eq(16000));
     ASSERT_THAT(buffer_.getSamplesPerPixel(), Eq(64));
@@ -233,8 +250,10 @@ TEST_F(WaveformBufferSaveTest, shouldSaveEmptyDataFile)
     // Ensure temporary file is deleted at end of test.
     FileDeleter deleter(filename);
 
-    bool result = buffer_.save(filename.c_str());
-    ASSERT_TRUE(result);
+    buffer_.setSampleRate(44100);
+    buffer_.setSamplesPerPixel(256);
+
+    save<DatFileExporter>(filename);
 
     // Check file was created.
     boost::system::error_code error_code;
@@ -258,8 +277,7 @@ TEST_F(WaveformBufferSaveTest, shouldSave16BitDataFile)
 
     buffer_.appendSamples(-1000, 1000);
 
-    bool result = buffer_.save(filename.c_str(), 16);
-    ASSERT_TRUE(result);
+    save<DatFileExporter>(filename, "16");
 
     // Check file was created.
     boost::system::error_code error_code;
@@ -283,8 +301,7 @@ TEST_F(WaveformBufferSaveTest, shouldSave8BitDataFile)
 
     buffer_.appendSamples(-100, 100);
 
-    bool result = buffer_.save(filename.c_str(), 8);
-    ASSERT_TRUE(result);
+    save<DatFileExporter>(filename, "8");
 
     // Check file was created.
     boost::system::error_code error_code;
@@ -296,21 +313,9 @@ TEST_F(WaveformBufferSaveTest, shouldSave8BitDataFile)
 
 //------------------------------------------------------------------------------
 
-TEST_F(WaveformBufferSaveTest, shouldReportErrorIfNot8Or16Bits)
-{
-    const boost::filesystem::path filename = FileUtil::getTempFilename(".dat");
-
-    bool result = buffer_.save(filename.c_str(), 10);
-    ASSERT_FALSE(result);
-
-    ASSERT_FALSE(error.str().empty());
-}
-
-//------------------------------------------------------------------------------
-
 TEST_F(WaveformBufferSaveTest, shouldSave16BitTextFile)
 {
-    const boost::filesystem::path filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".txt");
 
     // Ensure temporary file is deleted at end of test.
     FileDeleter deleter(filename);
@@ -321,17 +326,9 @@ TEST_F(WaveformBufferSaveTest, shouldSave16BitTextFile)
     buffer_.appendSamples(-1024, 1024);
     buffer_.appendSamples(-2048, 2048);
 
-    bool result = buffer_.saveAsText(filename.c_str());
-    ASSERT_TRUE(result);
-
-    // Check file was created.
-    boost::system::error_code error_code;
-    boost::uintmax_t size = boost::filesystem::file_size(filename, error_code);
-
-    ASSERT_THAT(error_code, Eq(boost::system::errc::success));
-    ASSERT_THAT(size, Gt(0U));
+    save<TxtFileExporter>(filename);
 
-    const std::string data = FileUtil::readTextFile(filename.c_str());
+    const std::string data = FileUtil::readTextFile(filename);
     ASSERT_THAT(data, StrEq("-1024,1024\n-2048,2048\n"));
 }
 
@@ -339,7 +336,7 @@ TEST_F(WaveformBufferSaveTest, shouldSave16BitTextFile)
 
 TEST_F(WaveformBufferSaveTest, shouldSave8BitTextFile)
 {
-    const boost::filesystem::path filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".txt");
 
     // Ensure temporary file is deleted at end of test.
     FileDeleter deleter(filename);
@@ -350,15 +347,7 @@ TEST_F(WaveformBufferSaveTest, shouldSave8BitTextFile)
     buffer_.appendSamples(-1024, 1024);
     buffer_.appendSamples(-2048, 2048);
 
-    bool result = buffer_.saveAsText(filename.c_str(), 8);
-    ASSERT_TRUE(result);
-
-    // Check file was created.
-    boost::system::error_code error_code;
-    boost::uintmax_t size = boost::filesystem::file_size(filename, error_code);
-
-    ASSERT_THAT(error_code, Eq(boost::system::errc::success));
-    ASSERT_THAT(size, Gt(0U));
+    save<TxtFileExporter>(filename, "8");
 
     const std::string data = FileUtil::readTextFile(filename);
     ASSERT_THAT(data, StrEq("-4,4\n-8,8\n"));
@@ -368,7 +357,7 @@ TEST_F(WaveformBufferSaveTest, shouldSave8BitTextFile)
 
 TEST_F(WaveformBufferSaveTest, shouldSave16BitJsonFile)
 {
-    const boost::filesystem::path filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".json");
 
     // Ensure temporary file is deleted at end of test.
     FileDeleter deleter(filename);
@@ -379,25 +368,19 @@ TEST_F(WaveformBufferSaveTest, shouldSave16BitJsonFile)
     buffer_.appendSamples(-1024, 1024);
     buffer_.appendSamples(-2048, 2048);
 
-    bool result = buffer_.saveAsJson(filename.c_str());
-    ASSERT_TRUE(result);
-
-    // Check file was created.
-    boost::system::error_code error_code;
-    boost::uintmax_t size = boost::filesystem::file_size(filename, error_code);
-
-    ASSERT_THAT(error_code, Eq(boost::system::errc::success));
-    ASSERT_THAT(size, Gt(0U));
+    save<JsonFileExporter>(filename);
 
     const std::string data = FileUtil::readTextFile(filename);
-    ASSERT_THAT(data, StrEq("{\"sample_rate\":44100,\"samples_per_pixel\":256,\"bits\":16,\"length\":2,\"data\":[-1024,1024,-2048,2048]}\n"));
+    ASSERT_THAT(data, HasSubstr("\"bits\":16,"));
+    ASSERT_THAT(data, HasSubstr("\"length\":2,"));
+    ASSERT_THAT(data, HasSubstr("-1024,1024,-2048,2048\n"));
 }
 
 //------------------------------------------------------------------------------
 
 TEST_F(WaveformBufferSaveTest, shouldSave8BitJsonFile)
 {
-    const boost::filesystem::path filename = FileUtil::getTempFilename(".dat");
+    const boost::filesystem::path filename = FileUtil::getTempFilename(".json");
 
     // Ensure temporary file is deleted at end of test.
     FileDeleter deleter(filename);
@@ -408,18 +391,12 @@ TEST_F(WaveformBufferSaveTest, shouldSave8BitJsonFile)
     buffer_.appendSamples(-1024, 1024);
     buffer_.appendSamples(-2048, 2048);
 
-    bool result = buffer_.saveAsJson(filename.c_str(), 8);
-    ASSERT_TRUE(result);
-
-    // Check file was created.
-    boost::system::error_code error_code;
-    boost::uintmax_t size = boost::filesystem::file_size(filename, error_code);
-
-    ASSERT_THAT(error_code, Eq(boost::system::errc::success));
-    ASSERT_THAT(size, Gt(0U));
+    save<JsonFileExporter>(filename, "8");
 
     const std::string data = FileUtil::readTextFile(filename);
-    ASSERT_THAT(data, StrEq("{\"sample_rate\":44100,\"samples_per_pixel\":256,\"bits\":8,\"length\":2,\"data\":[-4,4,-8,8]}\n"));
+    ASSERT_THAT(data, HasSubstr("\"bits\":8,"));
+    ASSERT_THAT(data, HasSubstr("\"length\":2,"));
+    ASSERT_THAT(data, HasSubstr("-4,4,-8,8\n"));
 }
 
 //------------------------------------------------------------------------------
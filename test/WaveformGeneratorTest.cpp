@@ -21,6 +21,9 @@
 //
 //------------------------------------------------------------------------------
 
+#include "Array.h"
+#include "FileExporter.h"
+#include "Options.h"
 #include "WaveformBuffer.h"
 #include "WaveformGenerator.h"
 #include "util/Streams.h"
@@ -29,10 +32,12 @@
 
 #include <climits>
 #include <stdexcept>
+#include <vector>
 
 //------------------------------------------------------------------------------
 
 using testing::EndsWith;
+using testing::ElementsAre;
 using testing::Eq;
 using testing::HasSubstr;
 using testing::StrEq;
@@ -375,3 +380,127 @@ TEST_F(WaveformGeneratorTest, shouldComputeMaxAndMinValuesFromMonoInput)
 }
 
 //------------------------------------------------------------------------------
+
+TEST_F(WaveformGeneratorTest, shouldLimitFrameRangeToPointRange)
+{
+    WaveformBuffer buffer;
+
+    const int samples_per_pixel = 300;
+
+    SamplesPerPixelScaleFactor scale_factor(samples_per_pixel);
+    WaveformGenerator generator(buffer, scale_factor);
+
+    ASSERT_THAT(generator.getRangeStartFrame(), Eq(0));
+
+    // 1.01 seconds at 44100 Hz is 44541 frames, in point 148
+    generator.setPointRange(1.01, 10);
+
+    bool result = generator.init(44100, 2, 0, 1024);
+
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(error.str().empty());
+
+    ASSERT_THAT(generator.getRangeStartFrame(), Eq(148 * 300));
+    ASSERT_THAT(generator.getRangeEndFrame(), Eq(158 * 300));
+    ASSERT_THAT(buffer.getOffset(), Eq(148));
+}
+
+//------------------------------------------------------------------------------
+
+// Records the points passed to it by the generator
+
+class TestFileExporter : public FileExporter
+{
+    public:
+        TestFileExporter(
+            WaveformBuffer& buffer,
+            const Options& options,
+            const fs::path& output_filename) :
+            FileExporter(buffer, options, output_filename),
+            channels(0),
+            blocks(0),
+            finished(false)
+        {
+        }
+
+        int channels;
+        int blocks;
+        bool finished;
+        std::vector<short> points;
+
+    private:
+        virtual void beginOutput(int output_channels)
+        {
+            channels = output_channels;
+        }
+
+        virtual void writeOutput()
+        {
+            for (int i = 0; i < buffer_.getSize(); ++i) {
+                points.push_back(buffer_.getMinSample(i));
+                points.push_back(buffer_.getMaxSample(i));
+            }
+
+            ++blocks;
+        }
+
+        virtual void finishOutput()
+        {
+            finished = true;
+        }
+};
+
+//------------------------------------------------------------------------------
+
+TEST_F(WaveformGeneratorTest, shouldPassPointsToExporter)
+{
+    Options options;
+
+    const char* const argv[] = { "appname", "-i", "test.wav", "-o", "test.dat" };
+    ASSERT_TRUE(options.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+    WaveformBuffer buffer;
+    const fs::path output_filename("test.dat");
+    TestFileExporter exporter(buffer, options, output_filename);
+
+    const int samples_per_pixel = 300;
+
+    SamplesPerPixelScaleFactor scale_factor(samples_per_pixel);
+    WaveformGenerator generator(buffer, scale_factor, true, &exporter);
+
+    const int sample_rate = 44100;
+    const int channels    = 1;
+    const int BUFFER_SIZE = 512;
+
+    short samples[BUFFER_SIZE];
+    memset(samples, 0, sizeof(samples));
+
+    const int frames = BUFFER_SIZE / channels;
+
+    bool result = generator.init(sample_rate, channels, 0, BUFFER_SIZE);
+
+    ASSERT_TRUE(result);
+    ASSERT_THAT(exporter.channels, Eq(1));
+
+    samples[0] = 100;
+    samples[299] = -102;
+    samples[300] = 197;
+    samples[511] = -200;
+
+    result = generator.process(samples, frames);
+    ASSERT_TRUE(result);
+
+    // The first point is complete, and has been passed to the exporter
+    ASSERT_THAT(exporter.points, ElementsAre(-102, 100));
+    ASSERT_THAT(buffer.getSize(), Eq(0));
+    ASSERT_FALSE(exporter.finished);
+
+    generator.done();
+
+    ASSERT_THAT(exporter.points, ElementsAre(-102, 100, -200, 197));
+    ASSERT_THAT(exporter.blocks, Eq(2));
+    ASSERT_THAT(buffer.getSize(), Eq(0));
+    ASSERT_TRUE(exporter.finished);
+}
+
+//------------------------------------------------------------------------------
@@ -22,7 +22,11 @@
 //------------------------------------------------------------------------------
 
 #include "WaveformRescaler.h"
+#include "Array.h"
+#include "DatFileImporter.h"
+#include "Options.h"
 #include "WaveformBuffer.h"
+#include "util/Streams.h"
 
 #include "gmock/gmock.h"
 
@@ -36,6 +40,28 @@ using testing::Test;
 class WaveformRescalerTest : public Test
 {
     protected:
+        virtual void SetUp()
+        {
+            output.str(std::string());
+            error.str(std::string());
+        }
+
+        void load(WaveformBuffer& buffer, const char* filename)
+        {
+            const char* const argv[] = {
+                "appname", "-i", filename, "-o", "test.png"
+            };
+
+            Options options;
+            ASSERT_TRUE(options.parseCommandLine(static_cast<int>(ARRAY_LENGTH(argv)), argv));
+
+            // The importer keeps a reference to the path
+            const boost::filesystem::path path(filename);
+
+            DatFileImporter importer(buffer, options, path);
+            ASSERT_TRUE(importer.ImportFromFile());
+        }
+
         WaveformRescaler rescaler_;
 };
 
@@ -84,17 +110,51 @@ TEST_F(WaveformRescalerTest, shouldRescaleWaveformData)
 
 //------------------------------------------------------------------------------
 
-TEST_F(WaveformRescalerTest, shouldRescale8BitWaveformData)
+TEST_F(WaveformRescalerTest, shouldRescalePartialWaveformData)
 {
     WaveformBuffer input_buffer;
-    bool result = input_buffer.load("../test/data/test_file_stereo_8bit_64spp_wav.dat");
 
+    input_buffer.setSampleRate(48000);
+    input_buffer.setSamplesPerPixel(512);
+    input_buffer.setOffset(3);
+
+    input_buffer.appendSamples(-5, 7);
+    input_buffer.appendSamples(-5, 7);
+    input_buffer.appendSamples(0, 0);
+    input_buffer.appendSamples(0, 0);
+    input_buffer.appendSamples(0, 0);
+    input_buffer.appendSamples(0, 0);
+    input_buffer.appendSamples(-2, 2);
+
+    WaveformBuffer output_buffer;
+
+    bool result = rescaler_.rescale(input_buffer, output_buffer, 1024);
+
+    // The first input point is part of output point 1, which is incomplete
     ASSERT_TRUE(result);
+    ASSERT_THAT(output_buffer.getOffset(), Eq(2));
+    ASSERT_THAT(output_buffer.getSize(), Eq(3));
+
+    ASSERT_THAT(output_buffer.getMinSample(0), Eq(-5));
+    ASSERT_THAT(output_buffer.getMaxSample(0), Eq(7));
+    ASSERT_THAT(output_buffer.getMinSample(1), Eq(0));
+    ASSERT_THAT(output_buffer.getMaxSample(1), Eq(0));
+    ASSERT_THAT(output_buffer.getMinSample(2), Eq(-2));
+    ASSERT_THAT(output_buffer.getMaxSample(2), Eq(2));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_F(WaveformRescalerTest, shouldRescale8BitWaveformData)
+{
+    WaveformBuffer input_buffer;
+    load(input_buffer, "../test/data/test_file_stereo_8bit_64spp_wav.dat");
+
     ASSERT_THAT(input_buffer.getSize(), Eq(1774));
 
     WaveformBuffer output_buffer;
 
-    result = rescaler_.rescale(input_buffer, output_buffer, 128);
+    bool result = rescaler_.rescale(input_buffer, output_buffer, 128);
 
     ASSERT_TRUE(result);
     ASSERT_THAT(output_buffer.getSize(), Eq(887));
@@ -107,14 +167,13 @@ TEST_F(WaveformRescalerTest, shouldRescale8BitWaveformData)
 TEST_F(WaveformRescalerTest, shouldRescale16BitWaveformData)
 {
     WaveformBuffer input_buffer;
-    bool result = input_buffer.load("../test/data/test_file_stereo_16bit_64spp_wav.dat");
+    load(input_buffer, "../test/data/test_file_stereo_16bit_64spp_wav.dat");
 
-    ASSERT_TRUE(result);
     ASSERT_THAT(input_buffer.getSize(), Eq(1774));
 
     WaveformBuffer output_buffer;
 
-    result = rescaler_.rescale(input_buffer, output_buffer, 128);
+    bool result = rescaler_.rescale(input_buffer, output_buffer, 128);
 
     ASSERT_TRUE(result);
     ASSERT_THAT(output_buffer.getSize(), Eq(887));
@@ -0,0 +1,53 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_MOCK_RANGE_AUDIO_PROCESSOR_H)
+#define INC_MOCK_RANGE_AUDIO_PROCESSOR_H
+
+//------------------------------------------------------------------------------
+
+#include "MockAudioProcessor.h"
+
+//------------------------------------------------------------------------------
+
+// Processes only part of the input file: frames 16384 to 26384
+
+class MockRangeAudioProcessor : public MockAudioProcessor
+{
+    public:
+        virtual long long getRangeStartFrame() const
+        {
+            return 16384;
+        }
+
+        virtual long long getRangeEndFrame() const
+        {
+            return 26384;
+        }
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_MOCK_RANGE_AUDIO_PROCESSOR_H)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "SampleRecorder.h"
+
+//------------------------------------------------------------------------------
+
+SampleRecorder::SampleRecorder(long long start_frame, long long end_frame) :
+    start_frame_(start_frame),
+    end_frame_(end_frame),
+    channels_(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool SampleRecorder::init(
+    int /* sample_rate */,
+    int channels,
+    long /* frame_count */,
+    int /* buffer_size */)
+{
+    channels_ = channels;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool SampleRecorder::process(
+    const short* input_buffer,
+    int input_frame_count)
+{
+    samples.insert(
+        samples.end(),
+        input_buffer,
+        input_buffer + input_frame_count * channels_
+    );
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+void SampleRecorder::done()
+{
+}
+
+//------------------------------------------------------------------------------
+
+long long SampleRecorder::getRangeStartFrame() const
+{
+    return start_frame_;
+}
+
+//------------------------------------------------------------------------------
+
+long long SampleRecorder::getRangeEndFrame() const
+{
+    return end_frame_;
+}
+
+//------------------------------------------------------------------------------
+
+int SampleRecorder::getChannels() const
+{
+    return channels_;
+}
+
+//------------------------------------------------------------------------------
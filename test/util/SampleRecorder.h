@@ -0,0 +1,79 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_SAMPLE_RECORDER_H)
+#define INC_SAMPLE_RECORDER_H
+
+//------------------------------------------------------------------------------
+
+#include "AudioProcessor.h"
+
+#include <limits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Records the samples passed to the processor, from the given range of frames
+
+class SampleRecorder : public AudioProcessor
+{
+    public:
+        SampleRecorder(
+            long long start_frame = 0,
+            long long end_frame = std::numeric_limits<long long>::max()
+        );
+
+    public:
+        virtual bool init(
+            int sample_rate,
+            int channels,
+            long frame_count,
+            int buffer_size
+        );
+
+        virtual bool process(
+            const short* input_buffer,
+            int input_frame_count
+        );
+
+        virtual void done();
+
+        virtual long long getRangeStartFrame() const;
+        virtual long long getRangeEndFrame() const;
+
+        int getChannels() const;
+
+    public:
+        std::vector<short> samples;
+
+    private:
+        long long start_frame_;
+        long long end_frame_;
+        int channels_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_SAMPLE_RECORDER_H)
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "StdinPipe.h"
+#include "FileUtil.h"
+
+#include <cstdio>
+
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+
+StdinPipe::StdinPipe(const boost::filesystem::path& filename) :
+    data_(FileUtil::readFile(filename)),
+    write_fd_(-1),
+    saved_stdin_(-1)
+{
+    int fds[2];
+
+    if (pipe(fds) != 0) {
+        return;
+    }
+
+    saved_stdin_ = dup(STDIN_FILENO);
+
+    if (saved_stdin_ == -1 || dup2(fds[0], STDIN_FILENO) == -1) {
+        if (saved_stdin_ != -1) {
+            close(saved_stdin_);
+            saved_stdin_ = -1;
+        }
+
+        close(fds[0]);
+        close(fds[1]);
+
+        return;
+    }
+
+    close(fds[0]);
+
+    write_fd_ = fds[1];
+
+    writer_ = std::thread(&StdinPipe::write, this);
+}
+
+//------------------------------------------------------------------------------
+
+StdinPipe::~StdinPipe()
+{
+    if (saved_stdin_ == -1) {
+        return;
+    }
+
+    // Read whatever the test didn't, so the writer can finish
+
+    char buffer[4096];
+
+    while (read(STDIN_FILENO, buffer, sizeof(buffer)) > 0) {
+    }
+
+    writer_.join();
+
+    dup2(saved_stdin_, STDIN_FILENO);
+    close(saved_stdin_);
+
+    clearerr(stdin);
+}
+
+//------------------------------------------------------------------------------
+
+bool StdinPipe::isOpen() const
+{
+    return saved_stdin_ != -1;
+}
+
+//------------------------------------------------------------------------------
+
+void StdinPipe::write()
+{
+    size_t offset = 0;
+
+    while (offset < data_.size()) {
+        const ssize_t count = ::write(
+            write_fd_, &data_[offset], data_.size() - offset
+        );
+
+        if (count <= 0) {
+            break;
+        }
+
+        offset += static_cast<size_t>(count);
+    }
+
+    close(write_fd_);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_STDIN_PIPE_H)
+#define INC_STDIN_PIPE_H
+
+//------------------------------------------------------------------------------
+
+#include <boost/filesystem.hpp>
+
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Replaces standard input with a pipe, through which the contents of the given
+// file are written, for testing reading from a pipe. Standard input is
+// restored on destruction.
+
+class StdinPipe
+{
+    public:
+        StdinPipe(const boost::filesystem::path& filename);
+        ~StdinPipe();
+
+        StdinPipe(const StdinPipe&) = delete;
+        StdinPipe& operator=(const StdinPipe&) = delete;
+
+        bool isOpen() const;
+
+    private:
+        void write();
+
+    private:
+        std::vector<uint8_t> data_;
+        int write_fd_;
+        int saved_stdin_;
+        std::thread writer_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_STDIN_PIPE_H)
+
+//------------------------------------------------------------------------------
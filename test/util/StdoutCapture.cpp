@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#include "StdoutCapture.h"
+#include "FileUtil.h"
+
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+
+StdoutCapture::StdoutCapture() :
+    filename_(FileUtil::getTempFilename()),
+    saved_stdout_(-1)
+{
+    fflush(stdout);
+
+    const int fd = open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if (fd == -1) {
+        return;
+    }
+
+    saved_stdout_ = dup(STDOUT_FILENO);
+
+    if (saved_stdout_ != -1 && dup2(fd, STDOUT_FILENO) == -1) {
+        close(saved_stdout_);
+        saved_stdout_ = -1;
+    }
+
+    close(fd);
+}
+
+//------------------------------------------------------------------------------
+
+StdoutCapture::~StdoutCapture()
+{
+    restore();
+
+    unlink(filename_.c_str());
+}
+
+//------------------------------------------------------------------------------
+
+bool StdoutCapture::isOpen() const
+{
+    return saved_stdout_ != -1;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<uint8_t> StdoutCapture::getOutput()
+{
+    restore();
+
+    if (boost::filesystem::file_size(filename_) == 0) {
+        return std::vector<uint8_t>();
+    }
+
+    return FileUtil::readFile(filename_);
+}
+
+//------------------------------------------------------------------------------
+
+void StdoutCapture::restore()
+{
+    if (saved_stdout_ != -1) {
+        fflush(stdout);
+
+        dup2(saved_stdout_, STDOUT_FILENO);
+        close(saved_stdout_);
+
+        saved_stdout_ = -1;
+    }
+}
+
+//------------------------------------------------------------------------------
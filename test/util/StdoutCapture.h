@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//
+// Copyright 2013-2018 BBC Research and Development
+//
+// Author: Chris Needham
+//
+// This file is part of Audio Waveform Image Generator.
+//
+// Audio Waveform Image Generator is free software: you can redistribute it
+// and/or modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 3 of the License,
+// or (at your option) any later version.
+//
+// Audio Waveform Image Generator is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+// Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// Audio Waveform Image Generator.  If not, see <http://www.gnu.org/licenses/>.
+//
+//------------------------------------------------------------------------------
+
+#if !defined(INC_STDOUT_CAPTURE_H)
+#define INC_STDOUT_CAPTURE_H
+
+//------------------------------------------------------------------------------
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Redirects standard output to a temporary file, for testing output written
+// there with stdio. Standard output is restored by getOutput() or on
+// destruction.
+
+class StdoutCapture
+{
+    public:
+        StdoutCapture();
+        ~StdoutCapture();
+
+        StdoutCapture(const StdoutCapture&) = delete;
+        StdoutCapture& operator=(const StdoutCapture&) = delete;
+
+        bool isOpen() const;
+
+        std::vector<uint8_t> getOutput();
+
+    private:
+        void restore();
+
+    private:
+        boost::filesystem::path filename_;
+        int saved_stdout_;
+};
+
+//------------------------------------------------------------------------------
+
+#endif // #if !defined(INC_STDOUT_CAPTURE_H)
+
+//------------------------------------------------------------------------------